@@ -18,6 +18,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/version.h>
 #include <linux/errno.h>
 #include <linux/slab.h>
 #include <linux/module.h>
@@ -29,6 +30,22 @@
 #include <linux/delay.h>
 #include <linux/init.h>
 #include <linux/usb.h>
+#include <linux/firmware.h>
+#include <linux/ihex.h>
+#include <linux/crc32.h>
+#include <linux/uio.h>
+#include <linux/scatterlist.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/kfifo.h>
+#include <linux/poll.h>
+#include <linux/anon_inodes.h>
+#include <linux/kobject.h>
+#include <linux/sched/signal.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,7,0)
+#include <linux/io_uring/cmd.h>
+#endif
 
 #include <linux/string.h>
 
@@ -43,6 +60,17 @@
 static int debug = DEBUG_NONE;
 static int load_fx1_fw = 0;
 static int load_fx2_fw = 0;
+static int batch_records = 1;	/* records pipelined while loading a mode, 1 sends them one by one */
+static int priority_aging = 50;
+static int timeout_floor = 1000;	/* modes that wait on a card */
+static int command_timeout_floor = 100;	/* modes that only talk to the firmware */
+static int timeout_ceiling = 3000;
+static int jtag_experimental = 0;	/* the jtag wire format is unverified, keep it off by default */
+static char *restore[RESTORE_ENTRIES];
+static int restore_count;
+
+static struct cas_restore restore_table[RESTORE_ENTRIES];
+static DEFINE_MUTEX(restore_lock);
 
 #define to_cas_dev(d) container_of(d, struct usb_cas, kref)
 
@@ -51,7 +79,10 @@ static const struct file_operations cas_fops;
 
 /* local function prototypes */
 static int cas_probe(struct usb_interface *interface, const struct usb_device_id *id);
+static int cas_set_mode(struct usb_cas *cas, int mode);
+static int cas_set_mode_queued(struct usb_cas *cas, int mode);
 static void cas_disconnect(struct usb_interface *interface);
+static int cas_event_fd(struct usb_cas *cas);
 
 static void wait_for_finish(struct usb_cas *cas, unsigned long usecs)
 {
@@ -91,9 +122,107 @@ static void dump_buffer(struct usb_cas *cas, unsigned char *buffer, char *name,
 	}
 }
 
+/* queue an event for the event fd, safe from interrupt context */
+static void event_post(struct usb_cas *cas, int type, int status, const unsigned char *data, int len)
+{
+	struct cas_event event = {
+		.time_ns = ktime_get_ns(),
+		.type = type,
+		.status = status,
+		.length = min(len, EVENT_DATA_SIZE),
+	};
+	unsigned long flags;
+
+	if (data)
+		memcpy(event.data, data, event.length);
+
+	spin_lock_irqsave(&cas->event_lock, flags);
+	if (kfifo_is_full(&cas->events)) {
+		/* keep the newest events, the next read reports how many were lost */
+		kfifo_skip(&cas->events);
+		cas->events_lost++;
+	}
+	kfifo_put(&cas->events, event);
+	spin_unlock_irqrestore(&cas->event_lock, flags);
+
+	wake_up_interruptible(&cas->event_wait);
+}
+
+/*
+ * Transfer timeouts follow the response times seen per mode and endpoint,
+ * estimated the way tcp does with srtt and rttvar: srtt plus four
+ * deviations, clamped to a floor..timeout_ceiling ms. Until enough
+ * samples are in, the old fixed timeouts apply.
+ * In a reader mode one estimate per endpoint mixes quick command acks with
+ * card replies, an atr or card i/o at 9600 baud takes hundreds of ms. The
+ * floor of those modes defaults to the old fixed bulk timeout, so a card
+ * reply is never cut shorter than before. Modes without a card in the loop
+ * only see command acks and use command_timeout_floor, which lets their
+ * timeouts follow the device down to a fraction of that.
+ */
+static int rtt_mode(struct usb_cas *cas)
+{
+	return cas->status < DEVICE_MODES ? cas->status : NOFW;
+}
+
+static struct cas_rtt *rtt_of(struct usb_cas *cas, int endpoint)
+{
+	return &cas->rtt[rtt_mode(cas)][endpoint];
+}
+
+/* the boot stages and modes that never wait on a card */
+static int command_mode(int mode)
+{
+	return mode <= START || mode == JTAG;
+}
+
+static int __rtt_timeout(struct cas_rtt *rtt, int mode, int endpoint)
+{
+	int floor = max(command_mode(mode) ? command_timeout_floor : timeout_floor, 1);
+	int ceiling = max(timeout_ceiling, floor);
+	int timeout;
+
+	if (rtt->samples < RTT_MIN_SAMPLES)
+		timeout = endpoint == RTT_CONTROL ? 3000 : 1000;
+	else
+		timeout = DIV_ROUND_UP(rtt->srtt + 4 * rtt->rttvar, USEC_PER_MSEC);
+
+	return clamp(timeout, floor, ceiling);
+}
+
+static int rtt_timeout(struct usb_cas *cas, int endpoint)
+{
+	return __rtt_timeout(rtt_of(cas, endpoint), rtt_mode(cas), endpoint);
+}
+
+static void rtt_sample(struct usb_cas *cas, int endpoint, ktime_t start, int result, int timeout)
+{
+	struct cas_rtt *rtt = rtt_of(cas, endpoint);
+	s32 sample, delta;
+
+	/* a timeout only tells the answer takes longer, it backs the estimate off */
+	if (result == -ETIMEDOUT)
+		sample = timeout * USEC_PER_MSEC;
+	else if (result < 0)
+		return;
+	else
+		sample = ktime_us_delta(ktime_get(), start);
+
+	if (!rtt->samples++) {
+		rtt->srtt = sample;
+		rtt->rttvar = sample / 2;
+		return;
+	}
+
+	delta = sample - (s32)rtt->srtt;
+	rtt->srtt += delta / 8;
+	rtt->rttvar += (abs(delta) - (s32)rtt->rttvar) / 4;
+}
+
 static int vendor_command_snd(struct usb_cas *cas, unsigned char request, int address, int index, const char *buf, int size)
 {
-	int result;
+	int result, timeout;
+	ktime_t start;
 	unsigned char *buffer = kmemdup(buf, size, GFP_KERNEL);
 
 	if (!buffer) {
@@ -106,7 +235,10 @@ static int vendor_command_snd(struct usb_cas *cas, unsigned char request, int ad
 	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_IN && debug != SIMPLE_DEBUG_IN) && buffer != NULL)
 		dump_buffer(cas, buffer, "data_out", size);
 
-	result = usb_control_msg(cas->udevice, usb_sndctrlpipe(cas->udevice, 0), request, USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buffer, size, 3000);
+	timeout = rtt_timeout(cas, RTT_CONTROL);
+	start = ktime_get();
+	result = usb_control_msg(cas->udevice, usb_sndctrlpipe(cas->udevice, 0), request, USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buffer, size, timeout);
+	rtt_sample(cas, RTT_CONTROL, start, result, timeout);
 
 	mutex_unlock(&cas->lock);
 
@@ -117,11 +249,15 @@ static int vendor_command_snd(struct usb_cas *cas, unsigned char request, int ad
 
 static int vendor_command_rcv(struct usb_cas *cas, unsigned char request, int address, int index, char *buf, int size)
 {
-	int result;
+	int result, timeout;
+	ktime_t start;
 
 	mutex_lock(&cas->lock);
 
-	result = usb_control_msg(cas->udevice, usb_rcvctrlpipe(cas->udevice, 0), request, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buf, size, 3000);
+	timeout = rtt_timeout(cas, RTT_CONTROL);
+	start = ktime_get();
+	result = usb_control_msg(cas->udevice, usb_rcvctrlpipe(cas->udevice, 0), request, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buf, size, timeout);
+	rtt_sample(cas, RTT_CONTROL, start, result, timeout);
 
 	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
 		dump_buffer(cas, buf, "data_in", size);
@@ -131,18 +267,137 @@ static int vendor_command_rcv(struct usb_cas *cas, unsigned char request, int ad
 	return result;
 }
 
-static int bulk_command_snd(struct usb_cas *cas, const char *buf, int size, int count)
+static int bulk_packet_size(struct usb_cas *cas, const struct usb_endpoint_descriptor *endpoint)
 {
-	int result;
-	unsigned char tmp[64];
-	unsigned char *buffer;
+	int size = usb_endpoint_maxp(endpoint);
+
+	/* fall back to what the link allows if the descriptor makes no sense */
+	if (size <= 0 || size > MAX_HS_PKT_SIZE)
+		size = cas->udevice->speed >= USB_SPEED_HIGH ? MAX_HS_PKT_SIZE : MAX_PKT_SIZE;
 
-	if (size < MAX_PKT_SIZE) {
-		memset(tmp, 0x00, MAX_PKT_SIZE);
-		memcpy(tmp, buf, size);
-		buffer = kmemdup(tmp, MAX_PKT_SIZE, GFP_KERNEL);
+	return size;
+}
+
+static void recovery_done(struct usb_cas *cas, int rung)
+{
+	cas->recovery.count[rung]++;
+	cas->recovery.time_ns += ktime_to_ns(ktime_sub(ktime_get(), cas->recover_start));
+	cas->recover_rung = RECOVER_CLEAR_HALT;
+}
+
+/*
+ * A bulk endpoint that keeps failing climbs a recovery ladder: clear the
+ * halt, then reset the whole device. A stall takes the next rung at once
+ * and the transfer is repeated once the halt is cleared, the stall refused
+ * it. A read timing out is no fault, there may be no card or nothing to
+ * say yet. Writes take a rung after RECOVER_OUT_TIMEOUTS timeouts in a row
+ * and are not repeated, they may already be in the device. A transfer that
+ * goes through ends the climb.
+ * Called with cas->lock held after every bulk transfer, returns 1 when the
+ * transfer should be repeated. The caller resets the device when *reset
+ * is set.
+ */
+static int recover_endpoint(struct usb_cas *cas, unsigned int pipe, int result, ktime_t start, int *reset)
+{
+	if (result == -ETIMEDOUT && usb_pipeout(pipe) && ++cas->out_timeouts >= RECOVER_OUT_TIMEOUTS)
+		cas->out_timeouts = 0;
+	else if (result != -EPIPE) {
+		if (result >= 0 && usb_pipeout(pipe))
+			cas->out_timeouts = 0;
+		if (result >= 0 && cas->recover_rung == RECOVER_RESET_DEVICE)
+			recovery_done(cas, RECOVER_CLEAR_HALT);
+		return 0;
+	}
+
+	/* the device is being reset already */
+	if (cas->recover_rung == RECOVER_RUNGS)
+		return 0;
+
+	if (cas->recover_rung == RECOVER_RESET_DEVICE) {
+		cas->recover_rung = RECOVER_RUNGS;
+		*reset = 1;
+		return 0;
+	}
+
+	dev_dbg(&cas->uinterface->dev, "%s: endpoint 0x%02x failed with %d, clearing the halt\n", __func__, usb_pipeendpoint(pipe), result);
+	cas->recover_start = start;
+	usb_clear_halt(cas->udevice, pipe);
+	cas->recover_rung = RECOVER_RESET_DEVICE;
+
+	return result == -EPIPE;
+}
+
+/* the caller holds cas->lock */
+static int bulk_transfer(struct usb_cas *cas, unsigned int pipe, char *buf, int size, int *actual, int *reset)
+{
+	int endpoint = usb_pipein(pipe) ? RTT_BULK_IN : RTT_BULK_OUT;
+	int result, timeout;
+	ktime_t start;
+
+	do {
+		timeout = rtt_timeout(cas, endpoint);
+		start = ktime_get();
+		result = usb_bulk_msg(cas->udevice, pipe, buf, size, actual, timeout);
+		rtt_sample(cas, endpoint, start, result, timeout);
+	} while (recover_endpoint(cas, pipe, result, start, reset));
+
+	return result;
+}
+
+/*
+ * Last rung, taken without cas->lock: pre_reset takes it to keep transfers
+ * off the bus. The firmware in ram may not survive the reset, the running
+ * mode is loaded again. The transfer that failed is not repeated, whatever
+ * it was part of is gone with the reset.
+ */
+static void recover_device(struct usb_cas *cas)
+{
+	int result, mode = cas->status;
+
+	dev_warn(&cas->uinterface->dev, "%s not answering, resetting the device\n", cas->device_name);
+
+	result = usb_lock_device_for_reset(cas->udevice, cas->uinterface);
+	if (!result) {
+		result = usb_reset_device(cas->udevice);
+		usb_unlock_device(cas->udevice);
+	}
+	/* whatever ran before the reset can't be trusted to still be there */
+	cas->fw_name = NULL;
+	if (!result && mode > START)
+		result = cas_set_mode(cas, mode);
+
+	mutex_lock(&cas->lock);
+	if (result) {
+		dev_err(&cas->uinterface->dev, "%s reset failed, result = %d\n", cas->device_name, result);
+		cas->recovery.failed++;
+		cas->recover_rung = RECOVER_CLEAR_HALT;
 	} else
-		buffer = kmemdup(buf, size, GFP_KERNEL);
+		recovery_done(cas, RECOVER_RESET_DEVICE);
+	mutex_unlock(&cas->lock);
+}
+
+static void recover_work(struct work_struct *work)
+{
+	struct usb_cas *cas = container_of(work, struct usb_cas, recover_work);
+
+	recover_device(cas);
+}
+
+/* the reset sleeps for seconds, contexts that can't wait that long hand it off */
+static void recover_schedule(struct usb_cas *cas)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cas->event_lock, flags);
+	if (!cas->disconnected)
+		schedule_work(&cas->recover_work);
+	spin_unlock_irqrestore(&cas->event_lock, flags);
+}
+
+static int bulk_command_snd(struct usb_cas *cas, const char *buf, int size, int count)
+{
+	int result, reset = 0;
+	unsigned char *buffer = kmemdup(buf, size, GFP_KERNEL);
 
 	if (!buffer) {
 		dev_err(&cas->uinterface->dev, "%s: kmalloc(%d) failed\n", __func__, size);
@@ -152,49 +407,274 @@ static int bulk_command_snd(struct usb_cas *cas, const char *buf, int size, int
 	mutex_lock(&cas->lock);
 
 	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_IN && debug != SIMPLE_DEBUG_IN) && buffer != NULL)
-		dump_buffer(cas, buffer, "data_out", MAX_PKT_SIZE);
+		dump_buffer(cas, buffer, "data_out", size);
 
-	result = usb_bulk_msg(cas->udevice, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), buffer, size, NULL, 1000);
+	result = bulk_transfer(cas, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), buffer, size, NULL, &reset);
+	cas->tx_stamp = ktime_get();
 
 	mutex_unlock(&cas->lock);
 
+	if (reset)
+		recover_device(cas);
+
 	if (buffer)
 		kfree (buffer);
 	return result;
 }
 
+/* the caller holds cas->lock */
+static int __bulk_command_rcv(struct usb_cas *cas, char *buf, int size, int timeout)
+{
+	int result, actual = 0;
+
+	result = usb_bulk_msg(cas->udevice, usb_rcvbulkpipe(cas->udevice, cas->bulk_in_endpointAddr), buf, size, &actual, timeout);
+
+	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
+		dump_buffer(cas, buf, "data_in", actual);
+
+	return result < 0 ? result : actual;
+}
+
 static int bulk_command_rcv(struct usb_cas *cas, char *buf, int size, int count)
 {
-	int result;
+	int result, actual = 0, reset = 0;
 
 	mutex_lock(&cas->lock);
+	result = bulk_transfer(cas, usb_rcvbulkpipe(cas->udevice, cas->bulk_in_endpointAddr), buf, size, &actual, &reset);
+	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
+		dump_buffer(cas, buf, "data_in", actual);
+	mutex_unlock(&cas->lock);
 
-	result = usb_bulk_msg(cas->udevice, usb_rcvbulkpipe(cas->udevice, cas->bulk_in_endpointAddr), buf, size, NULL, 1000);
+	if (reset)
+		recover_device(cas);
 
-	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
-		dump_buffer(cas, buf, "data_in", MAX_PKT_SIZE);
+	return result < 0 ? result : actual;
+}
+
+static void stamp_callback(struct urb *urb)
+{
+	struct cas_stamp *stamp = urb->context;
+
+	stamp->time = ktime_get();
+	complete(&stamp->done);
+}
+
+/* like __bulk_command_rcv(), but reports when the urb actually completed */
+static int __bulk_command_rcv_stamped(struct usb_cas *cas, char *buf, int size, int timeout, ktime_t *time)
+{
+	struct cas_stamp stamp;
+	struct urb *urb;
+	int result;
+
+	urb = usb_alloc_urb(0, GFP_KERNEL);
+	if (!urb)
+		return -ENOMEM;
+
+	init_completion(&stamp.done);
+	usb_fill_bulk_urb(urb, cas->udevice, usb_rcvbulkpipe(cas->udevice, cas->bulk_in_endpointAddr), buf, size, stamp_callback, &stamp);
+
+	result = usb_submit_urb(urb, GFP_KERNEL);
+	if (!result) {
+		if (!wait_for_completion_timeout(&stamp.done, msecs_to_jiffies(timeout))) {
+			usb_kill_urb(urb);
+			result = -ETIMEDOUT;
+		} else
+			result = urb->status ? urb->status : urb->actual_length;
+		*time = stamp.time;
+	}
+	usb_free_urb(urb);
+
+	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && result > 0)
+		dump_buffer(cas, buf, "data_in", result);
+
+	return result;
+}
+
+static void sg_poll(struct work_struct *work)
+{
+	struct cas_sg_wait *wait = container_of(to_delayed_work(work), struct cas_sg_wait, poll);
+	size_t bytes = READ_ONCE(wait->io.bytes);
+
+	/* every urb that completes starts the timeout over */
+	if (bytes != wait->bytes) {
+		wait->bytes = bytes;
+		wait->deadline = jiffies + wait->timeout;
+	}
+
+	if (signal_pending(wait->task))
+		wait->status = -EINTR;
+	else if (time_after(jiffies, wait->deadline))
+		wait->status = -ETIMEDOUT;
+	else {
+		schedule_delayed_work(&wait->poll, msecs_to_jiffies(SG_POLL_MS));
+		return;
+	}
+
+	usb_sg_cancel(&wait->io);
+}
+
+/*
+ * usb_sg_wait() sleeps uninterruptibly until every urb is back, so a poll
+ * cancels the request when it makes no progress for timeout ms or the
+ * caller gets a signal. Data already moved is reported, not the error.
+ */
+static int sg_wait(struct cas_sg_wait *wait, int timeout)
+{
+	wait->task = current;
+	wait->timeout = msecs_to_jiffies(timeout);
+	wait->deadline = jiffies + wait->timeout;
+	wait->bytes = 0;
+	wait->status = 0;
+
+	INIT_DELAYED_WORK_ONSTACK(&wait->poll, sg_poll);
+	schedule_delayed_work(&wait->poll, msecs_to_jiffies(SG_POLL_MS));
+	usb_sg_wait(&wait->io);
+	cancel_delayed_work_sync(&wait->poll);
+	destroy_delayed_work_on_stack(&wait->poll);
+
+	if (wait->status)
+		return wait->io.bytes ? wait->io.bytes : wait->status;
+
+	return wait->io.status ? wait->io.status : wait->io.bytes;
+}
+
+static struct mutex *channel_lock(struct usb_cas *cas, int channel)
+{
+	/* channel 0 shares its lock with the command path */
+	return channel ? &cas->channel[channel].lock : &cas->lock;
+}
+
+/*
+ * Move a user buffer of any size in one scatter-gather request. The pages
+ * are pinned for the duration of the transfer, so the controller reads or
+ * writes user memory directly.
+ */
+static int bulk_command_user(struct usb_cas *cas, int channel, int dir_in, __u64 user_buffer, __u32 length)
+{
+	struct cas_channel *ch = &cas->channel[channel];
+	unsigned long start = (unsigned long)u64_to_user_ptr(user_buffer);
+	unsigned int offset = offset_in_page(start);
+	int npages = DIV_ROUND_UP(offset + length, PAGE_SIZE);
+	int endpoint = dir_in ? RTT_BULK_IN : RTT_BULK_OUT;
+	unsigned int pipe;
+	struct cas_sg_wait wait;
+	struct sg_table table;
+	struct page **pages;
+	int pinned, result, timeout, reset = 0;
+	ktime_t began;
+
+	pages = kvmalloc_array(npages, sizeof(struct page *), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	pinned = pin_user_pages_fast(start & PAGE_MASK, npages, dir_in ? FOLL_WRITE : 0, pages);
+	if (pinned != npages) {
+		result = pinned < 0 ? pinned : -EFAULT;
+		goto unpin;
+	}
+
+	result = sg_alloc_table_from_pages(&table, pages, npages, offset, length, GFP_KERNEL);
+	if (result)
+		goto unpin;
+
+	if (dir_in)
+		pipe = usb_rcvbulkpipe(cas->udevice, ch->bulk_in_endpointAddr);
+	else
+		pipe = usb_sndbulkpipe(cas->udevice, ch->bulk_out_endpointAddr);
+
+	mutex_lock(channel_lock(cas, channel));
+	timeout = rtt_timeout(cas, endpoint);
+	began = ktime_get();
+	result = usb_sg_init(&wait.io, cas->udevice, pipe, 0, table.sgl, table.nents, length, GFP_KERNEL);
+	if (!result) {
+		result = sg_wait(&wait, timeout);
+		if (!dir_in)
+			cas->tx_stamp = ktime_get();
+	}
+	mutex_unlock(channel_lock(cas, channel));
 
+	/* a long transfer says nothing about the response time, its timeout does */
+	mutex_lock(&cas->lock);
+	if (length <= MAX_WRITE_URB_SIZE || result == -ETIMEDOUT)
+		rtt_sample(cas, endpoint, began, result, timeout);
+	recover_endpoint(cas, pipe, result, began, &reset);
 	mutex_unlock(&cas->lock);
 
+	if (reset)
+		recover_device(cas);
+
+	sg_free_table(&table);
+unpin:
+	if (pinned > 0)
+		unpin_user_pages_dirty_lock(pages, pinned, dir_in && result > 0);
+	kvfree(pages);
+
 	return result;
 }
 
-static int read_eeprom(struct usb_cas *cas,unsigned char *buf, int len, int offset)
+static int eeprom_size(struct usb_cas *cas)
 {
-	int i, result;
-	char *v, br[2];
-	for (i=0; i < len; i++) {
-		v = offset + i;
-		result = vendor_command_rcv(cas, 0xA2, 0, 0, v, 2);
-		if (result)
-			return result;
+	/* fx1 boards carry a single byte addressed eeprom, fx2 boards a 24lc64 */
+	return cas->device_running == CAS2_DEVICE ? EEPROM_SMALL_SIZE : EEPROM_LARGE_SIZE;
+}
+
+static int eeprom_request(struct usb_cas *cas)
+{
+	return cas->device_running == CAS2_DEVICE ? EEPROM_SMALL_REQUEST : EEPROM_LARGE_REQUEST;
+}
+
+static int read_eeprom(struct usb_cas *cas, unsigned char *buf, int len, int offset)
+{
+	int result = 0, chunk, done;
+	unsigned char *page;
+
+	if (offset < 0 || len < 0 || offset + len > eeprom_size(cas))
+		return -EINVAL;
+
+	page = kmalloc(EEPROM_READ_SIZE, GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	for (done = 0; done < len; done += chunk) {
+		chunk = MIN(len - done, EEPROM_READ_SIZE);
+		result = vendor_command_rcv(cas, eeprom_request(cas), offset + done, 0, (char *)page, chunk);
+		if (result < 0)
+			goto out;
+		if (result != chunk) {
+			result = -EIO;
+			goto out;
+		}
 
-		buf[i] = br[1];
+		memcpy(buf + done, page, chunk);
 	}
-	dev_info(&cas->uinterface->dev, "read eeprom (offset: 0x%x, len: %d) : ", offset, i);
+	result = done;
+	dev_dbg(&cas->uinterface->dev, "read eeprom (offset: 0x%x, len: %d)\n", offset, done);
+out:
+	kfree(page);
 	return result;
 }
 
+static int write_eeprom(struct usb_cas *cas, const unsigned char *buf, int len, int offset)
+{
+	int result = 0, chunk, done;
+
+	if (offset < 0 || len < 0 || offset + len > eeprom_size(cas))
+		return -EINVAL;
+
+	/* a page write must not cross a page boundary of the eeprom */
+	for (done = 0; done < len; done += chunk) {
+		chunk = MIN(len - done, EEPROM_PAGE_SIZE - ((offset + done) % EEPROM_PAGE_SIZE));
+		result = vendor_command_snd(cas, eeprom_request(cas), offset + done, 0, (const char *)buf + done, chunk);
+		if (result < 0)
+			return result;
+		if (result != chunk)
+			return -EIO;
+	}
+	dev_dbg(&cas->uinterface->dev, "write eeprom (offset: 0x%x, len: %d)\n", offset, done);
+
+	return done;
+}
+
 static int device_verification(struct usb_cas *cas, int type)
 {
 	int result;
@@ -228,53 +708,388 @@ static int device_verification(struct usb_cas *cas, int type)
 		}
 	}
 
-	if (result < 0)
-		dev_err(&cas->uinterface->dev, "Error, not allowed set to %s mode for %s device\n", cas_device_status[type], cas->device_name);
+	if (result < 0)
+		dev_err(&cas->uinterface->dev, "Error, not allowed set to %s mode for %s device\n", cas_device_status[type], cas->device_name);
+
+	return result;
+}
+
+static void batch_callback(struct urb *urb)
+{
+	struct cas_batch *batch = urb->context;
+
+	if (urb->status)
+		cmpxchg(&batch->status, 0, urb->status);
+
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+static struct urb *batch_urb(struct usb_cas *cas, struct cas_batch *batch, unsigned int pipe, const __u8 *data, int size)
+{
+	struct urb *urb;
+	unsigned char *buffer;
+
+	urb = usb_alloc_urb(0, GFP_KERNEL);
+	if (!urb)
+		return NULL;
+
+	buffer = data ? kmemdup(data, size, GFP_KERNEL) : kzalloc(size, GFP_KERNEL);
+	if (!buffer) {
+		usb_free_urb(urb);
+		return NULL;
+	}
+
+	usb_fill_bulk_urb(urb, cas->udevice, pipe, buffer, size, batch_callback, batch);
+	urb->transfer_flags |= URB_FREE_BUFFER;
+
+	return urb;
+}
+
+/*
+ * Submit count urbs of one batch and wait until all of them completed. The
+ * responses are expected first in urbs, so they are queued before any
+ * request goes out. The caller holds cas->lock.
+ */
+static int batch_submit(struct usb_cas *cas, struct cas_batch *batch, struct urb **urbs, int count, int timeout)
+{
+	struct usb_anchor anchor;
+	int i, result;
+
+	init_usb_anchor(&anchor);
+	init_completion(&batch->done);
+	atomic_set(&batch->pending, count);
+	batch->status = 0;
+
+	for (i = 0; i < count; i++) {
+		if ((debug != DEBUG_NONE && debug != FULL_DEBUG_IN && debug != SIMPLE_DEBUG_IN) && usb_pipeout(urbs[i]->pipe))
+			dump_buffer(cas, urbs[i]->transfer_buffer, "data_out", urbs[i]->transfer_buffer_length);
+
+		usb_anchor_urb(urbs[i], &anchor);
+		result = usb_submit_urb(urbs[i], GFP_KERNEL);
+		if (result) {
+			usb_unanchor_urb(urbs[i]);
+			dev_err(&cas->uinterface->dev, "%s: failed submitting urb, error %d\n", __func__, result);
+			usb_kill_anchored_urbs(&anchor);
+			return result;
+		}
+	}
+
+	if (!wait_for_completion_timeout(&batch->done, msecs_to_jiffies(timeout))) {
+		usb_kill_anchored_urbs(&anchor);
+		return -ETIMEDOUT;
+	}
+
+	for (i = 0; i < count; i++) {
+		if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && usb_pipein(urbs[i]->pipe))
+			dump_buffer(cas, urbs[i]->transfer_buffer, "data_in", urbs[i]->actual_length);
+	}
+
+	return batch->status;
+}
+
+/*
+ * Pipeline count records, an opt-in through batch_records. Every response
+ * urb is queued before the first record goes out, but each record still
+ * travels in its own packet and the firmware answers each one on its own,
+ * this saves host round trips, not transfers. The responses are not looked
+ * at, like in the one by one path. A stall or a timeout climbs the recovery
+ * ladder; the round trip of a single record can't be told apart in a
+ * pipeline, so no rtt sample is taken.
+ */
+static int send_record_batch(struct usb_cas *cas, const __u8 *record, int count)
+{
+	struct cas_batch batch;
+	struct urb **urbs;
+	int i, result = 0, reset = 0;
+	ktime_t start;
+
+	urbs = kcalloc(2 * count, sizeof(struct urb *), GFP_KERNEL);
+	if (!urbs)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++, record = cas_record_next(record)) {
+		urbs[i] = batch_urb(cas, &batch, usb_rcvbulkpipe(cas->udevice, cas->bulk_in_endpointAddr), NULL, cas->bulk_in_maxp);
+		urbs[count + i] = batch_urb(cas, &batch, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), &record[1], record[0]);
+		if (!urbs[i] || !urbs[count + i]) {
+			result = -ENOMEM;
+			goto free;
+		}
+	}
+
+	mutex_lock(&cas->lock);
+	/* the responses come one after the other, each may take a round trip */
+	start = ktime_get();
+	result = batch_submit(cas, &batch, urbs, 2 * count, rtt_timeout(cas, RTT_BULK_IN) * count);
+	recover_endpoint(cas, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), result, start, &reset);
+	mutex_unlock(&cas->lock);
+
+	if (reset)
+		recover_device(cas);
+free:
+	for (i = 0; i < 2 * count; i++)
+		usb_free_urb(urbs[i]);
+	kfree(urbs);
+
+	return result;
+}
+
+static int jtag_payload(const struct cas_jtag_scan *scan)
+{
+	if (scan->type == JTAG_SCAN_IR || scan->type == JTAG_SCAN_DR || scan->type == JTAG_SCAN_TMS)
+		return DIV_ROUND_UP(scan->bits, 8);
+
+	return 0;
+}
+
+static int jtag_captured(const struct cas_jtag_scan *scan)
+{
+	return (scan->flags & JTAG_SCAN_CAPTURE) ? DIV_ROUND_UP(scan->bits, 8) : 0;
+}
+
+static int jtag_valid(const struct cas_jtag_scan *scan, __u32 vectors_length)
+{
+	u64 bytes = DIV_ROUND_UP((u64)scan->bits, 8);
+
+	if (scan->type < JTAG_SCAN_IR || scan->type > JTAG_SCAN_RUN || scan->reserved || scan->end_state > JTAG_STATE_IRUPDATE)
+		return 0;
+	if (scan->flags & ~(JTAG_SCAN_CAPTURE | JTAG_SCAN_COMPARE))
+		return 0;
+	if (scan->type == JTAG_SCAN_STATE || scan->type == JTAG_SCAN_RUN)
+		return !scan->flags;
+
+	if (!scan->bits || bytes > JTAG_MAX_SCAN_BYTES)
+		return 0;
+	if (scan->type == JTAG_SCAN_TMS)
+		return !scan->flags && scan->tms + bytes <= vectors_length;
+	if ((scan->flags & JTAG_SCAN_COMPARE) && (!(scan->flags & JTAG_SCAN_CAPTURE) || scan->tdo + bytes > vectors_length || scan->mask + bytes > vectors_length))
+		return 0;
+
+	return scan->tdi + bytes <= vectors_length;
+}
+
+static int jtag_encode(__u8 *packet, const struct cas_jtag_scan *scan, const __u8 *vectors)
+{
+	int bytes = jtag_payload(scan);
+
+	packet[0] = scan->type | ((scan->flags & JTAG_SCAN_CAPTURE) ? JTAG_WIRE_CAPTURE : 0);
+	packet[1] = scan->end_state;
+	packet[2] = scan->bits;
+	packet[3] = scan->bits >> 8;
+	packet[4] = scan->bits >> 16;
+	packet[5] = scan->bits >> 24;
+	if (bytes)
+		memcpy(packet + JTAG_HEADER_SIZE, vectors + (scan->type == JTAG_SCAN_TMS ? scan->tms : scan->tdi), bytes);
+
+	return JTAG_HEADER_SIZE + bytes;
+}
+
+static int jtag_match(const struct cas_jtag_scan *scan, const __u8 *vectors, const __u8 *tdo)
+{
+	int i, bytes = DIV_ROUND_UP(scan->bits, 8);
+	__u8 mask;
+
+	for (i = 0; i < bytes; i++) {
+		mask = vectors[scan->mask + i];
+		/* bits past the end of the scan were never shifted */
+		if (i == bytes - 1 && scan->bits % 8)
+			mask &= (1 << (scan->bits % 8)) - 1;
+		if ((tdo[i] ^ vectors[scan->tdo + i]) & mask)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* send one window of encoded scans, the urbs collecting its tdo are queued first */
+static int jtag_window(struct usb_cas *cas, const __u8 *stream, int length, __u8 *tdo, int captured)
+{
+	struct cas_batch batch;
+	struct urb *urbs[2 * JTAG_WINDOW_URBS];
+	int i, in, done, count = 0, result = 0;
+
+	for (done = 0; done < captured; done += JTAG_URB_SIZE) {
+		urbs[count] = batch_urb(cas, &batch, usb_rcvbulkpipe(cas->udevice, cas->bulk_in_endpointAddr), NULL, MIN(captured - done, JTAG_URB_SIZE));
+		if (!urbs[count]) {
+			result = -ENOMEM;
+			goto free;
+		}
+		count++;
+	}
+	in = count;
+
+	for (done = 0; done < length; done += JTAG_URB_SIZE) {
+		urbs[count] = batch_urb(cas, &batch, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), stream + done, MIN(length - done, JTAG_URB_SIZE));
+		if (!urbs[count]) {
+			result = -ENOMEM;
+			goto free;
+		}
+		count++;
+	}
+
+	result = batch_submit(cas, &batch, urbs, count, JTAG_TIMEOUT);
+	if (result < 0)
+		goto free;
+	cas->tx_stamp = ktime_get();
+
+	for (i = 0, done = 0; i < in; i++) {
+		if (urbs[i]->actual_length != urbs[i]->transfer_buffer_length) {
+			result = -EIO;
+			goto free;
+		}
+		memcpy(tdo + done, urbs[i]->transfer_buffer, urbs[i]->actual_length);
+		done += urbs[i]->actual_length;
+	}
+free:
+	for (i = 0; i < count; i++)
+		usb_free_urb(urbs[i]);
+
+	return result;
+}
+
+/*
+ * Run a list of scan operations through the jtag firmware. The scans are
+ * packed back to back into windows of JTAG_WINDOW_SIZE bytes, so the bulk
+ * packets are full whatever the size of the single scans. A window goes out
+ * in one batch, and the scans stop after the window holding the first
+ * mismatch.
+ */
+static int jtag_scan(struct usb_cas *cas, struct cas_jtag_command *cmd)
+{
+	struct cas_jtag_scan *scans;
+	__u8 *vectors, *tdo = NULL, *stream = NULL;
+	int i, j, first, length, captured, offset, total = 0, result = 0;
+
+	if (cas->status != JTAG) {
+		dev_err(&cas->uinterface->dev, "%s is not in jtag mode\n", cas->device_name);
+		return -EPERM;
+	}
+
+	scans = vmemdup_user(u64_to_user_ptr(cmd->scans), cmd->count * sizeof(struct cas_jtag_scan));
+	if (IS_ERR(scans))
+		return PTR_ERR(scans);
+
+	vectors = vmemdup_user(u64_to_user_ptr(cmd->vectors), cmd->vectors_length);
+	if (IS_ERR(vectors)) {
+		result = PTR_ERR(vectors);
+		vectors = NULL;
+		goto free;
+	}
+
+	for (i = 0; i < cmd->count; i++) {
+		if (!jtag_valid(&scans[i], cmd->vectors_length)) {
+			dev_dbg(&cas->uinterface->dev, "invalid jtag scan %d\n", i);
+			result = -EINVAL;
+			goto free;
+		}
+		total += jtag_captured(&scans[i]);
+	}
+	if (total > cmd->tdo_length) {
+		result = -EINVAL;
+		goto free;
+	}
+
+	tdo = kvmalloc(total ? total : 1, GFP_KERNEL);
+	stream = kmalloc(JTAG_WINDOW_SIZE, GFP_KERNEL);
+	if (!tdo || !stream) {
+		result = -ENOMEM;
+		goto free;
+	}
+
+	cmd->failed = cmd->count;
+	cmd->tdo_length = 0;
+
+	mutex_lock(&cas->lock);
+
+	for (first = 0; first < cmd->count && cmd->failed == cmd->count; first = i) {
+		/* a single scan always fits, JTAG_MAX_SCAN_BYTES is half a window */
+		for (i = first, length = 0, captured = 0; i < cmd->count && length + JTAG_HEADER_SIZE + jtag_payload(&scans[i]) <= JTAG_WINDOW_SIZE; i++) {
+			length += jtag_encode(stream + length, &scans[i], vectors);
+			captured += jtag_captured(&scans[i]);
+		}
+
+		result = jtag_window(cas, stream, length, tdo + cmd->tdo_length, captured);
+		if (result < 0)
+			break;
+
+		for (j = first, offset = cmd->tdo_length; j < i; offset += jtag_captured(&scans[j]), j++) {
+			if ((scans[j].flags & JTAG_SCAN_COMPARE) && !jtag_match(&scans[j], vectors, tdo + offset)) {
+				cmd->failed = j;
+				break;
+			}
+		}
+		cmd->tdo_length += captured;
+
+		if (fatal_signal_pending(current)) {
+			result = -EINTR;
+			break;
+		}
+	}
+
+	mutex_unlock(&cas->lock);
+
+	if (cmd->tdo_length && copy_to_user(u64_to_user_ptr(cmd->tdo), tdo, cmd->tdo_length))
+		result = -EFAULT;
+free:
+	kfree(stream);
+	kvfree(tdo);
+	kvfree(vectors);
+	kvfree(scans);
 
 	return result;
 }
 
 static int send_command(struct usb_cas *cas, int id)
 {
-	int i, result;
-	const struct cas_hex_record *record = NULL;
+	int count, result;
+	const __u8 *record = NULL, *next;
 
 	if (id == START) {
 		if (cas->device_running == CAS2_DEVICE)
-			record = &cas2_init_code[0];
+			record = cas2_init_code;
 		else if (cas->device_running == CAS2_PLUS_DEVICE)
-			record = &cas2_plus_init_code[0];
+			record = cas2_plus_init_code;
                 else if (cas->device_running == CAS2_PLUS2_DEVICE)
-                        record = &cas2_plus2_init_code[0];
+                        record = cas2_plus2_init_code;
                 else if (cas->device_running == CAS2_PLUS2_CRYPTO_DEVICE)
-                        record = &cas2_plus2_crypto_plus_init_code[0];
+                        record = cas2_plus2_crypto_plus_init_code;
 	} else if (id == PHOENIX_357)
-		record = &phoenix_357_code[0];
+		record = phoenix_357_code;
 	else if (id == PHOENIX_368)
-		record = &phoenix_368_code[0];
+		record = phoenix_368_code;
 	else if (id == PHOENIX_400)
-		record = &phoenix_400_code[0];
+		record = phoenix_400_code;
 	else if (id == PHOENIX_600)
-		record = &phoenix_600_code[0];
+		record = phoenix_600_code;
 	else if (id == SMARTMOUSE_357)
-		record = &smartmouse_357_code[0];
+		record = smartmouse_357_code;
 	else if (id == SMARTMOUSE_368)
-		record = &smartmouse_368_code[0];
+		record = smartmouse_368_code;
 	else if (id == SMARTMOUSE_400)
-		record = &smartmouse_400_code[0];
+		record = smartmouse_400_code;
 	else if (id == SMARTMOUSE_600)
-		record = &smartmouse_600_code[0];
+		record = smartmouse_600_code;
 	else if (id == HOST)
-		record = &cam_host_code[0];
-
-	while(record->data_size != 0) {
-		result = bulk_command_snd(cas, (unsigned char *)record->data, record->data_size, 0);
-		result = bulk_command_rcv(cas, cas->bulk_in_buffer, MAX_PKT_SIZE, 0);
+		record = cam_host_code;
+
+	if (!record)
+		return -EINVAL;
+
+	while (record[0] != 0) {
+		if (batch_records > 1) {
+			for (next = record, count = 0; next[0] != 0 && count < batch_records; count++)
+				next = cas_record_next(next);
+
+			result = send_record_batch(cas, record, count);
+			record = next;
+		} else {
+			result = bulk_command_snd(cas, (const char *)&record[1], record[0], 0);
+			result = bulk_command_rcv(cas, cas->bulk_in_buffer, cas->bulk_in_maxp, 0);
+			record = cas_record_next(record);
+		}
 
 		if (result < 0)
 			goto out;
-
-		record++;
 	}
 
 	return 0;
@@ -332,23 +1147,26 @@ static int send_host_command(struct usb_cas *cas)
 	return send_command(cas, HOST);
 }
 
-static int cas_firmware_load(struct usb_cas *cas, int id, int reset_cpu)
+/* the image is read once, for the hash and for the download */
+static int cas_firmware_request(struct usb_cas *cas, const char *fw_name, const struct firmware **firmware, u32 *fw_hash)
 {
-	int response = -ENOENT;
-	const char *fw_name;
+	int result;
 
-	dev_dbg(&cas->uinterface->dev, "%s: sending %s...", __func__, fw_name);
+	result = request_ihex_firmware(firmware, fw_name, &cas->udevice->dev);
+	if (result < 0)
+		return result;
 
-	if (reset_cpu != NO_RESET_CPU) {
-		dev_dbg(&cas->uinterface->dev, "%s reset cpu\n", cas->device_name);
-		if (cas->device_running == CAS2_DEVICE)
-			response = ezusb_fx1_set_reset(cas->udevice, 1);
-		else if (cas->device_running == CAS2_PLUS_DEVICE || cas->device_running == CAS2_PLUS2_DEVICE || cas->device_running == CAS2_PLUS2_CRYPTO_DEVICE)
-			response = ezusb_fx2_set_reset(cas->udevice, 1);
-	}
+	*fw_hash = crc32_le(~0, (*firmware)->data, (*firmware)->size);
 
-	if (response < 0)
-		goto out;
+	return 0;
+}
+
+static int cas_firmware_load(struct usb_cas *cas, int id, int reset_cpu)
+{
+	int response = -ENOENT;
+	const char *fw_name = NULL;
+	const struct firmware *firmware = NULL;
+	u32 fw_hash;
 
 	if (0) { ; }
 	else if (le16_to_cpu(id) == VEND_AX) {
@@ -467,19 +1285,56 @@ static int cas_firmware_load(struct usb_cas *cas, int id, int reset_cpu)
 		goto out;
 	}
 
+	if (!fw_name) {
+		dev_err(&cas->uinterface->dev, "%s: no %s firmware for %s device\n",
+			__func__, cas_device_status[id], cas->device_name);
+		goto out;
+	}
+
+	if (cas_firmware_request(cas, fw_name, &firmware, &fw_hash) < 0) {
+		dev_err(&cas->uinterface->dev, "failed to load firmware \"%s\"\n",
+			fw_name);
+		goto out;
+	}
+
+	/* the image is already running, only the mode commands are needed */
+	if (cas->fw_name && !strcmp(cas->fw_name, fw_name) && cas->fw_hash == fw_hash) {
+		dev_dbg(&cas->uinterface->dev, "%s: %s already resident, skipping upload\n", __func__, fw_name);
+		response = 0;
+		goto finish;
+	}
+
+	dev_dbg(&cas->uinterface->dev, "%s: sending %s...", __func__, fw_name);
+
+	/* the old image is gone as soon as the download starts */
+	cas->fw_name = NULL;
+
+	if (reset_cpu != NO_RESET_CPU) {
+		dev_dbg(&cas->uinterface->dev, "%s reset cpu\n", cas->device_name);
+		if (cas->device_running == CAS2_DEVICE)
+			response = ezusb_fx1_set_reset(cas->udevice, 1);
+		else if (cas->device_running == CAS2_PLUS_DEVICE || cas->device_running == CAS2_PLUS2_DEVICE || cas->device_running == CAS2_PLUS2_CRYPTO_DEVICE)
+			response = ezusb_fx2_set_reset(cas->udevice, 1);
+	}
+
+	if (response < 0)
+		goto out;
+
 	if (cas->device_running == CAS2_DEVICE) {
-		if (ezusb_fx1_ihex_firmware_download(cas->udevice, fw_name) < 0) {
+		if (ezusb_fx1_ihex_firmware_write(cas->udevice, firmware) < 0) {
 			dev_err(&cas->uinterface->dev, "failed to load firmware \"%s\"\n",
 				fw_name);
-			return -ENOENT;
+			response = -ENOENT;
+			goto out;
 		}
 	}
 	else if (cas->device_running == CAS2_PLUS_DEVICE || cas->device_running == CAS2_PLUS2_DEVICE || cas->device_running == CAS2_PLUS2_CRYPTO_DEVICE)
 	{
-		if (ezusb_fx2_ihex_firmware_download(cas->udevice, fw_name) < 0) {
+		if (ezusb_fx2_ihex_firmware_write(cas->udevice, firmware) < 0) {
 			dev_err(&cas->uinterface->dev, "failed to load firmware \"%s\"\n",
 				fw_name);
-			return -ENOENT;
+			response = -ENOENT;
+			goto out;
 		}
 	}
 
@@ -494,6 +1349,11 @@ static int cas_firmware_load(struct usb_cas *cas, int id, int reset_cpu)
 	if (response < 0)
 		goto out;
 
+	cas->fw_name = fw_name;
+	cas->fw_hash = fw_hash;
+	response = 1;
+	event_post(cas, EVENT_RESET, 0, NULL, 0);
+finish:
 	if (cas->state == START_LOAD_VEND_AX_FW)
 		cas->state = FINISH_LOAD_VEND_AX_FW;
 	else if (cas->state == START_LOAD_START_FW)
@@ -523,8 +1383,10 @@ static int cas_firmware_load(struct usb_cas *cas, int id, int reset_cpu)
 	else if (cas->state == START_LOAD_HOST_FW)
 		cas->state = FINISH_LOAD_HOST_FW;
 
-	return 1;
+	release_firmware(firmware);
+	return response;
 out:
+	release_firmware(firmware);
 	return response;
 }
 
@@ -561,10 +1423,9 @@ static int cas_set_cam_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_CAM_FW) {
-		result = cas_firmware_load(cas, CAM, RESET_CPU);
+	result = cas_firmware_load(cas, CAM, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_cam_command(cas);
 	if (result >= 0)
@@ -577,10 +1438,9 @@ static int cas_set_mm_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MM_FW) {
-		result = cas_firmware_load(cas, MM, RESET_CPU);
+	result = cas_firmware_load(cas, MM, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_mm_command(cas);
 	if (result >= 0)
@@ -593,10 +1453,9 @@ static int cas_set_jtag_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_JTAG_FW) {
-		result = cas_firmware_load(cas, JTAG, RESET_CPU);
+	result = cas_firmware_load(cas, JTAG, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_jtag_command(cas);
 	if (result >= 0)
@@ -609,12 +1468,12 @@ static int cas_set_phoenix_357_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_357_command(cas);
+	if (result >= 0)
+		result = send_phoenix_357_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to phoenix mode 357 mhz\n", cas->device_name);
 
@@ -625,12 +1484,12 @@ static int cas_set_phoenix_368_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_368_command(cas);
+	if (result >= 0)
+		result = send_phoenix_368_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to phoenix mode 368 mhz\n", cas->device_name);
 
@@ -641,12 +1500,12 @@ static int cas_set_phoenix_400_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_400_command(cas);
+	if (result >= 0)
+		result = send_phoenix_400_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to phoenix mode 400 mhz\n", cas->device_name);
 
@@ -658,12 +1517,12 @@ static int cas_set_phoenix_600_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_600_command(cas);
+	if (result >= 0)
+		result = send_phoenix_600_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to phoenix mode 600 mhz\n", cas->device_name);
 
@@ -674,12 +1533,12 @@ static int cas_set_smartmouse_357_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_357_command(cas);
+	if (result >= 0)
+		result = send_smartmouse_357_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to smartmouse mode 357 mhz\n", cas->device_name);
 
@@ -690,12 +1549,12 @@ static int cas_set_smartmouse_368_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_368_command(cas);
+	if (result >= 0)
+		result = send_smartmouse_368_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to smartmouse mode 368 mhz\n", cas->device_name);
 
@@ -706,12 +1565,12 @@ static int cas_set_smartmouse_400_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_400_command(cas);
+	if (result >= 0)
+		result = send_smartmouse_400_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to smartmouse mode 400 mhz\n", cas->device_name);
 
@@ -722,12 +1581,12 @@ static int cas_set_smartmouse_600_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	result = cas_firmware_load(cas, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_600_command(cas);
+	if (result >= 0)
+		result = send_smartmouse_600_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to smartmouse mode 600 mhz\n", cas->device_name);
 
@@ -738,22 +1597,23 @@ static int cas_set_programmer_fw(struct usb_cas *cas)
 {
 	int result;
 
-        result = cas_firmware_load(cas, PROGRAMMER, RESET_CPU);
-	wait_for_finish(cas, WAIT_FOR_FW);
+	result = cas_firmware_load(cas, PROGRAMMER, RESET_CPU);
+	if (result > 0)
+		wait_for_finish(cas, WAIT_FOR_FW);
+
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to programmer mode\n", cas->device_name);
 
-        return result;
+	return result;
 }
 
 static int cas_set_dreambox_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_DREAMBOX_FW) {
-		result = cas_firmware_load(cas, DREAMBOX, RESET_CPU);
+	result = cas_firmware_load(cas, DREAMBOX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_dreambox_command(cas);
 	if (result >= 0)
@@ -766,10 +1626,9 @@ static int cas_set_extreme_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_EXTREME_FW) {
-		result = cas_firmware_load(cas, EXTREME, RESET_CPU);
+	result = cas_firmware_load(cas, EXTREME, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_extreme_command(cas);
 	if (result >= 0)
@@ -782,10 +1641,9 @@ static int cas_set_diablo_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_DIABLO_FW) {
-		result = cas_firmware_load(cas, DIABLO, RESET_CPU);
+	result = cas_firmware_load(cas, DIABLO, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_diablo_command(cas);
 	if (result >= 0)
@@ -798,10 +1656,9 @@ static int cas_set_dragon_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_DRAGON_FW) {
-		result = cas_firmware_load(cas, DRAGON, RESET_CPU);
+	result = cas_firmware_load(cas, DRAGON, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_dragon_command(cas);
 	if (result >= 0)
@@ -814,174 +1671,572 @@ static int cas_set_xcam_fw(struct usb_cas *cas)
 {
 	int result;
 
-	if (cas->state != FINISH_LOAD_XCAM_FW) {
-		result = cas_firmware_load(cas, XCAM, RESET_CPU);
+	result = cas_firmware_load(cas, XCAM, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(cas, WAIT_FOR_FW);
-	}
 
 	//result = send_xcam_command(cas);
 	if (result >= 0)
 		dev_info(&cas->uinterface->dev, "%s set to xcam mode\n", cas->device_name);
 
-	return result;
+	return result;
+}
+
+static int cas_set_joker_fw(struct usb_cas *cas)
+{
+	int result;
+
+	result = cas_firmware_load(cas, JOKER, RESET_CPU);
+	if (result > 0)
+		wait_for_finish(cas, WAIT_FOR_FW);
+
+	//result = send_joker_command(cas);
+	if (result >= 0)
+		dev_info(&cas->uinterface->dev, "%s set to joker mode\n", cas->device_name);
+
+	return result;
+}
+
+static int cas_set_host_fw(struct usb_cas *cas)
+{
+	int result;
+
+	result = cas_firmware_load(cas, HOST, RESET_CPU);
+	if (result > 0)
+		wait_for_finish(cas, WAIT_FOR_FW);
+
+	if (result >= 0)
+		result = send_host_command(cas);
+	if (result >= 0)
+		dev_info(&cas->uinterface->dev, "%s set to host mode\n", cas->device_name);
+
+	return result;
+}
+
+/* tell user space about a mode transition without it having to poll sysfs */
+static void mode_notify(struct usb_cas *cas, int result, s64 duration)
+{
+	char mode[32], state[32], duration_us[32];
+	char *envp[] = { mode, state, duration_us, NULL };
+
+	snprintf(mode, sizeof(mode), "MODE=%s", cas_device_status[cas->status]);
+	snprintf(state, sizeof(state), "STATE=%s", result < 0 ? "error" : "ready");
+	snprintf(duration_us, sizeof(duration_us), "DURATION_US=%lld", (long long)duration);
+
+	kobject_uevent_env(&cas->uinterface->dev.kobj, KOBJ_CHANGE, envp);
+	sysfs_notify(&cas->uinterface->dev.kobj, NULL, "status");
+}
+
+/* switch the device into one of its operating modes */
+static int cas_set_mode(struct usb_cas *cas, int mode)
+{
+	ktime_t start = ktime_get();
+	int result;
+
+	if (mode < 0 || mode >= ARRAY_SIZE(cas_device_status))
+		return -EINVAL;
+
+	if (!device_verification(cas, mode))
+		return -EPERM;
+
+	switch (mode) {
+		case CAM:
+			result = cas_set_cam_fw(cas);
+			break;
+		case MM:
+			result = cas_set_mm_fw(cas);
+			break;
+		case JTAG:
+			result = cas_set_jtag_fw(cas);
+			break;
+		case PHOENIX_357:
+			result = cas_set_phoenix_357_fw(cas);
+			break;
+		case PHOENIX_368:
+			result = cas_set_phoenix_368_fw(cas);
+			break;
+		case PHOENIX_400:
+			result = cas_set_phoenix_400_fw(cas);
+			break;
+		case PHOENIX_600:
+			result = cas_set_phoenix_600_fw(cas);
+			break;
+		case SMARTMOUSE_357:
+			result = cas_set_smartmouse_357_fw(cas);
+			break;
+		case SMARTMOUSE_368:
+			result = cas_set_smartmouse_368_fw(cas);
+			break;
+		case SMARTMOUSE_400:
+			result = cas_set_smartmouse_400_fw(cas);
+			break;
+		case SMARTMOUSE_600:
+			result = cas_set_smartmouse_600_fw(cas);
+			break;
+		case PROGRAMMER:
+			result = cas_set_programmer_fw(cas);
+			break;
+		case DREAMBOX:
+			result = cas_set_dreambox_fw(cas);
+			break;
+		case DIABLO:
+			result = cas_set_diablo_fw(cas);
+			break;
+		case DRAGON:
+			result = cas_set_dragon_fw(cas);
+			break;
+		case EXTREME:
+			result = cas_set_extreme_fw(cas);
+			break;
+		case JOKER:
+			result = cas_set_joker_fw(cas);
+			break;
+		case XCAM:
+			result = cas_set_xcam_fw(cas);
+			break;
+		case HOST:
+			result = cas_set_host_fw(cas);
+			break;
+		default:
+			result = -EINVAL;
+			break;
+	}
+
+	/* a failed load leaves the previous mode in charge */
+	if (result >= 0)
+		cas->status = mode;
+
+	mode_notify(cas, result, ktime_us_delta(ktime_get(), start));
+
+	return result;
+}
+
+static int mode_from_name(const char *buf)
+{
+	if (!strncmp(buf, "cam", 3))
+		return CAM;
+	if (!strncmp(buf, "mm", 2))
+		return MM;
+	if (!strncmp(buf, "jtag", 4))
+		return JTAG;
+	if (!strncmp(buf, "phoenix357", 10))
+		return PHOENIX_357;
+	if (!strncmp(buf, "phoenix368", 10))
+		return PHOENIX_368;
+	if (!strncmp(buf, "phoenix400", 10))
+		return PHOENIX_400;
+	if (!strncmp(buf, "phoenix600", 10))
+		return PHOENIX_600;
+	if (!strncmp(buf, "smartmouse357", 13))
+		return SMARTMOUSE_357;
+	if (!strncmp(buf, "smartmouse368", 13))
+		return SMARTMOUSE_368;
+	if (!strncmp(buf, "smartmouse400", 13))
+		return SMARTMOUSE_400;
+	if (!strncmp(buf, "smartmouse600", 13))
+		return SMARTMOUSE_600;
+	if (!strncmp(buf, "programmer", 10))
+		return PROGRAMMER;
+	if (!strncmp(buf, "dreambox", 8))
+		return DREAMBOX;
+	if (!strncmp(buf, "diablo", 6))
+		return DIABLO;
+	if (!strncmp(buf, "dragon", 6))
+		return DRAGON;
+	if (!strncmp(buf, "extreme", 7))
+		return EXTREME;
+	if (!strncmp(buf, "xcam", 4))
+		return XCAM;
+	if (!strncmp(buf, "joker", 5))
+		return JOKER;
+	if (!strncmp(buf, "host", 4))
+		return HOST;
+
+	return -EINVAL;
+}
+
+/* devices are looked up by serial number first, then by the port they sit on */
+static int restore_lookup(struct usb_cas *cas)
+{
+	const char *serial = cas->udevice->serial;
+	int i, mode = -1;
+
+	mutex_lock(&restore_lock);
+	for (i = 0; i < RESTORE_ENTRIES && mode < 0; i++) {
+		if (!restore_table[i].key[0])
+			continue;
+		if ((serial && !strcmp(restore_table[i].key, serial)) || !strcmp(restore_table[i].key, dev_name(&cas->udevice->dev)))
+			mode = restore_table[i].mode;
+	}
+	mutex_unlock(&restore_lock);
+
+	return mode;
+}
+
+/* a negative mode removes the entry */
+static int restore_set(const char *key, int mode)
+{
+	int i, slot = -1;
+
+	mutex_lock(&restore_lock);
+	for (i = 0; i < RESTORE_ENTRIES; i++) {
+		if (!strcmp(restore_table[i].key, key)) {
+			slot = i;
+			break;
+		}
+		if (slot < 0 && !restore_table[i].key[0])
+			slot = i;
+	}
+	if (slot >= 0) {
+		if (mode < 0)
+			restore_table[slot].key[0] = 0;
+		else {
+			strscpy(restore_table[slot].key, key, RESTORE_KEY_SIZE);
+			restore_table[slot].mode = mode;
+		}
+	}
+	mutex_unlock(&restore_lock);
+
+	return slot < 0 ? -ENOSPC : 0;
+}
+
+/* restore=<serial or port>:<mode>,... given at load time */
+static void restore_parse(void)
+{
+	char key[RESTORE_KEY_SIZE], *sep;
+	int i, mode;
+
+	for (i = 0; i < restore_count; i++) {
+		strscpy(key, restore[i], RESTORE_KEY_SIZE);
+		sep = strchr(key, ':');
+		if (!sep)
+			continue;
+		*sep = 0;
+		mode = mode_from_name(sep + 1);
+		if (mode < 0 || restore_set(key, mode) < 0)
+			pr_warn("cas: ignoring restore entry %s\n", restore[i]);
+	}
+}
+
+static void restore_work(struct work_struct *work)
+{
+	struct usb_cas *cas = container_of(work, struct usb_cas, restore_work);
+	int mode = restore_lookup(cas);
+
+	if (mode < 0)
+		return;
+
+	dev_info(&cas->uinterface->dev, "%s restoring %s mode\n", cas->device_name, cas_device_status[mode]);
+	cas_set_mode_queued(cas, mode);
+}
+
+static ssize_t restore_mode_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+	int mode = restore_lookup(cas);
+
+	return sprintf(buf, "%s", mode < 0 ? "none" : cas_device_status[mode]);
+}
+
+static ssize_t restore_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+	const char *key = cas->udevice->serial ? cas->udevice->serial : dev_name(&cas->udevice->dev);
+	int result, mode = -1;
+
+	if (strncmp(buf, "none", 4)) {
+		mode = mode_from_name(buf);
+		if (mode < 0)
+			return mode;
+	}
+
+	result = restore_set(key, mode);
+
+	return result < 0 ? result : count;
+}
+static DEVICE_ATTR(restore_mode, S_IWUSR | S_IRUGO, restore_mode_show, restore_mode_store);
+
+/* class, transactions, average and longest queue wait in us; a write clears them */
+static ssize_t queue_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	static const char * const names[PRIORITY_CLASSES] = { "high", "normal", "low" };
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+	struct cas_queue_stats stats[PRIORITY_CLASSES];
+	int i, len = 0;
+
+	spin_lock(&cas->dispatch_lock);
+	memcpy(stats, cas->queue_stats, sizeof(stats));
+	spin_unlock(&cas->dispatch_lock);
+
+	for (i = 0; i < PRIORITY_CLASSES; i++)
+		len += sprintf(buf + len, "%s %llu %llu %llu\n", names[i], stats[i].transactions,
+			       stats[i].transactions ? div_u64(div64_u64(stats[i].wait_ns, stats[i].transactions), NSEC_PER_USEC) : 0,
+			       div_u64(stats[i].max_wait_ns, NSEC_PER_USEC));
+
+	return len;
+}
+
+static ssize_t queue_stats_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+
+	spin_lock(&cas->dispatch_lock);
+	memset(cas->queue_stats, 0, sizeof(cas->queue_stats));
+	spin_unlock(&cas->dispatch_lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(queue_stats);
+
+/* mode, endpoint, smoothed response time and deviation in us, timeout in ms, samples */
+static ssize_t timeouts_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	static const char * const names[RTT_ENDPOINTS] = { "bulk_out", "bulk_in", "control" };
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+	struct cas_rtt rtt;
+	int mode, i, len = 0;
+
+	for (mode = 0; mode < DEVICE_MODES; mode++) {
+		for (i = 0; i < RTT_ENDPOINTS; i++) {
+			rtt = cas->rtt[mode][i];
+			if (!rtt.samples)
+				continue;
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%s %s %u %u %d %u\n", cas_device_status[mode], names[i],
+					 rtt.srtt, rtt.rttvar, __rtt_timeout(&rtt, mode, i), rtt.samples);
+		}
+	}
+
+	return len;
+}
+static DEVICE_ATTR_RO(timeouts);
+
+/* recoveries per rung, failed device resets and the mean time to recovery in us */
+static ssize_t recovery_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+	struct cas_recovery recovery;
+	u32 total;
+
+	mutex_lock(&cas->lock);
+	recovery = cas->recovery;
+	mutex_unlock(&cas->lock);
+
+	total = recovery.count[RECOVER_CLEAR_HALT] + recovery.count[RECOVER_RESET_DEVICE];
+
+	return sprintf(buf, "clear_halt %u\nreset_device %u\nfailed %u\nmttr %llu\n",
+		       recovery.count[RECOVER_CLEAR_HALT], recovery.count[RECOVER_RESET_DEVICE],
+		       recovery.failed, total ? div_u64(div_u64(recovery.time_ns, total), NSEC_PER_USEC) : 0);
+}
+static DEVICE_ATTR_RO(recovery);
+
+static ssize_t status_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+
+	return sprintf(buf, "%s", cas_device_status[cas->status]);
+}
+
+static ssize_t status_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(dev));
+	int mode = mode_from_name(buf);
+
+	if (mode >= 0)
+		cas_set_mode_queued(cas, mode);
+
+	return count;
+}
+static DEVICE_ATTR_RW(status);
+
+static ssize_t eeprom_read(struct file *filp, struct kobject *kobj, struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(kobj_to_dev(kobj)));
+
+	if (off >= eeprom_size(cas))
+		return 0;
+
+	return read_eeprom(cas, (unsigned char *)buf, MIN(count, (size_t)(eeprom_size(cas) - off)), off);
+}
+
+static ssize_t eeprom_write(struct file *filp, struct kobject *kobj, struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	struct usb_cas *cas = usb_get_intfdata(to_usb_interface(kobj_to_dev(kobj)));
+
+	if (off >= eeprom_size(cas))
+		return -ENOSPC;
+
+	return write_eeprom(cas, (unsigned char *)buf, MIN(count, (size_t)(eeprom_size(cas) - off)), off);
+}
+static BIN_ATTR_RW(eeprom, 0);
+
+static void dispatch_account(struct usb_cas *cas, struct cas_session *session)
+{
+	struct cas_queue_stats *stats = &cas->queue_stats[session->priority];
+	u64 wait = ktime_to_ns(ktime_sub(ktime_get(), session->queued));
+
+	stats->transactions++;
+	stats->wait_ns += wait;
+	stats->max_wait_ns = max(stats->max_wait_ns, wait);
+}
+
+/*
+ * Higher classes go first, but every priority_aging ms of waiting lifts a
+ * session one class so low priority work can't starve. Only the oldest
+ * session of each class has to be looked at, it has aged the most.
+ */
+static struct cas_session *dispatch_pick(struct usb_cas *cas)
+{
+	struct cas_session *session, *best = NULL;
+	ktime_t now = ktime_get();
+	int i, rank, best_rank = INT_MAX;
+
+	for (i = 0; i < PRIORITY_CLASSES; i++) {
+		session = list_first_entry_or_null(&cas->dispatch_queue[i], struct cas_session, node);
+		if (!session)
+			continue;
+		rank = i - (int)min_t(s64, div_s64(ktime_ms_delta(now, session->queued), max(priority_aging, 1)), PRIORITY_CLASSES);
+		if (rank < best_rank) {
+			best = session;
+			best_rank = rank;
+		}
+	}
+
+	return best;
 }
 
-static int cas_set_joker_fw(struct usb_cas *cas)
+/* hands the device to the next waiting session, called with dispatch_lock held */
+static void dispatch_next(struct usb_cas *cas)
 {
-	int result;
+	struct cas_session *next;
 
-	if (cas->state != FINISH_LOAD_JOKER_FW) {
-		result = cas_firmware_load(cas, JOKER, RESET_CPU);
-		wait_for_finish(cas, WAIT_FOR_FW);
+	next = dispatch_pick(cas);
+	if (next) {
+		list_del_init(&next->node);
+		dispatch_account(cas, next);
 	}
+	cas->dispatch_owner = next;
+	cas->dispatch_held = 0;
+	wake_up_all(&cas->dispatch_wait);
+}
 
-	//result = send_joker_command(cas);
-	if (result >= 0)
-		dev_info(&cas->uinterface->dev, "%s set to joker mode\n", cas->device_name);
+static void dispatch_hold_expired(struct work_struct *work)
+{
+	struct usb_cas *cas = container_of(to_delayed_work(work), struct usb_cas, dispatch_hold);
 
-	return result;
+	spin_lock(&cas->dispatch_lock);
+	if (cas->dispatch_held)
+		dispatch_next(cas);
+	spin_unlock(&cas->dispatch_lock);
 }
 
-static int cas_set_host_fw(struct usb_cas *cas)
+/*
+ * Waits for the turn of the session. A session re-queues at the tail of its
+ * class after every transaction, so busy sessions of a class are served
+ * round robin.
+ */
+static int session_begin(struct cas_session *session, int flags)
 {
-	int result;
-
-	if (cas->state != FINISH_LOAD_HOST_FW) {
-		result = cas_firmware_load(cas, HOST, RESET_CPU);
-		wait_for_finish(cas, WAIT_FOR_FW);
+	struct usb_cas *cas = session->cas;
+	int result = 0;
+
+	if (flags & SESSION_NOWAIT) {
+		if (!mutex_trylock(&session->lock))
+			return -EAGAIN;
+	} else if (mutex_lock_interruptible(&session->lock))
+		return -ERESTARTSYS;
+
+	spin_lock(&cas->dispatch_lock);
+	if (cas->dispatch_owner == session && cas->dispatch_held) {
+		cancel_delayed_work(&cas->dispatch_hold);
+		if (flags & SESSION_REPLY) {
+			cas->dispatch_held = 0;
+			spin_unlock(&cas->dispatch_lock);
+			return 0;
+		}
+		/* a new request instead of the reply ends the previous transaction */
+		dispatch_next(cas);
+	}
+	session->queued = ktime_get();
+	if (!cas->dispatch_owner) {
+		cas->dispatch_owner = session;
+		dispatch_account(cas, session);
+	} else if (flags & SESSION_NOWAIT)
+		result = -EAGAIN;
+	else
+		list_add_tail(&session->node, &cas->dispatch_queue[session->priority]);
+	spin_unlock(&cas->dispatch_lock);
+
+	if (!result && wait_event_interruptible(cas->dispatch_wait, READ_ONCE(cas->dispatch_owner) == session)) {
+		spin_lock(&cas->dispatch_lock);
+		if (cas->dispatch_owner == session)
+			dispatch_next(cas);
+		else
+			list_del_init(&session->node);
+		spin_unlock(&cas->dispatch_lock);
+		result = -ERESTARTSYS;
 	}
 
-	result = send_host_command(cas);
-	if (result >= 0)
-		dev_info(&cas->uinterface->dev, "%s set to host mode\n", cas->device_name);
+	if (result)
+		mutex_unlock(&session->lock);
 
 	return result;
 }
 
-static ssize_t status_show(struct device *dev, struct device_attribute *attr, char *buf)
+static void session_end(struct cas_session *session)
 {
-	struct usb_interface *interface = usb_find_interface(&cas_driver, 0);
-	struct usb_cas *cas = usb_get_intfdata(interface);
+	struct usb_cas *cas = session->cas;
 
-	return sprintf(buf, "%s", cas_device_status[cas->status]);
+	spin_lock(&cas->dispatch_lock);
+	if (cas->dispatch_owner == session)
+		dispatch_next(cas);
+	spin_unlock(&cas->dispatch_lock);
+	mutex_unlock(&session->lock);
 }
 
-static ssize_t status_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+/* a mode switch that is not made through a device node still takes its turn */
+static int cas_set_mode_queued(struct usb_cas *cas, int mode)
 {
-	struct usb_interface *interface = usb_find_interface(&cas_driver, 0);
-	struct usb_cas *cas = usb_get_intfdata(interface);
+	int result;
 
-	if (!strncmp(buf, "cam", 3)) {
-		if (device_verification(cas, CAM)) {
-			cas->status = CAM;
-			cas_set_cam_fw(cas);
-		}
-	} else if (!strncmp(buf, "mm", 2)) {
-		if (device_verification(cas, MM)) {
-			cas->status = MM;
-			cas_set_mm_fw(cas);
-		}
-	} else if (!strncmp(buf, "jtag", 4)) {
-		if (device_verification(cas, JTAG)) {
-			cas->status = JTAG;
-			cas_set_jtag_fw(cas);
-		}
-	} else if (!strncmp(buf, "phoenix357", 10)) {
-		if (device_verification(cas, PHOENIX_357)) {
-			cas->status = PHOENIX_357;
-			cas_set_phoenix_357_fw(cas);
-		}
-	} else if (!strncmp(buf, "phoenix368", 10)) {
-		if (device_verification(cas, PHOENIX_368)) {
-			cas->status = PHOENIX_368;
-			cas_set_phoenix_368_fw(cas);
-		}
-	} else if (!strncmp(buf, "phoenix400", 10)) {
-		if (device_verification(cas, PHOENIX_400)) {
-			cas->status = PHOENIX_400;
-			cas_set_phoenix_400_fw(cas);
-		}
-	} else if (!strncmp(buf, "phoenix600", 10)) {
-		if (device_verification(cas, PHOENIX_600)) {
-			cas->status = PHOENIX_600;
-			cas_set_phoenix_600_fw(cas);
-		}
-	} else if (!strncmp(buf, "smartmouse357", 13)) {
-		if (device_verification(cas, SMARTMOUSE_357)) {
-			cas->status = SMARTMOUSE_357;
-			cas_set_smartmouse_357_fw(cas);
-		}
-	} else if (!strncmp(buf, "smartmouse368", 13)) {
-		if (device_verification(cas, SMARTMOUSE_368)) {
-			cas->status = SMARTMOUSE_368;
-			cas_set_smartmouse_368_fw(cas);
-		}
-	} else if (!strncmp(buf, "smartmouse400", 13)) {
-		if (device_verification(cas, SMARTMOUSE_400)) {
-			cas->status = SMARTMOUSE_400;
-			cas_set_smartmouse_400_fw(cas);
-		}
-	} else if (!strncmp(buf, "smartmouse600", 13)) {
-		if (device_verification(cas, SMARTMOUSE_600)) {
-			cas->status = SMARTMOUSE_600;
-			cas_set_smartmouse_600_fw(cas);
-		}
-        } else if (!strncmp(buf, "programmer", 14)) {
-		if (device_verification(cas, PROGRAMMER)) {
-			cas->status = PROGRAMMER;
-			cas_set_programmer_fw(cas);
-		}
-	} else if (!strncmp(buf, "dreambox", 8)) {
-		if (device_verification(cas, DREAMBOX)) {
-			cas->status = DREAMBOX;
-			cas_set_dreambox_fw(cas);
-		}
-	} else if (!strncmp(buf, "diablo", 6)) {
-		if (device_verification(cas, DIABLO)) {
-			cas->status = DIABLO;
-			cas_set_diablo_fw(cas);
-		}
-	} else if (!strncmp(buf, "dragon", 6)) {
-		if (device_verification(cas, DRAGON)) {
-			cas->status = DRAGON;
-			cas_set_dragon_fw(cas);
-		}
-	} else if (!strncmp(buf, "extreme", 7)) {
-		if (device_verification(cas, EXTREME)) {
-			cas->status = EXTREME;
-			cas_set_extreme_fw(cas);
-		}
-	} else if (!strncmp(buf, "xcam", 4)) {
-		if (device_verification(cas, XCAM)) {
-			cas->status = XCAM;
-			cas_set_xcam_fw(cas);
-		}
-	} else if (!strncmp(buf, "joker", 5)) {
-		if (device_verification(cas, JOKER)) {
-			cas->status = JOKER;
-			cas_set_programmer_fw(cas);
-		}
-	} else if (!strncmp(buf, "host", 4)) {
-		if (device_verification(cas, HOST)) {
-			cas->status = HOST;
-			cas_set_host_fw(cas);
-		}
-	}
+	result = session_begin(&cas->mode_session, 0);
+	if (result < 0)
+		return result;
 
-	return count;
+	result = cas_set_mode(cas, mode);
+	session_end(&cas->mode_session);
+
+	return result;
+}
+
+/* a request went out, keep the device until the reply is read */
+static void session_hold(struct cas_session *session)
+{
+	struct usb_cas *cas = session->cas;
+
+	spin_lock(&cas->dispatch_lock);
+	cas->dispatch_held = 1;
+	mod_delayed_work(system_wq, &cas->dispatch_hold, msecs_to_jiffies(SESSION_HOLD_MS));
+	spin_unlock(&cas->dispatch_lock);
+	mutex_unlock(&session->lock);
 }
-static DEVICE_ATTR_RW(status);
 
 static long cas_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
-	int result;
+	int i, result;
 
-	struct usb_cas *cas = (struct usb_cas *)file->private_data;
+	struct cas_session *session = file->private_data;
+	struct usb_cas *cas = session->cas;
 	struct usb_interface *interface = usb_find_interface(&cas_driver, 0);
 
 	struct cas_bulk_command cas_bulk_cmd;
 	struct cas_vendor_command cas_vendor_cmd;
 	struct cas_device_information_command cas_info_cmd;
+	struct cas_eeprom_command cas_eeprom_cmd;
+	struct cas_bulk_command_v2 cas_bulk_cmd_v2;
+	struct cas_transfer_command cas_transfer_cmd;
+	struct cas_vendor_command_v2 cas_vendor_cmd_v2;
+	struct cas_channel_information_command cas_channel_cmd;
+	struct cas_jtag_command cas_jtag_cmd;
 
 	void *data;
 	unsigned char *buffer;
@@ -989,197 +2244,144 @@ static long cas_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
         if (!cas || !cas->udevice)
                 return -ENODEV;
 
+	result = session_begin(session, (cmd == IOCTL_RECV_BULK_COMMAND || cmd == IOCTL_RECV_BULK_COMMAND_V2) ? SESSION_REPLY : 0);
+	if (result)
+		return result;
+
 	switch (cmd)
 	{
 		case IOCTL_SET_CAM:
-			if (device_verification(cas, CAM)) {
-				cas->status = CAM;
-				result = cas_set_cam_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_CAM ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_CAM ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, CAM);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_CAM ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_CAM ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_MM:
-			if (device_verification(cas, MM)) {
-				cas->status = MM;
-				result = cas_set_mm_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_MM ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_MM ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, MM);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_MM ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_MM ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_JTAG:
-			if (device_verification(cas, JTAG)) {
-				cas->status = JTAG;
-				result = cas_set_jtag_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_JTAG ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_JTAG ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, JTAG);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_JTAG ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_JTAG ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PHOENIX_357:
-			if (device_verification(cas, PHOENIX_357)) {
-				cas->status = PHOENIX_357;
-				result = cas_set_phoenix_357_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_357 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_357 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, PHOENIX_357);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_357 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_357 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PHOENIX_368:
-			if (device_verification(cas, PHOENIX_368)) {
-				cas->status = PHOENIX_368;
-				result = cas_set_phoenix_368_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_368 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_368 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, PHOENIX_368);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_368 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_368 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PHOENIX_400:
-			if (device_verification(cas, PHOENIX_400)) {
-				cas->status = PHOENIX_400;
-				result = cas_set_phoenix_400_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_400 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_400 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, PHOENIX_400);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_400 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_400 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PHOENIX_600:
-			if (device_verification(cas, PHOENIX_600)) {
-				cas->status = PHOENIX_600;
-				result = cas_set_phoenix_600_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_600 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_600 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, PHOENIX_600);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_600 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PHOENIX_600 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_357:
-			if (device_verification(cas, SMARTMOUSE_357)) {
-				cas->status = SMARTMOUSE_357;
-				result = cas_set_smartmouse_357_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_357 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_357 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, SMARTMOUSE_357);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_357 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_357 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_368:
-			if (device_verification(cas, SMARTMOUSE_368)) {
-				cas->status = SMARTMOUSE_368;
-				result = cas_set_smartmouse_368_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_368 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_368 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, SMARTMOUSE_368);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_368 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_368 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_400:
-			if (device_verification(cas, SMARTMOUSE_400)) {
-				cas->status = SMARTMOUSE_400;
-				result = cas_set_smartmouse_400_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_400 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_400 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, SMARTMOUSE_400);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_400 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_400 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_600:
-			if (device_verification(cas, SMARTMOUSE_600)) {
-				cas->status = SMARTMOUSE_600;
-				result = cas_set_smartmouse_600_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_600 ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_600 ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, SMARTMOUSE_600);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_600 ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_600 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PROGRAMMER:
-			if (device_verification(cas, PROGRAMMER)) {
-				cas->status = PROGRAMMER;
-				result = cas_set_programmer_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PROGRAMMER ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PROGRAMMER ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, PROGRAMMER);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_PROGRAMMER ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PROGRAMMER ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_DREAMBOX:
-			if (device_verification(cas, DREAMBOX)) {
-				cas->status = DREAMBOX;
-				result = cas_set_dreambox_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_DREAMBOX ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_DREAMBOX ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, DREAMBOX);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_DREAMBOX ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_DREAMBOX ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_EXTREME:
-			if (device_verification(cas, EXTREME)) {
-				cas->status = EXTREME;
-				result = cas_set_extreme_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_EXTREME ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_EXTREME ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, EXTREME);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_EXTREME ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_EXTREME ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_DIABLO:
-			if (device_verification(cas, DIABLO)) {
-				cas->status = DIABLO;
-				result = cas_set_diablo_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_DIABLO ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_DIABLO ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, DIABLO);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_DIABLO ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_DIABLO ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_DRAGON:
-			if (device_verification(cas, DRAGON)) {
-				cas->status = DRAGON;
-				result = cas_set_dragon_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_DRAGON ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_DRAGON ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, DRAGON);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_DRAGON ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_DRAGON ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_XCAM:
-			if (device_verification(cas, XCAM)) {
-				cas->status = XCAM;
-				result = cas_set_xcam_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_XCAM ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_XCAM ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, XCAM);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_XCAM ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_XCAM ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_JOKER:
-			if (device_verification(cas, JOKER)) {
-				cas->status = JOKER;
-				result = cas_set_joker_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_JOKER ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_JOKER ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, JOKER);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_JOKER ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_JOKER ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_HOST:
-			if (device_verification(cas, HOST)) {
-				cas->status = HOST;
-				result = cas_set_host_fw(cas);
-				if (result < 0)
-					dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_HOST ioctrl, result = %d", le32_to_cpu(result));
-				else
-					dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_HOST ioctl, result = %d", le32_to_cpu(result));
-			}
+			result = cas_set_mode(cas, HOST);
+			if (result < 0)
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SET_HOST ioctrl, result = %d", le32_to_cpu(result));
+			else
+				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_HOST ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_RECV_VENDOR_COMMAND:
 			data = (void *) arg;
@@ -1307,6 +2509,231 @@ static long cas_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 				dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SEND_BULK_COMMAND ioctl, result = %d", le32_to_cpu(result));
 			free_page((unsigned long) buffer);
 			break;
+		case IOCTL_READ_EEPROM_COMMAND:
+			data = (void *) arg;
+			if (data == NULL)
+				break;
+			if (copy_from_user(&cas_eeprom_cmd, data, sizeof(struct cas_eeprom_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (cas_eeprom_cmd.offset < 0 || cas_eeprom_cmd.offset >= eeprom_size(cas) || cas_eeprom_cmd.length < 0) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			cas_eeprom_cmd.length = MIN(cas_eeprom_cmd.length, eeprom_size(cas) - cas_eeprom_cmd.offset);
+			buffer = kmalloc(cas_eeprom_cmd.length, GFP_KERNEL);
+			if (!buffer) {
+				result = -ENOMEM;
+				goto err_out;
+			}
+			result = read_eeprom(cas, buffer, cas_eeprom_cmd.length, cas_eeprom_cmd.offset);
+			if (result < 0) {
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_READ_EEPROM_COMMAND ioctrl, result = %d", le32_to_cpu(result));
+				kfree(buffer);
+				goto err_out;
+			}
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_READ_EEPROM_COMMAND ioctl, result = %d", le32_to_cpu(result));
+			if (copy_to_user(cas_eeprom_cmd.buffer, buffer, cas_eeprom_cmd.length) || copy_to_user(data, &cas_eeprom_cmd, sizeof(struct cas_eeprom_command))) {
+				kfree(buffer);
+				result = -EFAULT;
+				goto err_out;
+			}
+			kfree(buffer);
+			break;
+		case IOCTL_WRITE_EEPROM_COMMAND:
+			data = (void *) arg;
+			if (data == NULL)
+				break;
+			if (copy_from_user(&cas_eeprom_cmd, data, sizeof(struct cas_eeprom_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (cas_eeprom_cmd.offset < 0 || cas_eeprom_cmd.length < 0 || cas_eeprom_cmd.offset + cas_eeprom_cmd.length > eeprom_size(cas)) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			buffer = memdup_user(cas_eeprom_cmd.buffer, cas_eeprom_cmd.length);
+			if (IS_ERR(buffer)) {
+				result = PTR_ERR(buffer);
+				goto err_out;
+			}
+			result = write_eeprom(cas, buffer, cas_eeprom_cmd.length, cas_eeprom_cmd.offset);
+			kfree(buffer);
+			if (result < 0) {
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_WRITE_EEPROM_COMMAND ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_WRITE_EEPROM_COMMAND ioctl, result = %d", le32_to_cpu(result));
+			break;
+		case IOCTL_SET_READ_MODE:
+			if (arg != READ_MODE_FRAMED && arg != READ_MODE_STREAM && arg != READ_MODE_TIMESTAMP) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			session->read_mode = arg;
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_READ_MODE ioctl, mode = %lu", arg);
+			break;
+		case IOCTL_SET_PRIORITY:
+			if (arg >= PRIORITY_CLASSES) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			/* only the turn holder gets here, the session is on no queue */
+			session->priority = arg;
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SET_PRIORITY ioctl, priority = %lu", arg);
+			break;
+		case IOCTL_SEND_BULK_COMMAND_V2:
+			if (copy_from_user(&cas_bulk_cmd_v2, (void *)arg, sizeof(struct cas_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if ((cas_bulk_cmd_v2.flags & ~BULK_V2_CHANNEL_MASK) || cas_bulk_cmd_v2.flags >= cas->channels || cas_bulk_cmd_v2.length == 0 || cas_bulk_cmd_v2.length > BULK_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			result = bulk_command_user(cas, cas_bulk_cmd_v2.flags, 0, cas_bulk_cmd_v2.buffer, cas_bulk_cmd_v2.length);
+			if (result < 0) {
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_SEND_BULK_COMMAND_V2 ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_SEND_BULK_COMMAND_V2 ioctl, result = %d", le32_to_cpu(result));
+			cas_bulk_cmd_v2.length = result;
+			if (copy_to_user((void *)arg, &cas_bulk_cmd_v2, sizeof(struct cas_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_RECV_BULK_COMMAND_V2:
+			if (copy_from_user(&cas_bulk_cmd_v2, (void *)arg, sizeof(struct cas_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if ((cas_bulk_cmd_v2.flags & ~BULK_V2_CHANNEL_MASK) || cas_bulk_cmd_v2.flags >= cas->channels || cas_bulk_cmd_v2.length == 0 || cas_bulk_cmd_v2.length > BULK_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			result = bulk_command_user(cas, cas_bulk_cmd_v2.flags, 1, cas_bulk_cmd_v2.buffer, cas_bulk_cmd_v2.length);
+			if (result < 0) {
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_RECV_BULK_COMMAND_V2 ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_RECV_BULK_COMMAND_V2 ioctl, result = %d", le32_to_cpu(result));
+			cas_bulk_cmd_v2.length = result;
+			if (copy_to_user((void *)arg, &cas_bulk_cmd_v2, sizeof(struct cas_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_TRANSFER_COMMAND:
+			if (copy_from_user(&cas_transfer_cmd, (void *)arg, sizeof(struct cas_transfer_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (cas_transfer_cmd.reserved || (cas_transfer_cmd.flags & ~BULK_V2_CHANNEL_MASK) || cas_transfer_cmd.flags >= cas->channels ||
+			    cas_transfer_cmd.request_length == 0 || cas_transfer_cmd.request_length > BULK_V2_MAX_LENGTH ||
+			    cas_transfer_cmd.reply_length == 0 || cas_transfer_cmd.reply_length > BULK_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			result = bulk_command_user(cas, cas_transfer_cmd.flags, 0, cas_transfer_cmd.request, cas_transfer_cmd.request_length);
+			if (result >= 0)
+				result = bulk_command_user(cas, cas_transfer_cmd.flags, 1, cas_transfer_cmd.reply, cas_transfer_cmd.reply_length);
+			if (result < 0) {
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_TRANSFER_COMMAND ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_TRANSFER_COMMAND ioctl, result = %d", le32_to_cpu(result));
+			cas_transfer_cmd.reply_length = result;
+			if (copy_to_user((void *)arg, &cas_transfer_cmd, sizeof(struct cas_transfer_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_SEND_VENDOR_COMMAND_V2:
+		case IOCTL_RECV_VENDOR_COMMAND_V2:
+			if (copy_from_user(&cas_vendor_cmd_v2, (void *)arg, sizeof(struct cas_vendor_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (cas_vendor_cmd_v2.flags || cas_vendor_cmd_v2.request > 0xff || cas_vendor_cmd_v2.length > VENDOR_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			/* control transfers are small, a bounce buffer is fine here */
+			if (cmd == IOCTL_SEND_VENDOR_COMMAND_V2) {
+				buffer = memdup_user(u64_to_user_ptr(cas_vendor_cmd_v2.buffer), cas_vendor_cmd_v2.length);
+				if (IS_ERR(buffer)) {
+					result = PTR_ERR(buffer);
+					goto err_out;
+				}
+				result = vendor_command_snd(cas, cas_vendor_cmd_v2.request, cas_vendor_cmd_v2.address, cas_vendor_cmd_v2.index, buffer, cas_vendor_cmd_v2.length);
+			} else {
+				buffer = kmalloc(cas_vendor_cmd_v2.length, GFP_KERNEL);
+				if (!buffer) {
+					result = -ENOMEM;
+					goto err_out;
+				}
+				result = vendor_command_rcv(cas, cas_vendor_cmd_v2.request, cas_vendor_cmd_v2.address, cas_vendor_cmd_v2.index, buffer, cas_vendor_cmd_v2.length);
+				if (result > 0 && copy_to_user(u64_to_user_ptr(cas_vendor_cmd_v2.buffer), buffer, result))
+					result = -EFAULT;
+			}
+			kfree(buffer);
+			if (result < 0) {
+				dev_err(&cas->uinterface->dev, "Error executing vendor v2 ioctrl 0x%x, result = %d", cmd, le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&cas->uinterface->dev, "Executed vendor v2 ioctl 0x%x, result = %d", cmd, le32_to_cpu(result));
+			cas_vendor_cmd_v2.length = result;
+			if (copy_to_user((void *)arg, &cas_vendor_cmd_v2, sizeof(struct cas_vendor_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_CHANNEL_INFORMATION_COMMAND:
+			memset(&cas_channel_cmd, 0, sizeof(struct cas_channel_information_command));
+			cas_channel_cmd.channels = cas->channels;
+			for (i = 0; i < cas->channels; i++) {
+				cas_channel_cmd.in_endpoint[i] = cas->channel[i].bulk_in_endpointAddr;
+				cas_channel_cmd.out_endpoint[i] = cas->channel[i].bulk_out_endpointAddr;
+				cas_channel_cmd.in_maxp[i] = cas->channel[i].bulk_in_maxp;
+				cas_channel_cmd.out_maxp[i] = cas->channel[i].bulk_out_maxp;
+			}
+			if (copy_to_user((void *)arg, &cas_channel_cmd, sizeof(cas_channel_cmd))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_JTAG_SCAN_COMMAND:
+			if (!jtag_experimental) {
+				result = -EOPNOTSUPP;
+				goto err_out;
+			}
+			if (copy_from_user(&cas_jtag_cmd, (void *)arg, sizeof(struct cas_jtag_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (cas_jtag_cmd.count == 0 || cas_jtag_cmd.count > JTAG_MAX_SCANS || cas_jtag_cmd.vectors_length > JTAG_MAX_VECTORS) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			result = jtag_scan(cas, &cas_jtag_cmd);
+			if (result < 0) {
+				dev_err(&cas->uinterface->dev, "Error executing IOCTL_JTAG_SCAN_COMMAND ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&cas->uinterface->dev, "Executed IOCTL_JTAG_SCAN_COMMAND ioctl, %u scans, failed = %u", cas_jtag_cmd.count, cas_jtag_cmd.failed);
+			if (copy_to_user((void *)arg, &cas_jtag_cmd, sizeof(struct cas_jtag_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_GET_EVENT_FD:
+			result = cas_event_fd(cas);
+			if (result < 0)
+				goto err_out;
+			/* the new descriptor is the return value */
+			goto err_out;
 		case IOCTL_DEVICE_INFORMATION_COMMAND:
 			cas_info_cmd.device = cas->device_running;
 			cas_info_cmd.status = cas->status;
@@ -1323,25 +2750,95 @@ static long cas_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			result = -ENOTTY;
 			break;
 	}
-	return 0;
+	result = 0;
 err_out:
+	if (!result && (cmd == IOCTL_SEND_BULK_COMMAND || cmd == IOCTL_SEND_BULK_COMMAND_V2))
+		session_hold(session);
+	else
+		session_end(session);
+
 	return result;
 }
 
-static ssize_t cas_read(struct file *file, char __user *buffer, size_t count, loff_t *ppos)
-{
-	int result;
-	struct usb_cas *cas = (struct usb_cas *)file->private_data;
-	struct usb_interface *interface = usb_find_interface(&cas_driver, 0);
+static ssize_t cas_read_transfer(struct kiocb *iocb, struct iov_iter *to)
+{
+	int chunk, timeout, result = 0;
+	size_t room, count = iov_iter_count(to), done = 0;
+	struct cas_session *session = iocb->ki_filp->private_data;
+	struct usb_cas *cas = session->cas;
+	int stamped = session->read_mode == READ_MODE_TIMESTAMP;
+	struct cas_read_header header;
+	ktime_t rx_stamp = 0, start;
+
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		/* only pick up what the device has ready */
+		if (!mutex_trylock(&cas->lock))
+			return -EAGAIN;
+		timeout = 1;
+	} else {
+		mutex_lock(&cas->lock);
+		timeout = rtt_timeout(cas, RTT_BULK_IN);
+	}
+
+	while (done < count) {
+		room = count - done;
+		if (stamped) {
+			/* every transfer needs room for its header and one packet */
+			if (room < sizeof(header) + cas->bulk_in_maxp) {
+				result = done ? 0 : -EINVAL;
+				break;
+			}
+			room -= sizeof(header);
+		}
+
+		/* whole packets only, a partial one would overflow */
+		chunk = min(cas->bulk_in_size, room);
+		if (chunk > cas->bulk_in_maxp)
+			chunk -= chunk % cas->bulk_in_maxp;
+
+		start = ktime_get();
+		if (stamped)
+			result = __bulk_command_rcv_stamped(cas, cas->bulk_in_buffer, chunk, timeout, &rx_stamp);
+		else
+			result = __bulk_command_rcv(cas, cas->bulk_in_buffer, chunk, timeout);
+		/* polls that find nothing say nothing about the device */
+		if (!(iocb->ki_flags & IOCB_NOWAIT))
+			rtt_sample(cas, RTT_BULK_IN, start, result, timeout);
+
+		if (stamped && !(result == -ETIMEDOUT && (iocb->ki_flags & IOCB_NOWAIT))) {
+			/* failed transfers are reported in the header too */
+			header.rx_ns = ktime_to_ns(rx_stamp);
+			header.tx_ns = ktime_to_ns(cas->tx_stamp);
+			header.status = result < 0 ? result : 0;
+			header.length = result < 0 ? 0 : result;
+			if (copy_to_iter(&header, sizeof(header), to) != sizeof(header)) {
+				result = -EFAULT;
+				break;
+			}
+			done += sizeof(header);
+		}
+		if (result < 0)
+			break;
+
+		if (copy_to_iter(cas->bulk_in_buffer, result, to) != result) {
+			result = -EFAULT;
+			break;
+		}
+		done += result;
+
+		/* a short packet or zlp ends the message */
+		if (session->read_mode != READ_MODE_STREAM && result < chunk)
+			break;
+	}
+
+	mutex_unlock(&cas->lock);
 
-	result = bulk_command_rcv(cas, cas->bulk_in_buffer, min(cas->bulk_in_size, count), count);
+	/* data already handed out is not lost on a later error */
+	if (done)
+		return done;
 
-	if (!result) {
-		if (copy_to_user(buffer, cas->bulk_in_buffer, count))
-			result = -EFAULT;
-		else
-			result = count;
-	}
+	if (result == -ETIMEDOUT && (iocb->ki_flags & IOCB_NOWAIT))
+		return -EAGAIN;
 
 	return result;
 }
@@ -1355,77 +2852,232 @@ static void cas_write_bulk_callback(struct urb *urb)
 		dev_dbg(&cas->uinterface->dev, "nonzero write bulk status received: %d", urb->status);
 	}
 
+	cas->tx_stamp = ktime_get();
+
 	/* free up our allocated buffer */
 	usb_free_coherent(urb->dev, urb->transfer_buffer_length, urb->transfer_buffer, urb->transfer_dma);
+	up(&cas->limit_sem);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+/*
+ * Pages handed in by splice are sent straight from the page cache with a
+ * scatter-gather request instead of being copied into a urb buffer first.
+ */
+static int bulk_sg_write(struct usb_cas *cas, struct iov_iter *from, size_t len)
+{
+	struct page *pages[MAX_SG_PAGES];
+	struct cas_sg_wait wait;
+	struct sg_table table;
+	ssize_t bytes;
+	size_t offset;
+	int i, npages, result;
+
+	bytes = iov_iter_get_pages2(from, pages, len, MAX_SG_PAGES, &offset);
+	if (bytes <= 0)
+		return bytes ? bytes : -EFAULT;
+	npages = DIV_ROUND_UP(offset + bytes, PAGE_SIZE);
+
+	result = sg_alloc_table_from_pages(&table, pages, npages, offset, bytes, GFP_KERNEL);
+	if (result)
+		goto put;
+
+	result = usb_sg_init(&wait.io, cas->udevice, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), 0, table.sgl, table.nents, bytes, GFP_KERNEL);
+	if (!result) {
+		result = sg_wait(&wait, rtt_timeout(cas, RTT_BULK_OUT));
+		cas->tx_stamp = ktime_get();
+	}
+	sg_free_table(&table);
+
+put:
+	for (i = 0; i < npages; i++)
+		put_page(pages[i]);
+
+	/* give back whatever did not make it to the device */
+	if (result < 0)
+		iov_iter_revert(from, bytes);
+	else if (result < bytes)
+		iov_iter_revert(from, bytes - result);
+
+	return result;
 }
+#endif
 
-static ssize_t cas_write(struct file *file, const char __user *user_buffer, size_t count, loff_t *ppos)
+static ssize_t cas_write_transfer(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct usb_cas *cas;
 	int result;
-	struct urb *urb = NULL;
-	char *buf = NULL;
+	size_t chunk, done = 0, count = iov_iter_count(from);
+	gfp_t gfp = (iocb->ki_flags & IOCB_NOWAIT) ? GFP_NOWAIT : GFP_KERNEL;
+	struct urb *urb;
+	char *buf;
+
+	cas = ((struct cas_session *)iocb->ki_filp->private_data)->cas;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+	if (iov_iter_is_bvec(from) && cas->udevice->bus->sg_tablesize) {
+		while (done < count) {
+			/* one request takes one slot like an urb of the copying path */
+			if (iocb->ki_flags & IOCB_NOWAIT) {
+				if (down_trylock(&cas->limit_sem)) {
+					result = -EAGAIN;
+					goto error;
+				}
+			} else if (down_interruptible(&cas->limit_sem)) {
+				result = -ERESTARTSYS;
+				goto error;
+			}
+			result = bulk_sg_write(cas, from, count - done);
+			up(&cas->limit_sem);
+			if (result <= 0)
+				goto error;
+			done += result;
+		}
+		return done;
+	}
+#endif
 
-	cas = (struct usb_cas *)file->private_data;
+	/* gather the segments into as few urbs as possible */
+	while (done < count) {
+		chunk = min_t(size_t, count - done, MAX_WRITE_URB_SIZE);
 
-	/* verify that we actually have some data to write */
-	if (count == 0)
-		goto exit;
+		/* limit the number of urbs in flight so a long stream can't eat all ram */
+		if (iocb->ki_flags & IOCB_NOWAIT) {
+			if (down_trylock(&cas->limit_sem)) {
+				result = -EAGAIN;
+				goto error;
+			}
+		} else if (down_interruptible(&cas->limit_sem)) {
+			result = -ERESTARTSYS;
+			goto error;
+		}
 
-	/* create a urb, and a buffer for it, and copy the data to the urb */
-	urb = usb_alloc_urb(0, GFP_KERNEL);
-	if (!urb) {
-		result = -ENOMEM;
-		goto error;
-	}
+		/* create a urb, and a buffer for it, and copy the data to the urb */
+		urb = usb_alloc_urb(0, gfp);
+		if (!urb) {
+			up(&cas->limit_sem);
+			result = -ENOMEM;
+			goto error;
+		}
 
-	buf = usb_alloc_coherent(cas->udevice, count, GFP_KERNEL, &urb->transfer_dma);
-	if (!buf) {
-		result = -ENOMEM;
-		goto error;
-	}
-	if (copy_from_user(buf, user_buffer, count)) {
-		result = -EFAULT;
-		goto error;
-	}
+		buf = usb_alloc_coherent(cas->udevice, chunk, gfp, &urb->transfer_dma);
+		if (!buf) {
+			usb_free_urb(urb);
+			up(&cas->limit_sem);
+			result = -ENOMEM;
+			goto error;
+		}
+		if (!copy_from_iter_full(buf, chunk, from)) {
+			usb_free_coherent(cas->udevice, chunk, buf, urb->transfer_dma);
+			usb_free_urb(urb);
+			up(&cas->limit_sem);
+			result = -EFAULT;
+			goto error;
+		}
 
-	/* initialize the urb properly */
-	usb_fill_bulk_urb(urb, cas->udevice, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), buf, count, cas_write_bulk_callback, cas);
-	urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
+		/* initialize the urb properly */
+		usb_fill_bulk_urb(urb, cas->udevice, usb_sndbulkpipe(cas->udevice, cas->bulk_out_endpointAddr), buf, chunk, cas_write_bulk_callback, cas);
+		urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
+
+		if (debug)
+			dump_buffer(cas, buf, "data_out", chunk);
+
+		/* send the data out the bulk port */
+		usb_anchor_urb(urb, &cas->submitted);
+		result = usb_submit_urb(urb, gfp);
+		if (result) {
+			dev_err(&cas->uinterface->dev, "failed submitting write urb, error %d", result);
+			usb_unanchor_urb(urb);
+			usb_free_coherent(cas->udevice, chunk, buf, urb->transfer_dma);
+			usb_free_urb(urb);
+			up(&cas->limit_sem);
+			goto error;
+		}
 
-	/* send the data out the bulk port */
-	result = usb_submit_urb(urb, GFP_KERNEL);
-	if (result) {
-		dev_err(&cas->uinterface->dev, "failed submitting write urb, error %d", result);
-		goto error;
+		/* release our reference to this urb, the USB core will eventually free it entirely */
+		usb_free_urb(urb);
+		done += chunk;
 	}
 
-	if (debug)
-		dump_buffer(cas, buf, "data_out", MAX_PKT_SIZE);
+	return done;
 
-	/* release our reference to this urb, the USB core will eventually free it entirely */
-	usb_free_urb(urb);
+error:
+	if (done)
+		return done;
+	if (result == -ENOMEM && (iocb->ki_flags & IOCB_NOWAIT))
+		return -EAGAIN;
 
-exit:
-	return count;
+	return result;
+}
 
-error:
-	usb_free_coherent(cas->udevice, count, buf, urb->transfer_dma);
-	usb_free_urb(urb);
-	kfree(buf);
+static ssize_t cas_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct cas_session *session = iocb->ki_filp->private_data;
+	ssize_t result;
+
+	result = session_begin(session, SESSION_REPLY | ((iocb->ki_flags & IOCB_NOWAIT) ? SESSION_NOWAIT : 0));
+	if (result)
+		return result;
+
+	result = cas_read_transfer(iocb, to);
+	session_end(session);
+
+	return result;
+}
+
+static ssize_t cas_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct cas_session *session = iocb->ki_filp->private_data;
+	ssize_t result;
+
+	result = session_begin(session, (iocb->ki_flags & IOCB_NOWAIT) ? SESSION_NOWAIT : 0);
+	if (result)
+		return result;
+
+	result = cas_write_transfer(iocb, from);
+	if (result > 0)
+		session_hold(session);
+	else
+		session_end(session);
 
 	return result;
 }
 
 static int cas_open(struct inode *inode, struct file *file)
 {
-	int result;
+	int result = 0;
 	struct usb_interface *interface = usb_find_interface(&cas_driver, 0);
 	struct usb_cas *cas = usb_get_intfdata(interface);
+	struct cas_session *session;
+
+	session = kzalloc(sizeof(struct cas_session), GFP_KERNEL);
+	if (!session)
+		return -ENOMEM;
+
+	session->cas = cas;
+	mutex_init(&session->lock);
+	INIT_LIST_HEAD(&session->node);
+	session->exclusive = !!(file->f_flags & O_EXCL);
+	session->priority = PRIORITY_NORMAL;
+
+	/* O_EXCL keeps everybody else out for as long as it is open */
+	spin_lock(&cas->dispatch_lock);
+	if (cas->exclusive || (session->exclusive && cas->sessions))
+		result = -EBUSY;
+	else {
+		cas->sessions++;
+		cas->exclusive = session->exclusive;
+	}
+	spin_unlock(&cas->dispatch_lock);
+	if (result) {
+		kfree(session);
+		return result;
+	}
 
 	kref_get(&cas->kref);
 
-	file->private_data = cas;
+	file->private_data = session;
+	file->f_mode |= FMODE_NOWAIT;
 
 	dev_dbg(&cas->uinterface->dev, "%s Reader/Programmer device opened\n", cas->device_name);
 
@@ -1437,6 +3089,9 @@ static void cas_delete(struct kref *kref)
 	struct usb_cas *cas = to_cas_dev(kref);
 
 	usb_put_dev(cas->udevice);
+	cancel_delayed_work_sync(&cas->dispatch_hold);
+	usb_free_urb(cas->int_urb);
+	kfree(cas->int_buffer);
 	if (cas->bulk_in_buffer)
 		kfree (cas->bulk_in_buffer);
 	if (cas)
@@ -1445,13 +3100,25 @@ static void cas_delete(struct kref *kref)
 
 static int cas_release(struct inode *inode, struct file *file)
 {
-	int result;
+	int result = 0;
 
+	struct cas_session *session = file->private_data;
 	struct usb_cas *cas;
 
-	cas = (struct usb_cas *)file->private_data;
-	if (cas == NULL)
+	if (session == NULL)
 		return -ENODEV;
+	cas = session->cas;
+
+	spin_lock(&cas->dispatch_lock);
+	if (cas->dispatch_owner == session)
+		dispatch_next(cas);
+	cas->sessions--;
+	if (session->exclusive)
+		cas->exclusive = 0;
+	spin_unlock(&cas->dispatch_lock);
+
+	mutex_destroy(&session->lock);
+	kfree(session);
 
 	/* decrement the count on our device */
 	kref_put(&cas->kref, cas_delete);
@@ -1461,6 +3128,391 @@ static int cas_release(struct inode *inode, struct file *file)
 	return result;
 }
 
+/*
+ * Restart the interrupt urb after a persistent error, a stall clears the
+ * halt first. Every error in a row doubles the wait. After INT_RETRIES the
+ * device is reset and post_reset starts the urb again, if it keeps failing
+ * after that the status events stop.
+ */
+static void int_retry(struct work_struct *work)
+{
+	struct usb_cas *cas = container_of(to_delayed_work(work), struct usb_cas, int_retry);
+	int errors = ++cas->int_errors;
+
+	if (errors > INT_RETRIES + 1) {
+		dev_err(&cas->uinterface->dev, "%s interrupt endpoint keeps failing, no more status events\n", cas->device_name);
+		return;
+	}
+	if (errors > INT_RETRIES) {
+		recover_schedule(cas);
+		return;
+	}
+
+	if (cas->int_status == -EPIPE)
+		usb_clear_halt(cas->udevice, cas->int_urb->pipe);
+	if (usb_submit_urb(cas->int_urb, GFP_KERNEL))
+		dev_dbg(&cas->uinterface->dev, "failed resubmitting interrupt urb");
+}
+
+/* stop the interrupt urb, neither a completion nor a pending retry can start it again */
+static void int_stop(struct usb_cas *cas)
+{
+	usb_poison_urb(cas->int_urb);
+	cancel_delayed_work_sync(&cas->int_retry);
+}
+
+static void cas_int_callback(struct urb *urb)
+{
+	struct usb_cas *cas = urb->context;
+	int len = min_t(int, urb->actual_length, EVENT_DATA_SIZE);
+
+	switch (urb->status) {
+		case 0:
+			cas->int_errors = 0;
+			/* only changes are worth a wakeup */
+			if (len != cas->int_last_length || memcmp(cas->int_last, cas->int_buffer, len)) {
+				memcpy(cas->int_last, cas->int_buffer, len);
+				cas->int_last_length = len;
+				event_post(cas, EVENT_STATUS, 0, cas->int_buffer, len);
+			}
+			break;
+		case -ENOENT:
+		case -ECONNRESET:
+		case -ESHUTDOWN:
+			/* unlinked, the device is going away */
+			return;
+		case -EPIPE:
+		case -EPROTO:
+		case -EILSEQ:
+		case -ETIME:
+			/* these don't go away by themselves, resubmitting at once only floods */
+			event_post(cas, EVENT_ERROR, urb->status, NULL, 0);
+			cas->int_status = urb->status;
+			schedule_delayed_work(&cas->int_retry, msecs_to_jiffies(INT_RETRY_MS << min(cas->int_errors, INT_RETRIES)));
+			return;
+		default:
+			event_post(cas, EVENT_ERROR, urb->status, NULL, 0);
+			break;
+	}
+
+	if (usb_submit_urb(urb, GFP_ATOMIC))
+		dev_dbg(&cas->uinterface->dev, "failed resubmitting interrupt urb");
+}
+
+/* start listening on the interrupt in endpoint, if the firmware has one */
+static int cas_int_start(struct usb_cas *cas, struct usb_endpoint_descriptor *endpoint)
+{
+	int size = usb_endpoint_maxp(endpoint);
+
+	cas->int_urb = usb_alloc_urb(0, GFP_KERNEL);
+	cas->int_buffer = kmalloc(size, GFP_KERNEL);
+	if (!cas->int_urb || !cas->int_buffer)
+		return -ENOMEM;
+
+	usb_fill_int_urb(cas->int_urb, cas->udevice, usb_rcvintpipe(cas->udevice, endpoint->bEndpointAddress), cas->int_buffer, size, cas_int_callback, cas, endpoint->bInterval);
+
+	return usb_submit_urb(cas->int_urb, GFP_KERNEL);
+}
+
+static ssize_t cas_event_read(struct file *file, char __user *buffer, size_t count, loff_t *ppos)
+{
+	struct usb_cas *cas = file->private_data;
+	struct cas_event event;
+	size_t done = 0;
+	u32 lost;
+	int result;
+
+	if (count < sizeof(event))
+		return -EINVAL;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		result = wait_event_interruptible(cas->event_wait, !kfifo_is_empty(&cas->events) || READ_ONCE(cas->disconnected));
+		if (result)
+			return result;
+	}
+
+	/* the dropped events were older than anything still queued */
+	spin_lock_irq(&cas->event_lock);
+	lost = cas->events_lost;
+	cas->events_lost = 0;
+	spin_unlock_irq(&cas->event_lock);
+	if (lost) {
+		memset(&event, 0, sizeof(event));
+		event.time_ns = ktime_get_ns();
+		event.type = EVENT_OVERFLOW;
+		event.status = lost;
+		if (copy_to_user(buffer, &event, sizeof(event)))
+			return -EFAULT;
+		done += sizeof(event);
+	}
+
+	while (count - done >= sizeof(event)) {
+		spin_lock_irq(&cas->event_lock);
+		result = kfifo_get(&cas->events, &event);
+		spin_unlock_irq(&cas->event_lock);
+		if (!result)
+			break;
+
+		if (copy_to_user(buffer + done, &event, sizeof(event)))
+			return done ? done : -EFAULT;
+		done += sizeof(event);
+	}
+
+	if (!done && READ_ONCE(cas->disconnected))
+		return -ENODEV;
+
+	return done ? done : -EAGAIN;
+}
+
+static __poll_t cas_event_poll(struct file *file, poll_table *wait)
+{
+	struct usb_cas *cas = file->private_data;
+
+	poll_wait(file, &cas->event_wait, wait);
+
+	if (!kfifo_is_empty(&cas->events))
+		return EPOLLIN | EPOLLRDNORM;
+
+	return READ_ONCE(cas->disconnected) ? EPOLLHUP | EPOLLERR : 0;
+}
+
+static int cas_event_release(struct inode *inode, struct file *file)
+{
+	struct usb_cas *cas = file->private_data;
+
+	kref_put(&cas->kref, cas_delete);
+
+	return 0;
+}
+
+static const struct file_operations cas_event_fops = {
+	.owner		= THIS_MODULE,
+	.read		= cas_event_read,
+	.poll		= cas_event_poll,
+	.release	= cas_event_release,
+	.llseek		= noop_llseek,
+};
+
+static int cas_event_fd(struct usb_cas *cas)
+{
+	int fd;
+
+	kref_get(&cas->kref);
+	fd = anon_inode_getfd("[cas_event]", &cas_event_fops, cas, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		kref_put(&cas->kref, cas_delete);
+
+	return fd;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,7,0)
+static void cas_uring_free(struct cas_uring_request *req)
+{
+	usb_free_urb(req->urb);
+	kfree(req->setup);
+	kfree(req->buffer);
+	kref_put(&req->cas->kref, cas_delete);
+	kfree(req);
+}
+
+static void cas_uring_done(struct io_uring_cmd *ioucmd, unsigned int issue_flags)
+{
+	struct cas_uring_request *req = *(struct cas_uring_request **)ioucmd->pdu;
+	struct usb_cas *cas = req->cas;
+	int result = req->result, reset = 0;
+
+	cancel_delayed_work_sync(&req->expire);
+	/* an unlinked urb comes back as -ECONNRESET, a killed one as -ENOENT */
+	if (result == -ECONNRESET && READ_ONCE(req->expired))
+		result = -ETIMEDOUT;
+	else if (result == -ENOENT)
+		result = -ECANCELED;
+
+	/* a long transfer says nothing about the response time, its timeout does */
+	mutex_lock(&cas->lock);
+	if (req->length <= MAX_WRITE_URB_SIZE || result == -ETIMEDOUT)
+		rtt_sample(cas, req->endpoint, req->start, result, req->timeout);
+	if (req->endpoint != RTT_CONTROL)
+		recover_endpoint(cas, req->urb->pipe, result, req->start, &reset);
+	mutex_unlock(&cas->lock);
+
+	/* the ring may be locked for this completion, the reset runs elsewhere */
+	if (reset)
+		recover_schedule(cas);
+
+	/* user memory can only be touched from the submitting task */
+	if (result > 0 && req->dir_in && copy_to_user(req->user, req->buffer, result))
+		result = -EFAULT;
+
+	io_uring_cmd_done(ioucmd, result, 0, issue_flags);
+	cas_uring_free(req);
+}
+
+static void cas_uring_callback(struct urb *urb)
+{
+	struct cas_uring_request *req = urb->context;
+
+	if (!req->dir_in)
+		req->cas->tx_stamp = ktime_get();
+	req->result = urb->status ? urb->status : urb->actual_length;
+	io_uring_cmd_complete_in_task(req->ioucmd, cas_uring_done);
+}
+
+static void cas_uring_expire(struct work_struct *work)
+{
+	struct cas_uring_request *req = container_of(to_delayed_work(work), struct cas_uring_request, expire);
+
+	WRITE_ONCE(req->expired, 1);
+	usb_unlink_urb(req->urb);
+}
+
+/*
+ * io_uring passthrough: every command is turned into an urb and completes
+ * asynchronously, so one thread can keep many transfers in flight without a
+ * syscall per operation. Submitting takes a turn on the dispatcher and the
+ * channel lock like the ioctls do, a send keeps the turn for its reply. The
+ * urb is unlinked after the adaptive timeout and can be cancelled by the
+ * ring, the result feeds the rtt estimate and the recovery ladder. Mode
+ * switches stay with the ioctls, they sleep for seconds and can't be
+ * cancelled.
+ */
+static int cas_uring_cmd(struct io_uring_cmd *ioucmd, unsigned int issue_flags)
+{
+	struct cas_session *session = ioucmd->file->private_data;
+	struct usb_cas *cas = session->cas;
+	struct cas_uring_command ucmd;
+	struct cas_uring_request *req;
+	struct mutex *lock;
+	unsigned int pipe;
+	int result;
+
+	if (issue_flags & IO_URING_F_CANCEL) {
+		req = *(struct cas_uring_request **)ioucmd->pdu;
+		usb_kill_urb(req->urb);
+		return 0;
+	}
+
+	/* the sqe is shared with user space, take a private copy */
+	memcpy(&ucmd, io_uring_sqe_cmd(ioucmd->sqe), sizeof(ucmd));
+	if (ucmd.length > URING_MAX_LENGTH)
+		return -EINVAL;
+	if (ucmd.flags && (ucmd.flags >= cas->channels || (ioucmd->cmd_op != URING_SEND_BULK && ioucmd->cmd_op != URING_RECV_BULK)))
+		return -EINVAL;
+
+	req = kzalloc(sizeof(struct cas_uring_request), GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	kref_get(&cas->kref);
+	req->cas = cas;
+	req->ioucmd = ioucmd;
+	req->user = u64_to_user_ptr(ucmd.buffer);
+	req->length = ucmd.length;
+	INIT_DELAYED_WORK(&req->expire, cas_uring_expire);
+	*(struct cas_uring_request **)ioucmd->pdu = req;
+
+	switch (ioucmd->cmd_op) {
+		case URING_SEND_BULK:
+			req->endpoint = RTT_BULK_OUT;
+			pipe = usb_sndbulkpipe(cas->udevice, cas->channel[ucmd.flags].bulk_out_endpointAddr);
+			break;
+		case URING_RECV_BULK:
+			req->dir_in = 1;
+			req->endpoint = RTT_BULK_IN;
+			pipe = usb_rcvbulkpipe(cas->udevice, cas->channel[ucmd.flags].bulk_in_endpointAddr);
+			break;
+		case URING_SEND_VENDOR:
+			req->endpoint = RTT_CONTROL;
+			pipe = usb_sndctrlpipe(cas->udevice, 0);
+			break;
+		case URING_RECV_VENDOR:
+			req->dir_in = 1;
+			req->endpoint = RTT_CONTROL;
+			pipe = usb_rcvctrlpipe(cas->udevice, 0);
+			break;
+		default:
+			result = -ENOTTY;
+			goto error;
+	}
+
+	if (req->dir_in)
+		req->buffer = kmalloc(req->length, GFP_KERNEL);
+	else
+		req->buffer = memdup_user(req->user, req->length);
+	if (IS_ERR_OR_NULL(req->buffer)) {
+		result = req->buffer ? PTR_ERR(req->buffer) : -ENOMEM;
+		req->buffer = NULL;
+		goto error;
+	}
+
+	req->urb = usb_alloc_urb(0, GFP_KERNEL);
+	if (!req->urb) {
+		result = -ENOMEM;
+		goto error;
+	}
+
+	if (ioucmd->cmd_op == URING_SEND_VENDOR || ioucmd->cmd_op == URING_RECV_VENDOR) {
+		req->setup = kmalloc(sizeof(struct usb_ctrlrequest), GFP_KERNEL);
+		if (!req->setup) {
+			result = -ENOMEM;
+			goto error;
+		}
+		req->setup->bRequestType = (req->dir_in ? USB_DIR_IN : USB_DIR_OUT) | USB_TYPE_VENDOR | USB_RECIP_DEVICE;
+		req->setup->bRequest = ucmd.request;
+		req->setup->wValue = cpu_to_le16(ucmd.address);
+		req->setup->wIndex = 0;
+		req->setup->wLength = cpu_to_le16(req->length);
+		usb_fill_control_urb(req->urb, cas->udevice, pipe, (unsigned char *)req->setup, req->buffer, req->length, cas_uring_callback, req);
+	} else
+		usb_fill_bulk_urb(req->urb, cas->udevice, pipe, req->buffer, req->length, cas_uring_callback, req);
+
+	/* a non blocking issue is retried from a worker when it would wait */
+	result = session_begin(session, (req->dir_in ? SESSION_REPLY : 0) | ((issue_flags & IO_URING_F_NONBLOCK) ? SESSION_NOWAIT : 0));
+	if (result) {
+		if (result == -ERESTARTSYS)
+			result = -EINTR;
+		goto error;
+	}
+
+	lock = channel_lock(cas, ucmd.flags);
+	if (!(issue_flags & IO_URING_F_NONBLOCK))
+		mutex_lock(lock);
+	else if (!mutex_trylock(lock)) {
+		session_end(session);
+		result = -EAGAIN;
+		goto error;
+	}
+
+	/* from here on the ring may cancel, a failure completes like a transfer */
+	io_uring_cmd_mark_cancelable(ioucmd, issue_flags);
+	req->timeout = rtt_timeout(cas, req->endpoint);
+	req->start = ktime_get();
+	schedule_delayed_work(&req->expire, msecs_to_jiffies(req->timeout));
+	usb_anchor_urb(req->urb, &cas->submitted);
+	result = usb_submit_urb(req->urb, GFP_KERNEL);
+	if (result)
+		usb_unanchor_urb(req->urb);
+	mutex_unlock(lock);
+
+	if (!result && !req->dir_in)
+		session_hold(session);
+	else
+		session_end(session);
+
+	if (result) {
+		cancel_delayed_work_sync(&req->expire);
+		io_uring_cmd_done(ioucmd, result, 0, issue_flags);
+		cas_uring_free(req);
+	}
+
+	return -EIOCBQUEUED;
+
+error:
+	cas_uring_free(req);
+	return result;
+}
+#endif
+
 static const struct usb_device_id id_table[] = {
 	{ USB_DEVICE(CAS2_PLUS2_CRYPTO_VENDOR_ID, CAS2_PLUS2_CRYPTO_PRODUCT_ID) },
 	{},
@@ -1468,17 +3520,51 @@ static const struct usb_device_id id_table[] = {
 MODULE_DEVICE_TABLE(usb, id_table);
 
 /* usb specific object needed to register this driver with the usb subsystem */
+/* keep transfers off the bus while the device resets, the lock is held until post_reset */
+static int cas_pre_reset(struct usb_interface *interface)
+{
+	struct usb_cas *cas = usb_get_intfdata(interface);
+
+	mutex_lock(&cas->lock);
+	usb_kill_anchored_urbs(&cas->submitted);
+	int_stop(cas);
+	/* a reset may take the ram firmware with it */
+	cas->fw_name = NULL;
+
+	return 0;
+}
+
+static int cas_post_reset(struct usb_interface *interface)
+{
+	struct usb_cas *cas = usb_get_intfdata(interface);
+
+	cas->fw_name = NULL;
+	if (cas->int_urb) {
+		usb_unpoison_urb(cas->int_urb);
+		usb_submit_urb(cas->int_urb, GFP_NOIO);
+	}
+	mutex_unlock(&cas->lock);
+
+	return 0;
+}
+
 static struct usb_driver cas_driver = {
 	.name		= "cas",
 	.probe		= cas_probe,
 	.disconnect	= cas_disconnect,
+	.pre_reset	= cas_pre_reset,
+	.post_reset	= cas_post_reset,
 	.id_table	= id_table,
 };
 
 static const struct file_operations cas_fops = {
 	.unlocked_ioctl	= cas_ioctl,
-	.read		= cas_read,
-	.write		= cas_write,
+	.read_iter	= cas_read_iter,
+	.write_iter	= cas_write_iter,
+	.splice_write	= iter_file_splice_write,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,7,0)
+	.uring_cmd	= cas_uring_cmd,
+#endif
 	.open		= cas_open,
 	.release	= cas_release,
 };
@@ -1494,7 +3580,7 @@ static int cas_probe(struct usb_interface *interface, const struct usb_device_id
 	struct usb_endpoint_descriptor *endpoint;
 	size_t buffer_size;
 	struct usb_cas *cas;
-	int i, result = -ENOMEM;
+	int i, in = 0, out = 0, result = -ENOMEM;
 
 	int init;
 
@@ -1503,6 +3589,24 @@ static int cas_probe(struct usb_interface *interface, const struct usb_device_id
 		goto error_mem;
 
 	kref_init(&cas->kref);
+	mutex_init(&cas->lock);
+	sema_init(&cas->limit_sem, WRITES_IN_FLIGHT);
+	init_usb_anchor(&cas->submitted);
+	spin_lock_init(&cas->event_lock);
+	init_waitqueue_head(&cas->event_wait);
+	spin_lock_init(&cas->dispatch_lock);
+	for (i = 0; i < PRIORITY_CLASSES; i++)
+		INIT_LIST_HEAD(&cas->dispatch_queue[i]);
+	init_waitqueue_head(&cas->dispatch_wait);
+	INIT_DELAYED_WORK(&cas->dispatch_hold, dispatch_hold_expired);
+	INIT_WORK(&cas->restore_work, restore_work);
+	INIT_WORK(&cas->recover_work, recover_work);
+	INIT_DELAYED_WORK(&cas->int_retry, int_retry);
+	cas->mode_session.cas = cas;
+	mutex_init(&cas->mode_session.lock);
+	INIT_LIST_HEAD(&cas->mode_session.node);
+	cas->mode_session.priority = PRIORITY_NORMAL;
+	INIT_KFIFO(cas->events);
 
 	cas->udevice = usb_get_dev(interface_to_usbdev(interface));
 	cas->uinterface = interface;
@@ -1515,17 +3619,32 @@ static int cas_probe(struct usb_interface *interface, const struct usb_device_id
 	}
 
 	/* set up the endpoint information */
-	/* use only the first bulk-in and bulk-out endpoints */
+	/* the first bulk-in and bulk-out endpoints carry commands, every pair is a channel */
 	iface_desc = interface->cur_altsetting;
 	for (i = 0; i < iface_desc->desc.bNumEndpoints; ++i) {
 		endpoint = &iface_desc->endpoint[i].desc;
 
+		if (usb_endpoint_is_bulk_in(endpoint) && in < MAX_CHANNELS) {
+			cas->channel[in].bulk_in_endpointAddr = endpoint->bEndpointAddress;
+			cas->channel[in++].bulk_in_maxp = bulk_packet_size(cas, endpoint);
+		}
+		if (usb_endpoint_is_bulk_out(endpoint) && out < MAX_CHANNELS) {
+			cas->channel[out].bulk_out_endpointAddr = endpoint->bEndpointAddress;
+			cas->channel[out++].bulk_out_maxp = bulk_packet_size(cas, endpoint);
+		}
+		if (usb_endpoint_is_int_in(endpoint) && !cas->int_urb) {
+			/* status reports, no need to poll with bulk commands */
+			if (cas_int_start(cas, endpoint) < 0)
+				dev_warn(&interface->dev, "Could not start the interrupt endpoint, no events\n");
+		}
+
 		if (!cas->bulk_in_endpointAddr &&
 		    (endpoint->bEndpointAddress & USB_DIR_IN) &&
 		    ((endpoint->bmAttributes & USB_ENDPOINT_XFERTYPE_MASK)
 					== USB_ENDPOINT_XFER_BULK)) {
 			/* we found a bulk in endpoint */
-			buffer_size = endpoint->wMaxPacketSize;
+			cas->bulk_in_maxp = bulk_packet_size(cas, endpoint);
+			buffer_size = cas->bulk_in_maxp * BULK_IN_PACKETS;
 			cas->bulk_in_size = buffer_size;
 			cas->bulk_in_endpointAddr = endpoint->bEndpointAddress;
 			cas->bulk_in_buffer = kmalloc(buffer_size, GFP_KERNEL);
@@ -1541,9 +3660,17 @@ static int cas_probe(struct usb_interface *interface, const struct usb_device_id
 					== USB_ENDPOINT_XFER_BULK)) {
 			/* we found a bulk out endpoint */
 			cas->bulk_out_endpointAddr = endpoint->bEndpointAddress;
+			cas->bulk_out_maxp = bulk_packet_size(cas, endpoint);
 		}
 	}
 
+	cas->channels = min(in, out);
+	for (i = 0; i < MAX_CHANNELS; i++)
+		mutex_init(&cas->channel[i].lock);
+
+	if (cas->bulk_in_endpointAddr && cas->bulk_out_endpointAddr)
+		dev_info(&interface->dev, "%s %s speed, %d/%d byte bulk packets, %d channels\n", cas->device_name, usb_speed_string(cas->udevice->speed), cas->bulk_in_maxp, cas->bulk_out_maxp, cas->channels);
+
 	if (!(cas->bulk_in_endpointAddr && cas->bulk_out_endpointAddr) && (cas->status != NOFW)) {
 		dev_err(&interface->dev, "Could not find both bulk-in and bulk-out endpoints\n");
 		goto error;
@@ -1559,12 +3686,30 @@ static int cas_probe(struct usb_interface *interface, const struct usb_device_id
 #endif
 	usb_set_intfdata(interface, cas);
 
-	mutex_init(&cas->lock);
-
 	result = device_create_file(&interface->dev, &dev_attr_status);
 	if (result < 0)
 		goto error;
 
+	result = device_create_file(&interface->dev, &dev_attr_restore_mode);
+	if (result < 0)
+		goto error;
+
+	result = device_create_file(&interface->dev, &dev_attr_queue_stats);
+	if (result < 0)
+		goto error;
+
+	result = device_create_file(&interface->dev, &dev_attr_timeouts);
+	if (result < 0)
+		goto error;
+
+	result = device_create_file(&interface->dev, &dev_attr_recovery);
+	if (result < 0)
+		goto error;
+
+	result = device_create_bin_file(&interface->dev, &bin_attr_eeprom);
+	if (result < 0)
+		goto error;
+
 	/* we can register the device now, as it is ready */
 	result = usb_register_dev(interface, &cas_class);
 	if (result < 0) {
@@ -1577,6 +3722,9 @@ static int cas_probe(struct usb_interface *interface, const struct usb_device_id
 		cas_set_init_fw(cas);
 	} else {
 		cas->status = READY;
+		/* firmware loading sleeps, don't hold up enumeration */
+		if (restore_lookup(cas) >= 0)
+			schedule_work(&cas->restore_work);
 		//unsigned char buf[64];
 		//read_eeprom(cas, buf, 64, 0);
 	}
@@ -1586,10 +3734,17 @@ static int cas_probe(struct usb_interface *interface, const struct usb_device_id
 	return 0;
 error:
 	device_remove_file(&interface->dev, &dev_attr_status);
+	device_remove_file(&interface->dev, &dev_attr_restore_mode);
+	device_remove_file(&interface->dev, &dev_attr_queue_stats);
+	device_remove_file(&interface->dev, &dev_attr_timeouts);
+	device_remove_file(&interface->dev, &dev_attr_recovery);
+	device_remove_bin_file(&interface->dev, &bin_attr_eeprom);
 	usb_set_intfdata (interface, NULL);
 
-	if (cas)
+	if (cas) {
+		int_stop(cas);
 		kref_put(&cas->kref, cas_delete);
+	}
 
 	return result;
 
@@ -1604,9 +3759,23 @@ static void cas_disconnect(struct usb_interface *interface)
 
 	usb_deregister_dev(interface, &cas->uclass);
 	device_remove_file(&interface->dev, &dev_attr_status);
+	device_remove_file(&interface->dev, &dev_attr_restore_mode);
+	device_remove_file(&interface->dev, &dev_attr_queue_stats);
+	device_remove_file(&interface->dev, &dev_attr_timeouts);
+	device_remove_file(&interface->dev, &dev_attr_recovery);
+	device_remove_bin_file(&interface->dev, &bin_attr_eeprom);
 
 	/* first remove the files, then NULL the pointer */
 	usb_set_intfdata (interface, NULL);
+	cancel_work_sync(&cas->restore_work);
+	usb_kill_anchored_urbs(&cas->submitted);
+	int_stop(cas);
+	/* readers of the event fd get -ENODEV once the queue is drained */
+	spin_lock_irq(&cas->event_lock);
+	cas->disconnected = 1;
+	spin_unlock_irq(&cas->event_lock);
+	cancel_work_sync(&cas->recover_work);
+	wake_up_interruptible(&cas->event_wait);
 	mutex_destroy(&cas->lock);
 	kref_put(&cas->kref, cas_delete);
 	dev_info(&interface->dev, "%s Reader/Programmer now disconnected\n", cas->device_name);
@@ -1617,6 +3786,8 @@ static int __init cas_usb_init(void)
 {
 	int result;
 
+	restore_parse();
+
 	/* register this driver with the USB subsystem */
 	result = usb_register(&cas_driver);
 
@@ -1638,6 +3809,13 @@ module_exit(cas_usb_exit);
 module_param(debug, int, 0660);
 module_param(load_fx1_fw, int, 0660);
 module_param(load_fx2_fw, int, 0660);
+module_param(batch_records, int, 0660);
+module_param(priority_aging, int, 0660);
+module_param(timeout_floor, int, 0660);
+module_param(command_timeout_floor, int, 0660);
+module_param(timeout_ceiling, int, 0660);
+module_param(jtag_experimental, int, 0660);
+module_param_array(restore, charp, &restore_count, 0444);
 
 MODULE_AUTHOR(DRIVER_AUTHOR);
 MODULE_DESCRIPTION(DRIVER_DESC);
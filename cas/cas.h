@@ -22,6 +22,8 @@
 
 #include <linux/cdev.h>
 
+#include "cas_ioctl.h"
+
 #define internal_dev_info(dev, format, arg ...) pr_info(YELLOW_COLOR "%s %s: " format, dev_driver_string(dev), dev_name(dev) , ##arg)
 #define internal_dev_err(dev, format, arg ...) pr_err(YELLOW_COLOR "%s %s: " format, dev_driver_string(dev), dev_name(dev) , ##arg)
 #define internal_dev_dbg(dev, format, arg ...) pr_debug(YELLOW_COLOR "%s %s: " format, dev_driver_string(dev), dev_name(dev) , ##arg)
@@ -41,6 +43,13 @@
 #define SET_EE_VALUE                      0x10
 #define GET_EE_VALUE                      0x11
 
+/* vend_ax eeprom requests, single and two byte addressed */
+#define EEPROM_SMALL_REQUEST              0xA2
+#define EEPROM_LARGE_REQUEST              0xA9
+
+#define EEPROM_READ_SIZE 1024
+#define EEPROM_PAGE_SIZE 32
+
 #define NO_RESET_CPU 0
 #define RESET_CPU 1
 
@@ -87,8 +96,87 @@ typedef enum {
 	SIMPLE_DEBUG_OUT	= 6,
 } dynamite_debug_t;
 
+typedef enum {
+	RTT_BULK_OUT		= 0,
+	RTT_BULK_IN		= 1,
+	RTT_CONTROL		= 2,
+} cas_rtt_endpoint_t;
+
+typedef enum {
+	RECOVER_CLEAR_HALT	= 0,
+	RECOVER_RESET_DEVICE	= 1,
+} cas_recover_rung_t;
+
 #define MIN(a,b) (((a) <= (b)) ? (a) : (b))
 #define MAX_PKT_SIZE 64
+#define MAX_HS_PKT_SIZE 512
+#define BULK_IN_PACKETS 16
+#define MAX_WRITE_URB_SIZE (16 * 1024)
+#define WRITES_IN_FLIGHT 8
+#define MAX_SG_PAGES 16
+#define EVENT_QUEUE_SIZE 32
+#define RESTORE_ENTRIES 16
+#define SESSION_HOLD_MS 100
+#define DEVICE_MODES ARRAY_SIZE(cas_device_status)
+#define RTT_ENDPOINTS 3
+#define RTT_MIN_SAMPLES 8
+#define RECOVER_RUNGS 2
+#define RECOVER_OUT_TIMEOUTS 3
+#define SG_POLL_MS 100
+#define INT_RETRY_MS 10
+#define INT_RETRIES 6
+#define JTAG_WINDOW_SIZE (64 * 1024)
+#define JTAG_URB_SIZE (16 * 1024)
+#define JTAG_WINDOW_URBS (JTAG_WINDOW_SIZE / JTAG_URB_SIZE)
+#define JTAG_TIMEOUT 3000
+#define RESTORE_KEY_SIZE 64
+
+/* one bulk in/out endpoint pair with its own queue */
+struct cas_channel {
+	struct mutex lock;		/* serialises transfers on this channel */
+	__u8 bulk_in_endpointAddr;
+	__u8 bulk_out_endpointAddr;
+	int bulk_in_maxp;
+	int bulk_out_maxp;
+};
+
+/* response time estimate of one endpoint in one mode, in us */
+struct cas_rtt {
+	u32 srtt;
+	u32 rttvar;
+	u32 samples;
+};
+
+/* which rung of the recovery ladder brought the device back, and how fast */
+struct cas_recovery {
+	u32 count[RECOVER_RUNGS];
+	u32 failed;
+	u64 time_ns;		/* from the first failed transfer to the recovery */
+};
+
+/* how long the transactions of one priority class waited for their turn */
+struct cas_queue_stats {
+	u64 transactions;
+	u64 wait_ns;
+	u64 max_wait_ns;
+};
+
+struct usb_cas;
+
+/*
+ * Every open of the device node is a session. Sessions take turns on the
+ * device one transaction at a time, a write and the read of its reply
+ * count as one transaction.
+ */
+struct cas_session {
+	struct usb_cas *cas;
+	struct mutex lock;		/* one transaction of this session at a time */
+	struct list_head node;		/* on dispatch_queue while waiting */
+	int exclusive;
+	int priority;			/* PRIORITY_* */
+	ktime_t queued;			/* when the waiting transaction was queued */
+	int read_mode;			/* framing of reads through this file */
+};
 
 /* structure to hold all of our device specific stuff */
 struct usb_cas {
@@ -103,18 +191,118 @@ struct usb_cas {
 	int status;
 	struct mutex lock;
 	int state;
+	ktime_t tx_stamp;		/* completion time of the last bulk out transfer */
+	const char *fw_name;		/* the firmware image running on the device */
+	u32 fw_hash;			/* crc32 of the running firmware image */
+	struct cas_rtt rtt[DEVICE_MODES][RTT_ENDPOINTS];	/* updated under lock */
+	struct cas_recovery recovery;	/* updated under lock */
+	int recover_rung;		/* next rung to try, RECOVER_RUNGS while the device resets */
+	ktime_t recover_start;
+	int out_timeouts;		/* bulk out timeouts in a row */
 	unsigned char *bulk_in_buffer;		/* the buffer to receive data */
 	size_t bulk_in_size;		/* the size of the receive buffer */
+	int bulk_in_maxp;		/* max packet size of the bulk in endpoint */
+	int bulk_out_maxp;		/* max packet size of the bulk out endpoint */
 	__u8 bulk_in_endpointAddr;	/* the address of the bulk in endpoint */
 	__u8 bulk_out_endpointAddr;	/* the address of the bulk out endpoint */
+	struct cas_channel channel[MAX_CHANNELS];
+	int channels;			/* number of bulk endpoint pairs */
+	spinlock_t dispatch_lock;
+	struct list_head dispatch_queue[PRIORITY_CLASSES];	/* sessions waiting for their turn, oldest first */
+	struct cas_session *dispatch_owner;	/* session whose transaction runs */
+	int dispatch_held;		/* the owner wrote a request and its reply is still to be read */
+	wait_queue_head_t dispatch_wait;
+	struct delayed_work dispatch_hold;	/* ends a held turn whose reply never gets read */
+	struct cas_queue_stats queue_stats[PRIORITY_CLASSES];
+	int sessions;			/* open device nodes */
+	int exclusive;			/* one of them was opened with O_EXCL */
+	struct work_struct restore_work;	/* brings the device back into its saved mode */
+	struct work_struct recover_work;	/* resets the device for transfers that completed asynchronously */
+	struct cas_session mode_session;	/* mode switches from sysfs and restore_work */
+	struct urb *int_urb;		/* the urb polling the interrupt in endpoint */
+	unsigned char *int_buffer;
+	unsigned char int_last[EVENT_DATA_SIZE];	/* last report, repeats are coalesced */
+	int int_last_length;
+	int int_errors;			/* persistent errors in a row, the retry backs off with them */
+	int int_status;			/* the error the retry starts over from */
+	struct delayed_work int_retry;	/* restarts the interrupt urb after an error */
+	spinlock_t event_lock;
+	wait_queue_head_t event_wait;
+	DECLARE_KFIFO(events, struct cas_event, EVENT_QUEUE_SIZE);
+	u32 events_lost;		/* dropped since the last read, under event_lock */
+	int disconnected;		/* no more events will come */
+	struct semaphore limit_sem;	/* limiting the number of writes in progress */
+	struct usb_anchor submitted;	/* in case we need to retract our submissions */
 	struct kref kref;
 };
 
-struct cas_hex_record {
-	__u8 data_size;
-	__u8 data[64];
+/* one aggregated exchange of command records */
+struct cas_batch {
+	struct completion done;
+	atomic_t pending;
+	int status;
+};
+
+/* a scatter-gather request that is given up when it stalls or a signal comes */
+struct cas_sg_wait {
+	struct usb_sg_request io;
+	struct delayed_work poll;
+	struct task_struct *task;
+	unsigned long timeout;		/* jiffies without progress before the request is cancelled */
+	unsigned long deadline;
+	size_t bytes;			/* progress seen by the last poll */
+	int status;			/* why the request was cancelled */
+};
+
+/* a single bulk in transfer that records when it completed */
+struct cas_stamp {
+	struct completion done;
+	ktime_t time;
+};
+
+/* the mode a device should be brought into when it shows up */
+struct cas_restore {
+	char key[RESTORE_KEY_SIZE];	/* serial number or usb port path */
+	int mode;
 };
 
+typedef enum {
+	SESSION_NOWAIT = 0x01,	/* fail with -EAGAIN rather than wait for the turn */
+	SESSION_REPLY = 0x02,	/* continues a held turn of the same session */
+} cas_session_flags_t;
+
+struct io_uring_cmd;
+
+/* one asynchronous io_uring passthrough command */
+struct cas_uring_request {
+	struct usb_cas *cas;
+	struct io_uring_cmd *ioucmd;
+	struct urb *urb;
+	struct usb_ctrlrequest *setup;
+	struct delayed_work expire;	/* unlinks the urb once the timeout passed */
+	unsigned char *buffer;
+	void __user *user;
+	ktime_t start;
+	int length;
+	int dir_in;
+	int endpoint;			/* rtt estimate the transfer is timed by */
+	int timeout;
+	int expired;
+	int result;
+};
+
+/*
+ * command tables are packed as a length byte followed by that many data
+ * bytes, the length is counted by the compiler and a zero ends the table
+ */
+#define CAS_RECORD(...) sizeof((__u8[]){ __VA_ARGS__ }), __VA_ARGS__
+#define CAS_RECORD_END 0
+
+static inline const __u8 *cas_record_next(const __u8 *record)
+{
+	return record + record[0] + 1;
+}
+
 #define NORMAL_COLOR  "\x1B[0m"
 #define RED_COLOR  "\x1B[31m"
 #define GREEN_COLOR  "\x1B[32m"
@@ -21,121 +21,122 @@
 #define _CAS_COMMANDS_H_
 
 /* smartmouse 357 mhz */
-static const struct cas_hex_record smartmouse_357_code[] = {
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd2, 0x50, 0xa6, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08,
-       0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 smartmouse_357_code[] = {
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd2, 0x50, 0xa6, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08,
+           0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4,
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x95, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 2, {0x61, 0x10} },
-{ 0, {} },
+CAS_RECORD(0x61, 0x10),
+CAS_RECORD_END
 };
 
 /* smartmouse 368 mhz */
-static const struct cas_hex_record smartmouse_368_code[] = {
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd4, 0x4c, 0x83, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x69, 0x06, 0x08,
-       0x88, 0x80, 0xe9, 0x30, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 smartmouse_368_code[] = {
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd4, 0x4c, 0x83, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x69, 0x06, 0x08,
+           0x88, 0x80, 0xe9, 0x30, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4,
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x95, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 2, {0x61, 0x10} },
-{ 0, {} },
+CAS_RECORD(0x61, 0x10),
+CAS_RECORD_END
 };
 
 /* smartmouse 400 mhz */
-static const struct cas_hex_record smartmouse_400_code[] = {
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd0, 0x2e, 0x01, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08,
-       0x88, 0x80, 0xe9, 0x28, 0x6b, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 smartmouse_400_code[] = {
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd0, 0x2e, 0x01, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08,
+           0x88, 0x80, 0xe9, 0x28, 0x6b, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4,
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x95, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 2, {0x61, 0x10} },
-{ 0, {} },
+CAS_RECORD(0x61, 0x10),
+CAS_RECORD_END
 };
 
 /* smartmouse 600 mhz */
-static const struct cas_hex_record smartmouse_600_code[] = {
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd0, 0x1d, 0x00, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x42, 0x06, 0x08,
-       0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 smartmouse_600_code[] = {
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd0, 0x1d, 0x00, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x42, 0x06, 0x08,
+           0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4,
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x95, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 2, {0x61, 0x10} },
-{ 0, {} },
+CAS_RECORD(0x61, 0x10),
+CAS_RECORD_END
 };
 
 /* phoenix 357 mhz */
-static const struct cas_hex_record phoenix_357_code[] = {
-{ 2, {0x62, 0xef} },
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd2, 0x50, 0xa6, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08, 0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 phoenix_357_code[] = {
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd2, 0x50, 0xa6, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08, 0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4 } },
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x97, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 0, {} },
+CAS_RECORD_END
 };
 
 /* phoenix 368 mhz */
-static const struct cas_hex_record phoenix_368_code[] = {
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd4, 0x4c, 0x83, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x69, 0x06, 0x08,
-       0x88, 0x80, 0xe9, 0x30, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 phoenix_368_code[] = {
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd4, 0x4c, 0x83, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x69, 0x06, 0x08,
+           0x88, 0x80, 0xe9, 0x30, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4,
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x95, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 2, {0x62, 0xef} },
-{ 0, {} },
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD_END
 };
 
 /* phoenix 400 mhz */
-static const struct cas_hex_record phoenix_400_code[] = {
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd0, 0x2e, 0x01, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08,
-       0x88, 0x80, 0xe9, 0x28, 0x6b, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 phoenix_400_code[] = {
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd0, 0x2e, 0x01, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x64, 0x06, 0x08,
+           0x88, 0x80, 0xe9, 0x28, 0x6b, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4,
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x97, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 2, {0x62, 0xef} },
-{ 0, {} },
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD_END
 };
 
 /* phoenix 600 mhz */
-static const struct cas_hex_record phoenix_600_code[] = {
-{ 2, {0x68, 0x08} },
-{ 2, {0x68, 0x20} },
-{ 2, {0x62, 0xef} },
-{ 2, {0x67, 0xef} },
-{ 32, {0x57, 0xd0, 0x1d, 0x00, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x42, 0x06, 0x08,
-       0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1} },
+static const __u8 phoenix_600_code[] = {
+CAS_RECORD(0x68, 0x08),
+CAS_RECORD(0x68, 0x20),
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD(0x67, 0xef),
+CAS_RECORD(0x57, 0xd0, 0x1d, 0x00, 0x00, 0x00, 0x80, 0x3f, 0x04, 0x5a, 0x04, 0x00, 0x00, 0x42, 0x06, 0x08,
+           0x88, 0x80, 0xe9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xb0, 0x4e, 0x93, 0x4f, 0x15, 0x90, 0xd1),
 //       0x79, 0x5b, 0xdf, 0x6e, 0xab, 0x07, 0x81, 0x3b, 0x16, 0x70, 0xe6, 0x71, 0x73, 0x8e, 0x11, 0xb4,
 //       0x80, 0xaa, 0x2e, 0x0a, 0xdb, 0xbf, 0x97, 0x6f, 0x61, 0x2c, 0x42, 0x21, 0xde, 0x9f, 0x2a, 0x00 } },
-{ 2, {0x62, 0xef} },
-{ 0, {} },
+CAS_RECORD(0x62, 0xef),
+CAS_RECORD_END
 };
 
-static const struct cas_hex_record cam_host_code[] = {
-{ 64, {0xb1, 0x2f, 0x3d, 0xec, 0x11, 0x00, 0x00, 0x00, 0x46, 0xe3, 0x9d, 0xff, 0xbf, 0xb7, 0xeb, 0x37,
-       0x97, 0x0d, 0xf3, 0xf8, 0x05, 0xef, 0x75, 0xff, 0xfe, 0xdf, 0x6f, 0xe7, 0xb4, 0xff, 0x5e, 0xea,
-       0xd9, 0xe4, 0xe9, 0xd6, 0xff, 0xdd, 0x0f, 0x87, 0x70, 0xb6, 0xdd, 0xec, 0xe3, 0x5b, 0xa7, 0xee,
-       0x6f, 0xb4, 0x7e, 0x7e, 0xdf, 0x44, 0x95, 0xbB, 0xce, 0xe6, 0xda, 0xf7, 0xee, 0x7f, 0xe3, 0xdf} },
+static const __u8 cam_host_code[] = {
+CAS_RECORD(0xb1, 0x2f, 0x3d, 0xec, 0x11, 0x00, 0x00, 0x00, 0x46, 0xe3, 0x9d, 0xff, 0xbf, 0xb7, 0xeb, 0x37,
+           0x97, 0x0d, 0xf3, 0xf8, 0x05, 0xef, 0x75, 0xff, 0xfe, 0xdf, 0x6f, 0xe7, 0xb4, 0xff, 0x5e, 0xea,
+           0xd9, 0xe4, 0xe9, 0xd6, 0xff, 0xdd, 0x0f, 0x87, 0x70, 0xb6, 0xdd, 0xec, 0xe3, 0x5b, 0xa7, 0xee,
+           0x6f, 0xb4, 0x7e, 0x7e, 0xdf, 0x44, 0x95, 0xbB, 0xce, 0xe6, 0xda, 0xf7, 0xee, 0x7f, 0xe3, 0xdf),
+CAS_RECORD_END
 };
 
 #endif
@@ -20,284 +20,284 @@
 #ifndef _CAS_INIT_H
 #define _CAS_INIT_H
 
-static const struct cas_hex_record cas2_init_code[] = {
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 1, {0x10} },
-{ 1, {0x12} },
-{ 0, {} },
+static const __u8 cas2_init_code[] = {
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x10),
+CAS_RECORD(0x12),
+CAS_RECORD_END
 };
 
-static const struct cas_hex_record cas2_plus_init_code[] = {
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 1, {0x10} },
-{ 1, {0x12} },
-{ 0, {} },
+static const __u8 cas2_plus_init_code[] = {
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x10),
+CAS_RECORD(0x12),
+CAS_RECORD_END
 };
 
-static const struct cas_hex_record cas2_plus2_init_code[] = {
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 1, {0x10} },
-{ 1, {0x12} },
-{ 0, {} },
+static const __u8 cas2_plus2_init_code[] = {
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x10),
+CAS_RECORD(0x12),
+CAS_RECORD_END
 };
 
-static const struct cas_hex_record cas2_plus2_crypto_plus_init_code[] = {
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 1, {0x10} },
-{ 1, {0x12} },
-{ 0, {} },
+static const __u8 cas2_plus2_crypto_plus_init_code[] = {
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x01, 0x00, 0x00),
+CAS_RECORD(0x01, 0x00, 0x08),
+CAS_RECORD(0x01, 0x00, 0x10),
+CAS_RECORD(0x01, 0x00, 0x18),
+CAS_RECORD(0x01, 0x00, 0x20),
+CAS_RECORD(0x01, 0x00, 0x28),
+CAS_RECORD(0x01, 0x00, 0x30),
+CAS_RECORD(0x01, 0x00, 0x38),
+CAS_RECORD(0x01, 0x00, 0x40),
+CAS_RECORD(0x01, 0x00, 0x48),
+CAS_RECORD(0x01, 0x00, 0x50),
+CAS_RECORD(0x01, 0x00, 0x58),
+CAS_RECORD(0x01, 0x00, 0x60),
+CAS_RECORD(0x01, 0x00, 0x68),
+CAS_RECORD(0x01, 0x00, 0x70),
+CAS_RECORD(0x01, 0x00, 0x78),
+CAS_RECORD(0x01, 0x00, 0x80),
+CAS_RECORD(0x01, 0x00, 0x88),
+CAS_RECORD(0x01, 0x00, 0x90),
+CAS_RECORD(0x01, 0x00, 0x98),
+CAS_RECORD(0x01, 0x00, 0xA0),
+CAS_RECORD(0x01, 0x00, 0xA8),
+CAS_RECORD(0x01, 0x00, 0xB0),
+CAS_RECORD(0x01, 0x00, 0xB8),
+CAS_RECORD(0x01, 0x00, 0xC0),
+CAS_RECORD(0x01, 0x00, 0xC8),
+CAS_RECORD(0x01, 0x00, 0xD0),
+CAS_RECORD(0x01, 0x00, 0xD8),
+CAS_RECORD(0x01, 0x00, 0xE0),
+CAS_RECORD(0x01, 0x00, 0xE8),
+CAS_RECORD(0x01, 0x00, 0xF0),
+CAS_RECORD(0x01, 0x00, 0xF8),
+CAS_RECORD(0x10),
+CAS_RECORD(0x12),
+CAS_RECORD_END
 };
 
 #endif
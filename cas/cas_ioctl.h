@@ -21,6 +21,7 @@
 #define _CAS_IOCTL_H
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 typedef enum {
 	NOFW		= 0,
@@ -112,6 +113,195 @@ struct cas_device_information_command {
 	int pid;
 };
 
+#define EEPROM_SMALL_SIZE 256
+#define EEPROM_LARGE_SIZE 8192
+
+struct cas_eeprom_command {
+	int offset;
+	int length;
+	void *buffer;
+};
+
+#define BULK_V2_MAX_LENGTH (64 * 1024 * 1024)
+#define BULK_V2_CHANNEL_MASK 0xff
+#define VENDOR_V2_MAX_LENGTH 65535
+
+#define MAX_CHANNELS 4
+
+/* bulk endpoint pairs found on the interface, channel 0 is the command channel */
+struct cas_channel_information_command {
+	__u32 channels;
+	__u8 in_endpoint[MAX_CHANNELS];
+	__u8 out_endpoint[MAX_CHANNELS];
+	__u16 in_maxp[MAX_CHANNELS];
+	__u16 out_maxp[MAX_CHANNELS];
+};
+
+#define EVENT_DATA_SIZE 16
+
+typedef enum {
+	EVENT_STATUS = 1,	/* the interrupt endpoint reported new status data */
+	EVENT_RESET = 2,	/* firmware was loaded and the cpu restarted */
+	EVENT_ERROR = 3,	/* the interrupt endpoint failed */
+	EVENT_OVERFLOW = 4,	/* the oldest events were dropped, the queue was full */
+} cas_event_type_t;
+
+/* one record read from the event fd */
+struct cas_event {
+	__s64 time_ns;		/* CLOCK_MONOTONIC */
+	__u32 type;
+	__s32 status;		/* urb status for EVENT_ERROR, events dropped for EVENT_OVERFLOW */
+	__u32 length;		/* valid bytes in data */
+	__u8 data[EVENT_DATA_SIZE];
+};
+
+/* prefix of every transfer returned in READ_MODE_TIMESTAMP, times are CLOCK_MONOTONIC */
+struct cas_read_header {
+	__s64 rx_ns;		/* completion of this bulk in transfer */
+	__s64 tx_ns;		/* completion of the last bulk out transfer */
+	__s32 status;		/* 0 or a negative errno */
+	__u32 length;		/* payload bytes following the header */
+};
+
+/* fixed width layout, identical for 32 and 64 bit user space */
+struct cas_bulk_command_v2 {
+	__u64 buffer;
+	__u32 length;		/* in: requested, out: transferred */
+	__u32 flags;		/* channel index, other bits must be zero */
+};
+
+#define PRIORITY_CLASSES 3
+
+/* the class an open device node queues its transactions in */
+typedef enum {
+	PRIORITY_HIGH = 0,	/* ecm and other latency critical requests */
+	PRIORITY_NORMAL = 1,
+	PRIORITY_LOW = 2,	/* emm updates, diagnostics */
+} cas_priority_t;
+
+/* a bulk request and the read of its reply, with no other session in between */
+struct cas_transfer_command {
+	__u64 request;
+	__u64 reply;
+	__u32 request_length;
+	__u32 reply_length;	/* in: size of the reply buffer, out: bytes received */
+	__u32 flags;		/* channel index, other bits must be zero */
+	__u32 reserved;		/* must be zero */
+};
+
+struct cas_vendor_command_v2 {
+	__u64 buffer;
+	__u32 length;		/* in: requested, out: transferred */
+	__u16 request;
+	__u16 address;
+	__u16 index;
+	__u16 flags;		/* must be zero */
+};
+
+#define URING_MAX_LENGTH (256 * 1024)
+
+/* command area of an io_uring passthrough sqe, fits the 16 byte sqe->cmd */
+struct cas_uring_command {
+	__u64 buffer;
+	__u32 length;
+	__u8 request;		/* vendor request */
+	__u8 flags;		/* channel index for bulk commands, otherwise zero */
+	__u16 address;		/* vendor address */
+};
+
+/* sqe->cmd_op values */
+typedef enum {
+	URING_SEND_BULK = 0x01,
+	URING_RECV_BULK = 0x02,
+	URING_SEND_VENDOR = 0x03,
+	URING_RECV_VENDOR = 0x04,
+} cas_uring_op_t;
+
+#define JTAG_MAX_SCANS 65536
+#define JTAG_MAX_SCAN_BYTES 32768
+#define JTAG_MAX_VECTORS (16 * 1024 * 1024)
+/*
+ * IOCTL_JTAG_SCAN_COMMAND is experimental and not a stable interface. The
+ * wire format below is a guess at the undocumented jtag firmware, the
+ * ioctl fails with EOPNOTSUPP unless the module is loaded with
+ * jtag_experimental=1, and it may change once the firmware is verified.
+ */
+#define JTAG_HEADER_SIZE 6
+#define JTAG_WIRE_CAPTURE 0x80
+
+typedef enum {
+	JTAG_SCAN_IR = 1,	/* shift bits of tdi through the instruction register */
+	JTAG_SCAN_DR = 2,	/* shift bits of tdi through the data register */
+	JTAG_SCAN_TMS = 3,	/* clock bits of tms with tdi low */
+	JTAG_SCAN_STATE = 4,	/* walk to end_state */
+	JTAG_SCAN_RUN = 5,	/* clock bits times in the current state, then walk to end_state */
+} cas_jtag_scan_type_t;
+
+typedef enum {
+	JTAG_SCAN_CAPTURE = 0x01,	/* return the tdo of this ir or dr scan */
+	JTAG_SCAN_COMPARE = 0x02,	/* check the captured tdo against the expected one under mask */
+} cas_jtag_scan_flags_t;
+
+/* tap states, numbered as in xsvf */
+typedef enum {
+	JTAG_STATE_RESET = 0x00,
+	JTAG_STATE_IDLE = 0x01,
+	JTAG_STATE_DRSELECT = 0x02,
+	JTAG_STATE_DRCAPTURE = 0x03,
+	JTAG_STATE_DRSHIFT = 0x04,
+	JTAG_STATE_DREXIT1 = 0x05,
+	JTAG_STATE_DRPAUSE = 0x06,
+	JTAG_STATE_DREXIT2 = 0x07,
+	JTAG_STATE_DRUPDATE = 0x08,
+	JTAG_STATE_IRSELECT = 0x09,
+	JTAG_STATE_IRCAPTURE = 0x0a,
+	JTAG_STATE_IRSHIFT = 0x0b,
+	JTAG_STATE_IREXIT1 = 0x0c,
+	JTAG_STATE_IRPAUSE = 0x0d,
+	JTAG_STATE_IREXIT2 = 0x0e,
+	JTAG_STATE_IRUPDATE = 0x0f,
+} cas_jtag_state_t;
+
+/*
+ * One scan operation. Vectors are offsets into the vector buffer and hold
+ * (bits + 7) / 8 bytes, the first bit shifted is bit 0 of the first byte.
+ * An ir or dr scan ending in its shift state leaves the shift open for the
+ * next scan of the same register.
+ */
+struct cas_jtag_scan {
+	__u8 type;		/* JTAG_SCAN_* */
+	__u8 flags;
+	__u8 end_state;		/* JTAG_STATE_* */
+	__u8 reserved;		/* must be zero */
+	__u32 bits;
+	__u32 tdi;
+	__u32 tms;
+	__u32 tdo;		/* expected tdo */
+	__u32 mask;
+};
+
+/*
+ * The scans go to the jtag firmware as one stream: the type, or'ed with
+ * JTAG_WIRE_CAPTURE when the tdo is wanted, the end state, the 32 bit little
+ * endian bit count and the tdi or tms bytes. The firmware returns the tdo of
+ * the captured scans as one stream, byte aligned per scan.
+ */
+struct cas_jtag_command {
+	__u64 scans;		/* array of struct cas_jtag_scan */
+	__u64 vectors;
+	__u64 tdo;		/* captured tdo of all scans, back to back */
+	__u32 count;
+	__u32 vectors_length;
+	__u32 tdo_length;	/* in: size of the tdo buffer, out: bytes captured */
+	__u32 failed;		/* out: first scan whose tdo did not match, count if all did */
+};
+
+typedef enum {
+	READ_MODE_FRAMED = 0,	/* a read ends at a short packet or zlp */
+	READ_MODE_STREAM = 1,	/* a read waits until the buffer is full */
+	READ_MODE_TIMESTAMP = 2,	/* like framed, every transfer prefixed by a read header */
+} cas_read_mode_t;
+
 typedef enum {
 	IOCTL_SET_CAM = 0x000000c0,
 	IOCTL_SET_MM =  0x000000c1,
@@ -137,6 +327,18 @@ typedef enum {
 	IOCTL_SEND_VENDOR_COMMAND = 0x00000c21,
 	IOCTL_RECV_VENDOR_COMMAND = 0x00000c22,
 	IOCTL_DEVICE_INFORMATION_COMMAND = 0x00000c23,
+	IOCTL_READ_EEPROM_COMMAND = 0x00000c24,
+	IOCTL_WRITE_EEPROM_COMMAND = 0x00000c25,
+	IOCTL_SET_READ_MODE = 0x00000c26,
+	IOCTL_SEND_BULK_COMMAND_V2 = 0x00000c27,
+	IOCTL_RECV_BULK_COMMAND_V2 = 0x00000c28,
+	IOCTL_SEND_VENDOR_COMMAND_V2 = 0x00000c29,
+	IOCTL_RECV_VENDOR_COMMAND_V2 = 0x00000c30,
+	IOCTL_CHANNEL_INFORMATION_COMMAND = 0x00000c31,
+	IOCTL_GET_EVENT_FD = 0x00000c32,
+	IOCTL_JTAG_SCAN_COMMAND = 0x00000c34,
+	IOCTL_TRANSFER_COMMAND = 0x00000c36,
+	IOCTL_SET_PRIORITY = 0x00000c37,
 } _cas_ioctl_command_t;
 
 #define IOCTL_DIR_OUT 0x0
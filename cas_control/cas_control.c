@@ -19,11 +19,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <linux/input.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/ioctl.h>
 
 #include "../cas/cas_ioctl.h"
 
@@ -44,6 +49,13 @@ tArgs vArgs[] =
 	{ "-p", " --setPhoenix	", "Args: 357, 368, 400, 600\n\tSet phoenix mode" },
 	{ "-s", " --setSmartmouse	", "Args: 357, 368, 400, 600\n\tSet smartmouse mode" },
 	{ "-h", " --setHost       ", "Args: No argumens\n\tSet host mode" },
+	{ "-r", " --readEeprom    ", "Args: file\n\tDump the config eeprom to file" },
+	{ "-w", " --writeEeprom   ", "Args: file\n\tRestore the config eeprom from file" },
+	{ "-b", " --benchEeprom   ", "Args: runs\n\tTime full config eeprom dumps" },
+	{ "-J", " --jtag-play     ", "Args: file\n\tPlay an svf or xsvf file in jtag mode, experimental, needs jtag_experimental=1" },
+	{ "-u", " --diablo-update ", "Args: file\n\tStream a diablo update image, resumes an interrupted update" },
+	{ "-S", " --simulate      ", "Args: [blocks]\n\tRun the following updates against a simulated cam, dropping the link after blocks" },
+	{ "-X", " --experimental  ", "Args: No argumens\n\tLet the following updates write to a real cam, the block protocol is unconfirmed" },
 	{ NULL, NULL, NULL }
 };
 
@@ -92,6 +104,1172 @@ void usage(char *prg, char *cmd)
 	exit(1);
 }
 
+static void open_device(void)
+{
+	fd = open(CAS_DEVICE, O_RDWR);
+	if (fd < 0)
+	{
+		fprintf(stderr, "Failed open device: %s\n", CAS_DEVICE);
+		exit(1);
+	}
+}
+
+static double elapsed_ms(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000.0 + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static int dump_eeprom(unsigned char *buffer, double *ms)
+{
+	struct cas_eeprom_command cas_eeprom_cmd;
+	struct timespec start, end;
+
+	cas_eeprom_cmd.offset = 0;
+	cas_eeprom_cmd.length = EEPROM_LARGE_SIZE;
+	cas_eeprom_cmd.buffer = buffer;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (ioctl(fd, IOCTL_READ_EEPROM_COMMAND, &cas_eeprom_cmd) < 0)
+	{
+		fprintf(stderr, "Failed send ioctl command: IOCTL_READ_EEPROM_COMMAND, (%m)\n");
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	*ms = elapsed_ms(&start, &end);
+	return cas_eeprom_cmd.length;
+}
+
+static int read_eeprom_file(char *file)
+{
+	unsigned char buffer[EEPROM_LARGE_SIZE];
+	double ms;
+	FILE *f;
+	int len;
+
+	len = dump_eeprom(buffer, &ms);
+	if (len < 0)
+		return -1;
+
+	f = fopen(file, "wb");
+	if (f == NULL || fwrite(buffer, 1, len, f) != len)
+	{
+		fprintf(stderr, "Failed write file: %s\n", file);
+		if (f)
+			fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	fprintf(stderr, "Read %d bytes of eeprom in %.3f ms\n", len, ms);
+	return 0;
+}
+
+static int write_eeprom_file(char *file)
+{
+	unsigned char buffer[EEPROM_LARGE_SIZE], verify[EEPROM_LARGE_SIZE];
+	struct cas_eeprom_command cas_eeprom_cmd;
+	struct timespec start, end;
+	double ms;
+	FILE *f;
+	int len;
+
+	f = fopen(file, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Failed open file: %s\n", file);
+		return -1;
+	}
+	len = fread(buffer, 1, sizeof(buffer), f);
+	fclose(f);
+
+	cas_eeprom_cmd.offset = 0;
+	cas_eeprom_cmd.length = len;
+	cas_eeprom_cmd.buffer = buffer;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (ioctl(fd, IOCTL_WRITE_EEPROM_COMMAND, &cas_eeprom_cmd) < 0)
+	{
+		fprintf(stderr, "Failed send ioctl command: IOCTL_WRITE_EEPROM_COMMAND, (%m)\n");
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (dump_eeprom(verify, &ms) < len || memcmp(buffer, verify, len) != 0)
+	{
+		fprintf(stderr, "Eeprom verify failed\n");
+		return -1;
+	}
+
+	fprintf(stderr, "Wrote and verified %d bytes of eeprom in %.3f ms\n", len, elapsed_ms(&start, &end) + ms);
+	return 0;
+}
+
+static int bench_eeprom(int runs)
+{
+	unsigned char buffer[EEPROM_LARGE_SIZE];
+	double ms, min = 0, max = 0, total = 0;
+	int i, len = 0;
+
+	for (i = 0; i < runs; i++)
+	{
+		len = dump_eeprom(buffer, &ms);
+		if (len < 0)
+			return -1;
+		if (i == 0 || ms < min)
+			min = ms;
+		if (ms > max)
+			max = ms;
+		total += ms;
+	}
+
+	fprintf(stderr, "Eeprom dump: %d bytes, %d runs, min %.3f ms, avg %.3f ms, max %.3f ms, %.1f KiB/s\n",
+		len, runs, min, total / runs, max, (len / 1024.0) / (total / runs / 1000.0));
+	return 0;
+}
+
+/* crc32 as the driver computes it, reflected, seeded with ~0, not inverted */
+static unsigned int crc32_le(unsigned int crc, const unsigned char *p, int len)
+{
+	int i;
+
+	while (len--)
+	{
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320 : 0);
+	}
+	return crc;
+}
+
+static unsigned int get_be32(const unsigned char *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void put_be32(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+/* how the update flows talk to the device, either the driver or a simulated cam */
+struct transport
+{
+	int (*set_mode)(struct transport *t);
+	int (*send)(struct transport *t, const unsigned char *buf, int len);
+	int (*recv)(struct transport *t, unsigned char *buf, int len);
+	int fail_after;		/* simulated: blocks accepted before the link drops, 0 never */
+	int blocks;		/* simulated: blocks accepted so far */
+	unsigned char acks[DIABLO_WINDOW][DIABLO_ACK_SIZE];
+	int ack_head, ack_tail;
+};
+
+static int device_set_mode(struct transport *t)
+{
+	open_device();
+	if (ioctl(fd, IOCTL_SET_DIABLO) < 0)
+	{
+		fprintf(stderr, "Failed send ioctl command: IOCTL_SET_DIABLO, (%m)\n");
+		return -1;
+	}
+	/* one read returns one ack packet */
+	if (ioctl(fd, IOCTL_SET_READ_MODE, READ_MODE_FRAMED) < 0)
+	{
+		fprintf(stderr, "Failed send ioctl command: IOCTL_SET_READ_MODE, (%m)\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int device_send(struct transport *t, const unsigned char *buf, int len)
+{
+	/* writes return once the urb is queued, so several blocks are in flight */
+	return write(fd, buf, len);
+}
+
+static int device_recv(struct transport *t, unsigned char *buf, int len)
+{
+	return read(fd, buf, len);
+}
+
+static int simulated_set_mode(struct transport *t)
+{
+	t->blocks = 0;
+	t->ack_head = t->ack_tail = 0;
+	return 0;
+}
+
+static int simulated_send(struct transport *t, const unsigned char *buf, int len)
+{
+	unsigned char *ack;
+
+	if (len < DIABLO_BLOCK_HEADER || buf[0] != DIABLO_BLOCK_WRITE || len != DIABLO_BLOCK_HEADER + ((buf[6] << 8) | buf[7]) ||
+	    t->ack_head - t->ack_tail >= DIABLO_WINDOW)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	if (t->fail_after && t->blocks >= t->fail_after)
+	{
+		errno = ENODEV;
+		return -1;
+	}
+
+	ack = t->acks[t->ack_head++ % DIABLO_WINDOW];
+	ack[0] = DIABLO_BLOCK_ACK;
+	put_be32(ack + 1, crc32_le(~0, buf + DIABLO_BLOCK_HEADER, len - DIABLO_BLOCK_HEADER));
+	t->blocks++;
+	return len;
+}
+
+static int simulated_recv(struct transport *t, unsigned char *buf, int len)
+{
+	if (t->ack_tail == t->ack_head)
+	{
+		errno = ETIMEDOUT;
+		return -1;
+	}
+	len = len < DIABLO_ACK_SIZE ? len : DIABLO_ACK_SIZE;
+	memcpy(buf, t->acks[t->ack_tail++ % DIABLO_WINDOW], len);
+	return len;
+}
+
+static struct transport device_transport = { device_set_mode, device_send, device_recv };
+static struct transport simulated_transport = { simulated_set_mode, simulated_send, simulated_recv };
+static struct transport *transport = &device_transport;
+static int experimental = 0;	/* the diablo block protocol is a guess, real cams need -X */
+
+static unsigned char *load_file(char *file, int *size)
+{
+	unsigned char *buffer;
+	FILE *f;
+
+	f = fopen(file, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Failed open file: %s\n", file);
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	buffer = malloc(*size > 0 ? *size : 1);
+	if (buffer == NULL || fread(buffer, 1, *size, f) != *size)
+	{
+		fprintf(stderr, "Failed read file: %s\n", file);
+		free(buffer);
+		buffer = NULL;
+	}
+	fclose(f);
+	return buffer;
+}
+
+struct diablo_block
+{
+	int segment;
+	unsigned int offset;	/* in the image file */
+	unsigned int position;	/* in the segment */
+	int length;
+};
+
+/* split the segments of an update image into blocks, returns the block count */
+static int diablo_parse(const unsigned char *image, int size, struct diablo_block **blocks)
+{
+	unsigned int offset, length, header;
+	int i, n, count = 0;
+
+	if (size < DIABLO_TABLE_OFFSET + 8 || (memcmp(image, "DIABLO", DIABLO_MAGIC_SIZE) && memcmp(image, "D2ABLO", DIABLO_MAGIC_SIZE)))
+	{
+		fprintf(stderr, "Not a diablo update image\n");
+		return -1;
+	}
+
+	/* the first segment starts right after the header */
+	header = get_be32(image + DIABLO_TABLE_OFFSET);
+	if (header < DIABLO_TABLE_OFFSET + 8 || header > size)
+	{
+		fprintf(stderr, "Bad diablo image header\n");
+		return -1;
+	}
+
+	*blocks = NULL;
+	for (i = 0; DIABLO_TABLE_OFFSET + 8 * (i + 1) <= header; i++)
+	{
+		offset = get_be32(image + DIABLO_TABLE_OFFSET + 8 * i);
+		length = get_be32(image + DIABLO_TABLE_OFFSET + 8 * i + 4);
+		if (offset == 0 && length == 0)
+			break;
+		if (offset < header || offset > size || length > size - offset)
+		{
+			fprintf(stderr, "Diablo segment %d out of range (offset: 0x%x, length: 0x%x)\n", i, offset, length);
+			free(*blocks);
+			return -1;
+		}
+
+		n = (length + DIABLO_BLOCK_SIZE - 1) / DIABLO_BLOCK_SIZE;
+		*blocks = realloc(*blocks, (count + n) * sizeof(struct diablo_block));
+		if (*blocks == NULL)
+			return -1;
+		for (; length > 0; count++)
+		{
+			(*blocks)[count].segment = i;
+			(*blocks)[count].offset = offset;
+			(*blocks)[count].position = offset - get_be32(image + DIABLO_TABLE_OFFSET + 8 * i);
+			(*blocks)[count].length = length < DIABLO_BLOCK_SIZE ? length : DIABLO_BLOCK_SIZE;
+			offset += (*blocks)[count].length;
+			length -= (*blocks)[count].length;
+		}
+		fprintf(stderr, "Segment %d: offset 0x%x, %d blocks\n", i, get_be32(image + DIABLO_TABLE_OFFSET + 8 * i), n);
+	}
+
+	if (count == 0)
+	{
+		fprintf(stderr, "Diablo image has no segments\n");
+		return -1;
+	}
+	return count;
+}
+
+/* the resume file records the image crc and the first block not yet verified */
+static int resume_load(char *name, unsigned int crc)
+{
+	unsigned int saved_crc;
+	int block;
+	FILE *f;
+
+	f = fopen(name, "r");
+	if (f == NULL)
+		return 0;
+	if (fscanf(f, "%x %d", &saved_crc, &block) != 2 || saved_crc != crc || block < 0)
+		block = 0;
+	fclose(f);
+	return block;
+}
+
+static void resume_save(char *name, unsigned int crc, int block)
+{
+	FILE *f;
+
+	f = fopen(name, "w");
+	if (f == NULL)
+		return;
+	fprintf(f, "%08x %d\n", crc, block);
+	fclose(f);
+}
+
+static int diablo_send_block(const unsigned char *image, struct diablo_block *block)
+{
+	unsigned char packet[DIABLO_BLOCK_HEADER + DIABLO_BLOCK_SIZE];
+
+	packet[0] = DIABLO_BLOCK_WRITE;
+	packet[1] = block->segment;
+	put_be32(packet + 2, block->position);
+	packet[6] = block->length >> 8;
+	packet[7] = block->length;
+	memcpy(packet + DIABLO_BLOCK_HEADER, image + block->offset, block->length);
+
+	if (transport->send(transport, packet, DIABLO_BLOCK_HEADER + block->length) != DIABLO_BLOCK_HEADER + block->length)
+	{
+		fprintf(stderr, "\nFailed send block at 0x%x, (%m)\n", block->offset);
+		return -1;
+	}
+	return 0;
+}
+
+static int diablo_update(char *file)
+{
+	unsigned char ack[DIABLO_ACK_SIZE], *image;
+	struct diablo_block *blocks;
+	struct timespec start, now;
+	char resume[1024];
+	int size, count, first, sent, done, bytes = 0, result = -1;
+	unsigned int crc;
+	double ms;
+
+	/* unverified packets written into the flash of a cam can brick it */
+	if (transport == &device_transport && !experimental)
+	{
+		fprintf(stderr, "The diablo block protocol is unconfirmed, use -S to simulate or -X to write to a real cam\n");
+		return -1;
+	}
+
+	image = load_file(file, &size);
+	if (image == NULL)
+		return -1;
+	count = diablo_parse(image, size, &blocks);
+	if (count < 0)
+	{
+		free(image);
+		return -1;
+	}
+
+	crc = crc32_le(~0, image, size);
+	snprintf(resume, sizeof(resume), "%s.resume", file);
+	first = resume_load(resume, crc);
+	if (first >= count)
+		first = 0;
+	if (first)
+		fprintf(stderr, "Resuming at block %d of %d\n", first, count);
+
+	if (transport->set_mode(transport) < 0)
+		goto out;
+
+	/* keep a window of blocks in flight, the oldest is verified before the next goes out */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	done = first;
+	for (sent = first; sent < count && sent < first + DIABLO_WINDOW; sent++)
+		if (diablo_send_block(image, &blocks[sent]) < 0)
+			goto save;
+
+	for (done = first; done < count; done++)
+	{
+		if (transport->recv(transport, ack, sizeof(ack)) < DIABLO_ACK_SIZE || ack[0] != DIABLO_BLOCK_ACK)
+		{
+			fprintf(stderr, "\nNo ack for block at 0x%x, (%m)\n", blocks[done].offset);
+			goto save;
+		}
+		if (get_be32(ack + 1) != crc32_le(~0, image + blocks[done].offset, blocks[done].length))
+		{
+			fprintf(stderr, "\nBlock at 0x%x verify failed\n", blocks[done].offset);
+			goto save;
+		}
+		bytes += blocks[done].length;
+
+		if (sent < count && diablo_send_block(image, &blocks[sent++]) < 0)
+		{
+			done++;
+			goto save;
+		}
+
+		if ((done + 1) % DIABLO_WINDOW == 0 || done + 1 == count)
+		{
+			resume_save(resume, crc, done + 1);
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			ms = elapsed_ms(&start, &now);
+			fprintf(stderr, "\rBlock %d/%d, %d%%, %.1f KiB/s", done + 1, count, (done + 1) * 100 / count, ms > 0 ? (bytes / 1024.0) / (ms / 1000.0) : 0);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = elapsed_ms(&start, &now);
+	fprintf(stderr, "\nUpdated %d blocks, %d bytes in %.3f ms, %.1f KiB/s\n", count - first, bytes, ms, ms > 0 ? (bytes / 1024.0) / (ms / 1000.0) : 0);
+	unlink(resume);
+	result = 0;
+	goto out;
+
+save:
+	/* everything before done was verified, start there next time */
+	resume_save(resume, crc, done);
+	fprintf(stderr, "Interrupted after %d of %d blocks, run again to resume\n", done, count);
+out:
+	free(blocks);
+	free(image);
+	return result;
+}
+
+static const char *jtag_states[] =
+{
+	"RESET", "IDLE", "DRSELECT", "DRCAPTURE", "DRSHIFT", "DREXIT1", "DRPAUSE", "DREXIT2", "DRUPDATE",
+	"IRSELECT", "IRCAPTURE", "IRSHIFT", "IREXIT1", "IRPAUSE", "IREXIT2", "IRUPDATE", NULL
+};
+
+/* scan operations collected for one IOCTL_JTAG_SCAN_COMMAND */
+struct jtag_batch
+{
+	struct cas_jtag_scan scans[JTAG_BATCH_SCANS];
+	int lines[JTAG_BATCH_SCANS];	/* source line of every scan, for errors */
+	int count;
+	unsigned char *vectors;
+	int vectors_length, vectors_size;
+	unsigned char *tdo;
+	int tdo_length, tdo_size;
+	int line;			/* line or offset of the statement being played */
+	const char *unit;		/* "line" or "offset" */
+	long long bits, total, ioctls;	/* statistics */
+};
+
+static int jtag_vector(struct jtag_batch *b, const unsigned char *data, int bytes)
+{
+	int offset = b->vectors_length;
+
+	if (b->vectors_length + bytes > b->vectors_size)
+	{
+		b->vectors_size = (b->vectors_length + bytes) * 2;
+		b->vectors = realloc(b->vectors, b->vectors_size);
+		if (b->vectors == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	memcpy(b->vectors + offset, data, bytes);
+	b->vectors_length += bytes;
+	return offset;
+}
+
+static void print_vector(const char *name, const unsigned char *v, int bits)
+{
+	int i;
+
+	/* msb first, as svf writes it */
+	fprintf(stderr, "  %s ", name);
+	for (i = (bits + 7) / 8 - 1; i >= 0; i--)
+		fprintf(stderr, "%02x", v[i]);
+	fprintf(stderr, "\n");
+}
+
+/* run the collected scans, returns 1 when a tdo did not match */
+static int jtag_flush(struct jtag_batch *b, int report)
+{
+	struct cas_jtag_command cas_jtag_cmd;
+	struct cas_jtag_scan *scan;
+	int i, offset;
+
+	if (b->count == 0)
+		return 0;
+
+	if (b->tdo_length > b->tdo_size)
+	{
+		b->tdo_size = b->tdo_length;
+		b->tdo = realloc(b->tdo, b->tdo_size);
+		if (b->tdo == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+
+	cas_jtag_cmd.scans = (unsigned long)b->scans;
+	cas_jtag_cmd.vectors = (unsigned long)b->vectors;
+	cas_jtag_cmd.tdo = (unsigned long)b->tdo;
+	cas_jtag_cmd.count = b->count;
+	cas_jtag_cmd.vectors_length = b->vectors_length;
+	cas_jtag_cmd.tdo_length = b->tdo_length;
+
+	b->count = 0;
+	b->vectors_length = 0;
+	b->tdo_length = 0;
+	b->ioctls++;
+
+	if (ioctl(fd, IOCTL_JTAG_SCAN_COMMAND, &cas_jtag_cmd) < 0)
+	{
+		if (errno == EOPNOTSUPP)
+			fprintf(stderr, "The jtag ioctl is experimental, load the cas module with jtag_experimental=1 to use it\n");
+		else
+			fprintf(stderr, "Failed send ioctl command: IOCTL_JTAG_SCAN_COMMAND, (%m)\n");
+		return -1;
+	}
+	if (cas_jtag_cmd.failed == cas_jtag_cmd.count)
+		return 0;
+
+	if (report)
+	{
+		for (i = 0, offset = 0; i < cas_jtag_cmd.failed; i++)
+			if (b->scans[i].flags & JTAG_SCAN_CAPTURE)
+				offset += (b->scans[i].bits + 7) / 8;
+		scan = &b->scans[cas_jtag_cmd.failed];
+		fprintf(stderr, "TDO mismatch at %s %d\n", b->unit, b->lines[cas_jtag_cmd.failed]);
+		print_vector("expected", b->vectors + scan->tdo, scan->bits);
+		print_vector("mask    ", b->vectors + scan->mask, scan->bits);
+		print_vector("got     ", b->tdo + offset, scan->bits);
+	}
+	return 1;
+}
+
+static int jtag_add(struct jtag_batch *b, int type, int end_state, int bits, const unsigned char *tdi, const unsigned char *tdo, const unsigned char *mask)
+{
+	struct cas_jtag_scan *scan;
+	int i, bytes = (bits + 7) / 8, compare = 0;
+
+	if (type != JTAG_SCAN_RUN && type != JTAG_SCAN_STATE && bytes > JTAG_MAX_SCAN_BYTES)
+	{
+		fprintf(stderr, "Scan of %d bits at %s %d too long\n", bits, b->unit, b->line);
+		return -1;
+	}
+
+	/* a zero mask compares nothing, don't even capture */
+	for (i = 0; tdo != NULL && i < bytes && !compare; i++)
+		compare = mask[i] != 0;
+
+	if (b->count == JTAG_BATCH_SCANS || b->vectors_length + 3 * bytes > JTAG_BATCH_VECTORS)
+		if (jtag_flush(b, 1) != 0)
+			return -1;
+
+	scan = &b->scans[b->count];
+	memset(scan, 0, sizeof(*scan));
+	scan->type = type;
+	scan->end_state = end_state;
+	scan->bits = bits;
+	if (tdi != NULL)
+		scan->tdi = jtag_vector(b, tdi, bytes);
+	if (compare)
+	{
+		scan->flags = JTAG_SCAN_CAPTURE | JTAG_SCAN_COMPARE;
+		scan->tdo = jtag_vector(b, tdo, bytes);
+		scan->mask = jtag_vector(b, mask, bytes);
+		b->tdo_length += bytes;
+	}
+	b->lines[b->count++] = b->line;
+
+	if (type == JTAG_SCAN_IR || type == JTAG_SCAN_DR)
+		b->bits += bits;
+	b->total++;
+	return 0;
+}
+
+static int jtag_state(struct jtag_batch *b, int state)
+{
+	return jtag_add(b, JTAG_SCAN_STATE, state, 0, NULL, NULL, NULL);
+}
+
+/* clock in the current state for at least clocks and usecs, then walk to end_state */
+static int jtag_wait(struct jtag_batch *b, unsigned int clocks, double usecs, int end_state)
+{
+	double needed = usecs * (JTAG_MAX_FREQUENCY / 1000000.0);
+
+	/* long waits sleep on the host, short ones are tck clocks inside the batch */
+	if (usecs >= JTAG_HOST_WAIT_US)
+	{
+		if (jtag_flush(b, 1) != 0)
+			return -1;
+		usleep(usecs);
+	}
+	else if (needed > clocks)
+		clocks = needed + 1;
+
+	if (clocks == 0)
+		return jtag_state(b, end_state);
+	return jtag_add(b, JTAG_SCAN_RUN, end_state, clocks, NULL, NULL, NULL);
+}
+
+static void copy_bits(unsigned char *dst, int dst_bit, const unsigned char *src, int bits)
+{
+	int i;
+
+	for (i = 0; i < bits; i++, dst_bit++)
+	{
+		if (src[i / 8] & (1 << (i % 8)))
+			dst[dst_bit / 8] |= 1 << (dst_bit % 8);
+		else
+			dst[dst_bit / 8] &= ~(1 << (dst_bit % 8));
+	}
+}
+
+/* an svf register with the values that carry over between statements */
+struct svf_register
+{
+	int length;
+	unsigned char *tdi, *tdo, *mask;
+	int tdo_valid;
+};
+
+/* svf hex is msb first, vectors are lsb first */
+static int svf_hex(const char *text, int bits, unsigned char *vector)
+{
+	int i, n, digit;
+
+	memset(vector, 0, (bits + 7) / 8);
+	for (i = strlen(text) - 1, n = 0; i >= 0; i--, n++)
+	{
+		if (text[i] >= '0' && text[i] <= '9')
+			digit = text[i] - '0';
+		else if (text[i] >= 'a' && text[i] <= 'f')
+			digit = text[i] - 'a' + 10;
+		else if (text[i] >= 'A' && text[i] <= 'F')
+			digit = text[i] - 'A' + 10;
+		else
+			return -1;
+		if (n * 4 < bits)
+			vector[n / 2] |= digit << (4 * (n % 2));
+	}
+	return 0;
+}
+
+static int svf_register(struct svf_register *r, char **tokens, int count, int line)
+{
+	int i, length, bytes;
+	unsigned char **target;
+
+	if (count < 2 || sscanf(tokens[1], "%d", &length) != 1 || length < 0)
+	{
+		fprintf(stderr, "Bad length at line %d\n", line);
+		return -1;
+	}
+	bytes = (length + 7) / 8;
+
+	/* tdi and mask carry over only while the length stays the same */
+	if (length != r->length || r->tdi == NULL)
+	{
+		r->length = length;
+		r->tdi = realloc(r->tdi, bytes + 1);
+		r->tdo = realloc(r->tdo, bytes + 1);
+		r->mask = realloc(r->mask, bytes + 1);
+		memset(r->tdi, 0, bytes + 1);
+		memset(r->tdo, 0, bytes + 1);
+		memset(r->mask, 0xff, bytes + 1);
+	}
+	r->tdo_valid = 0;
+
+	for (i = 2; i + 1 < count; i += 2)
+	{
+		if (strcmp(tokens[i], "TDI") == 0)
+			target = &r->tdi;
+		else if (strcmp(tokens[i], "TDO") == 0)
+		{
+			target = &r->tdo;
+			r->tdo_valid = 1;
+		}
+		else if (strcmp(tokens[i], "MASK") == 0)
+			target = &r->mask;
+		else if (strcmp(tokens[i], "SMASK") == 0)
+			continue;
+		else
+			target = NULL;
+		if (target == NULL || tokens[i + 1][0] != '(' || svf_hex(tokens[i + 1] + 1, length, *target) < 0)
+		{
+			fprintf(stderr, "Bad %s at line %d\n", tokens[i], line);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* shift header, data and trailer as one scan, the header goes out first */
+static int svf_shift(struct jtag_batch *b, int type, struct svf_register *header, struct svf_register *r, struct svf_register *trailer, int end_state)
+{
+	struct svf_register *parts[3] = { header, r, trailer };
+	unsigned char *tdi, *tdo, *mask;
+	int i, bit, bits = header->length + r->length + trailer->length, result;
+
+	tdi = calloc(1, (bits + 7) / 8 + 1);
+	tdo = calloc(1, (bits + 7) / 8 + 1);
+	mask = calloc(1, (bits + 7) / 8 + 1);
+	if (tdi == NULL || tdo == NULL || mask == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	for (i = 0, bit = 0; i < 3; bit += parts[i]->length, i++)
+	{
+		if (parts[i]->length == 0)
+			continue;
+		copy_bits(tdi, bit, parts[i]->tdi, parts[i]->length);
+		if (parts[i]->tdo_valid)
+		{
+			copy_bits(tdo, bit, parts[i]->tdo, parts[i]->length);
+			copy_bits(mask, bit, parts[i]->mask, parts[i]->length);
+		}
+	}
+
+	result = jtag_add(b, type, end_state, bits, tdi, tdo, mask);
+	free(tdi);
+	free(tdo);
+	free(mask);
+	return result;
+}
+
+static int svf_state(const char *name)
+{
+	int i;
+
+	for (i = 0; jtag_states[i] != NULL; i++)
+		if (strcmp(name, jtag_states[i]) == 0)
+			return i;
+	return -1;
+}
+
+/* RUNTEST [run_state] [run_count TCK|SCK] [min_time SEC [MAXIMUM max_time SEC]] [ENDSTATE end_state] */
+static int svf_runtest(struct jtag_batch *b, char **tokens, int count, int *run_state, int *end_state)
+{
+	unsigned int clocks = 0;
+	double value, usecs = 0;
+	int i = 1, state;
+
+	if (i < count && (state = svf_state(tokens[i])) >= 0)
+	{
+		*run_state = *end_state = state;
+		i++;
+	}
+	for (; i < count; i++)
+	{
+		if (strcmp(tokens[i], "ENDSTATE") == 0 && i + 1 < count && (state = svf_state(tokens[i + 1])) >= 0)
+		{
+			*end_state = state;
+			i++;
+		}
+		else if (strcmp(tokens[i], "MAXIMUM") == 0)
+			i += 2;
+		else if (i + 1 < count && sscanf(tokens[i], "%lf", &value) == 1)
+		{
+			if (strcmp(tokens[i + 1], "SEC") == 0)
+				usecs = value * 1000000.0;
+			else
+				clocks = value;
+			i++;
+		}
+		else
+		{
+			fprintf(stderr, "Bad RUNTEST at line %d\n", b->line);
+			return -1;
+		}
+	}
+
+	if (jtag_state(b, *run_state) < 0)
+		return -1;
+	return jtag_wait(b, clocks, usecs, *end_state);
+}
+
+/* split a statement into words in out, a parenthesised value is one word starting with '(' */
+static int svf_tokens(const char *p, char *out, char **tokens, int max)
+{
+	int count = 0;
+
+	while (*p && count < max)
+	{
+		if (isspace(*p))
+		{
+			p++;
+			continue;
+		}
+		tokens[count++] = out;
+		if (*p == '(')
+		{
+			/* a value may span lines, squeeze out the white space */
+			for (*out++ = *p++; *p && *p != ')'; p++)
+				if (!isspace(*p))
+					*out++ = *p;
+			if (*p == ')')
+				p++;
+		}
+		else
+		{
+			while (*p && *p != '(' && !isspace(*p))
+				*out++ = *p++;
+		}
+		*out++ = '\0';
+	}
+	return count;
+}
+
+static int svf_play(struct jtag_batch *b, char *text)
+{
+	struct svf_register hir = { 0 }, hdr = { 0 }, tir = { 0 }, tdr = { 0 }, sir = { 0 }, sdr = { 0 };
+	int endir = JTAG_STATE_IDLE, enddr = JTAG_STATE_IDLE, run_state = JTAG_STATE_IDLE, run_end = JTAG_STATE_IDLE;
+	char *statement, *p, *p2, *words, *tokens[64];
+	int i, count, state, line = 1, result = 0;
+
+	for (p = text; *p && result == 0; )
+	{
+		/* collect one statement, dropping comments */
+		statement = p;
+		b->line = line;
+		for (; *p && *p != ';'; p++)
+		{
+			if (*p == '!' || (*p == '/' && p[1] == '/'))
+				while (*p && *p != '\n')
+					*p++ = ' ';
+			if (*p == '\n')
+				line++;
+			if (*p == '\0')
+				break;
+		}
+		if (*p == ';')
+			*p++ = '\0';
+
+		words = malloc(2 * strlen(statement) + 1);
+		if (words == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		count = svf_tokens(statement, words, tokens, 64);
+		/* svf is case insensitive, hex values included */
+		for (i = 0; i < count; i++)
+			for (p2 = tokens[i]; *p2; p2++)
+				*p2 = toupper(*p2);
+
+		if (count == 0)
+			;	/* an empty statement */
+		else if (strcmp(tokens[0], "SIR") == 0)
+			result = svf_register(&sir, tokens, count, line) < 0 || svf_shift(b, JTAG_SCAN_IR, &hir, &sir, &tir, endir) < 0 ? -1 : 0;
+		else if (strcmp(tokens[0], "SDR") == 0)
+			result = svf_register(&sdr, tokens, count, line) < 0 || svf_shift(b, JTAG_SCAN_DR, &hdr, &sdr, &tdr, enddr) < 0 ? -1 : 0;
+		else if (strcmp(tokens[0], "HIR") == 0)
+			result = svf_register(&hir, tokens, count, line);
+		else if (strcmp(tokens[0], "HDR") == 0)
+			result = svf_register(&hdr, tokens, count, line);
+		else if (strcmp(tokens[0], "TIR") == 0)
+			result = svf_register(&tir, tokens, count, line);
+		else if (strcmp(tokens[0], "TDR") == 0)
+			result = svf_register(&tdr, tokens, count, line);
+		else if (strcmp(tokens[0], "RUNTEST") == 0)
+			result = svf_runtest(b, tokens, count, &run_state, &run_end);
+		else if (strcmp(tokens[0], "STATE") == 0)
+		{
+			for (i = 1; i < count && result == 0; i++)
+			{
+				state = svf_state(tokens[i]);
+				result = state < 0 ? -1 : jtag_state(b, state);
+			}
+		}
+		else if (strcmp(tokens[0], "ENDIR") == 0 && count == 2 && svf_state(tokens[1]) >= 0)
+			endir = svf_state(tokens[1]);
+		else if (strcmp(tokens[0], "ENDDR") == 0 && count == 2 && svf_state(tokens[1]) >= 0)
+			enddr = svf_state(tokens[1]);
+		else if (strcmp(tokens[0], "FREQUENCY") == 0 || strcmp(tokens[0], "TRST") == 0)
+			;	/* the firmware runs tck at its own rate and has no trst */
+		else
+		{
+			fprintf(stderr, "Unsupported statement %s at line %d\n", tokens[0], b->line);
+			result = -1;
+		}
+		free(words);
+	}
+	return result;
+}
+
+/* xsvf vectors are msb first */
+static const unsigned char *xsvf_vector(const unsigned char **p, const unsigned char *end, int bits, unsigned char *vector)
+{
+	int i, bytes = (bits + 7) / 8;
+
+	if (*p + bytes > end)
+		return NULL;
+	for (i = 0; i < bytes; i++)
+		vector[i] = (*p)[bytes - 1 - i];
+	*p += bytes;
+	return vector;
+}
+
+static unsigned int xsvf_u32(const unsigned char **p)
+{
+	unsigned int v = get_be32(*p);
+
+	*p += 4;
+	return v;
+}
+
+/* shift dr and, with xrepeat set, retry a mismatch like the xilinx player does */
+static int xsvf_sdr(struct jtag_batch *b, const unsigned char *tdi, const unsigned char *tdo, const unsigned char *mask, int bits,
+		int end_state, unsigned int runtest, int repeat)
+{
+	int attempt, result;
+
+	if (repeat == 0 || tdo == NULL)
+	{
+		if (jtag_add(b, JTAG_SCAN_DR, runtest ? JTAG_STATE_IDLE : end_state, bits, tdi, tdo, mask) < 0)
+			return -1;
+		return runtest ? jtag_wait(b, 0, runtest, JTAG_STATE_IDLE) : 0;
+	}
+
+	/* a retried scan runs on its own, the ones after it depend on the outcome */
+	if (jtag_flush(b, 1) != 0)
+		return -1;
+	for (attempt = 0; attempt <= repeat; attempt++)
+	{
+		if (jtag_add(b, JTAG_SCAN_DR, runtest ? JTAG_STATE_IDLE : end_state, bits, tdi, tdo, mask) < 0)
+			return -1;
+		if (runtest && jtag_wait(b, 0, runtest, JTAG_STATE_IDLE) < 0)
+			return -1;
+		result = jtag_flush(b, attempt == repeat);
+		if (result <= 0)
+			return result;
+		/* give the device longer, as xapp503 suggests */
+		runtest += runtest / 4;
+	}
+	return -1;
+}
+
+static int xsvf_play(struct jtag_batch *b, const unsigned char *data, int size)
+{
+	const unsigned char *p = data, *end = data + size;
+	unsigned char *tdi, *tdo, *mask;
+	unsigned int runtest = 0, sdrsize = 0, bits, usecs;
+	int command, state, wait_state, endir = JTAG_STATE_IDLE, enddr = JTAG_STATE_IDLE, repeat = 0, result = 0;
+
+	tdi = calloc(1, JTAG_MAX_SCAN_BYTES);
+	tdo = calloc(1, JTAG_MAX_SCAN_BYTES);
+	mask = calloc(1, JTAG_MAX_SCAN_BYTES);
+	if (tdi == NULL || tdo == NULL || mask == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	while (p < end && result == 0)
+	{
+		b->line = p - data;
+		command = *p++;
+		switch (command)
+		{
+			case XCOMPLETE:
+				p = end;
+				break;
+			case XTDOMASK:
+				if (xsvf_vector(&p, end, sdrsize, mask) == NULL)
+					result = -1;
+				break;
+			case XSIR:
+			case XSIR2:
+				if (p + (command == XSIR ? 1 : 2) > end)
+				{
+					result = -1;
+					break;
+				}
+				bits = command == XSIR ? p[0] : (p[0] << 8) | p[1];
+				p += command == XSIR ? 1 : 2;
+				if (bits > JTAG_MAX_SCAN_BYTES * 8 || xsvf_vector(&p, end, bits, tdi) == NULL ||
+				    jtag_add(b, JTAG_SCAN_IR, runtest ? JTAG_STATE_IDLE : endir, bits, tdi, NULL, NULL) < 0 ||
+				    (runtest && jtag_wait(b, 0, runtest, JTAG_STATE_IDLE) < 0))
+					result = -1;
+				break;
+			case XSDR:
+			case XSDRTDO:
+				if (xsvf_vector(&p, end, sdrsize, tdi) == NULL || (command == XSDRTDO && xsvf_vector(&p, end, sdrsize, tdo) == NULL) ||
+				    xsvf_sdr(b, tdi, tdo, mask, sdrsize, enddr, runtest, repeat) != 0)
+					result = -1;
+				break;
+			case XSDRB:
+			case XSDRC:
+			case XSDRE:
+			case XSDRTDOB:
+			case XSDRTDOC:
+			case XSDRTDOE:
+				state = (command == XSDRE || command == XSDRTDOE) ? enddr : JTAG_STATE_DRSHIFT;
+				if (xsvf_vector(&p, end, sdrsize, tdi) == NULL || (command >= XSDRTDOB && xsvf_vector(&p, end, sdrsize, tdo) == NULL) ||
+				    jtag_add(b, JTAG_SCAN_DR, state, sdrsize, tdi, command >= XSDRTDOB ? tdo : NULL, mask) < 0)
+					result = -1;
+				break;
+			case XRUNTEST:
+				if (p + 4 > end)
+					result = -1;
+				else
+					runtest = xsvf_u32(&p);
+				break;
+			case XREPEAT:
+				if (p + 1 > end)
+					result = -1;
+				else
+					repeat = *p++;
+				break;
+			case XSDRSIZE:
+				if (p + 4 > end || (sdrsize = xsvf_u32(&p)) > JTAG_MAX_SCAN_BYTES * 8)
+					result = -1;
+				break;
+			case XSTATE:
+				if (p + 1 > end || *p > JTAG_STATE_IRUPDATE)
+					result = -1;
+				else
+					result = jtag_state(b, *p++);
+				break;
+			case XENDIR:
+				if (p + 1 > end)
+					result = -1;
+				else
+					endir = *p++ ? JTAG_STATE_IRPAUSE : JTAG_STATE_IDLE;
+				break;
+			case XENDDR:
+				if (p + 1 > end)
+					result = -1;
+				else
+					enddr = *p++ ? JTAG_STATE_DRPAUSE : JTAG_STATE_IDLE;
+				break;
+			case XCOMMENT:
+				while (p < end && *p != '\0')
+					p++;
+				p++;
+				break;
+			case XWAIT:
+				if (p + 6 > end || p[0] > JTAG_STATE_IRUPDATE || p[1] > JTAG_STATE_IRUPDATE)
+				{
+					result = -1;
+					break;
+				}
+				wait_state = p[0];
+				state = p[1];
+				p += 2;
+				usecs = xsvf_u32(&p);
+				if (jtag_state(b, wait_state) < 0 || jtag_wait(b, 0, usecs, state) < 0)
+					result = -1;
+				break;
+			default:
+				fprintf(stderr, "Unsupported xsvf command 0x%02x at offset %d\n", command, b->line);
+				result = -1;
+				break;
+		}
+	}
+	if (result < 0)
+		fprintf(stderr, "Xsvf playback stopped at offset %d\n", b->line);
+
+	free(tdi);
+	free(tdo);
+	free(mask);
+	return result;
+}
+
+/* play an svf or, by extension, an xsvf file through the jtag firmware */
+static int jtag_play(char *file)
+{
+	struct jtag_batch *b;
+	struct timespec start, end;
+	unsigned char *data;
+	char *ext = strrchr(file, '.');
+	int size, result;
+	double ms;
+
+	data = load_file(file, &size);
+	if (data == NULL)
+		return -1;
+	b = calloc(1, sizeof(*b));
+	if (b == NULL)
+	{
+		free(data);
+		return -1;
+	}
+
+	open_device();
+	if (ioctl(fd, IOCTL_SET_JTAG) < 0)
+	{
+		fprintf(stderr, "Failed send ioctl command: IOCTL_SET_JTAG, (%m)\n");
+		free(data);
+		free(b);
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (ext != NULL && (strcasecmp(ext, ".xsvf") == 0 || strcasecmp(ext, ".xsv") == 0))
+	{
+		b->unit = "offset";
+		result = xsvf_play(b, data, size);
+	}
+	else
+	{
+		b->unit = "line";
+		data = realloc(data, size + 1);
+		data[size] = '\0';
+		result = svf_play(b, (char *)data);
+	}
+	if (result == 0)
+		result = jtag_flush(b, 1) == 0 ? 0 : -1;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	ms = elapsed_ms(&start, &end);
+	if (result == 0)
+		fprintf(stderr, "Played %s: %lld scans, %lld bits shifted in %.3f ms, %.1f kbit/s, %lld ioctls\n",
+			file, b->total, b->bits, ms, ms > 0 ? b->bits / ms : 0, b->ioctls);
+
+	free(b->vectors);
+	free(b->tdo);
+	free(b);
+	free(data);
+	return result;
+}
+
 int main(int argc, char *argv[])
 {
 	int i;
@@ -128,7 +1306,7 @@ int main(int argc, char *argv[])
 					exit(1);
 				}
 			}
-			else if ((strcmp(argv[i], "-m") == 0) || (strcmp(argv[i], "--setMm") == 0))
+			else if ((strcmp(argv[i], "-j") == 0) || (strcmp(argv[i], "--setJtag") == 0))
 			{
 				fd = open(CAS_DEVICE, O_RDWR);
 				if (fd < 0)
@@ -248,6 +1426,83 @@ int main(int argc, char *argv[])
 					exit(1);
 				}
 			}
+			else if ((strcmp(argv[i], "-r") == 0) || (strcmp(argv[i], "--readEeprom") == 0))
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "Missing file name\n");
+					usage(argv[0], NULL);
+				}
+				open_device();
+				if (read_eeprom_file(argv[i + 1]) < 0)
+					exit(1);
+				i += 1;
+			}
+			else if ((strcmp(argv[i], "-w") == 0) || (strcmp(argv[i], "--writeEeprom") == 0))
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "Missing file name\n");
+					usage(argv[0], NULL);
+				}
+				open_device();
+				if (write_eeprom_file(argv[i + 1]) < 0)
+					exit(1);
+				i += 1;
+			}
+			else if ((strcmp(argv[i], "-b") == 0) || (strcmp(argv[i], "--benchEeprom") == 0))
+			{
+				int runs = 10;
+
+				if (i + 1 < argc)
+				{
+					runs = atoi(argv[i + 1]);
+					i += 1;
+				}
+				if (runs <= 0)
+				{
+					fprintf(stderr, "Runs value out of range\n");
+					usage(argv[0], NULL);
+				}
+				open_device();
+				if (bench_eeprom(runs) < 0)
+					exit(1);
+			}
+			else if ((strcmp(argv[i], "-J") == 0) || (strcmp(argv[i], "--jtag-play") == 0))
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "Missing file name\n");
+					usage(argv[0], NULL);
+				}
+				if (jtag_play(argv[i + 1]) < 0)
+					exit(1);
+				i += 1;
+			}
+			else if ((strcmp(argv[i], "-S") == 0) || (strcmp(argv[i], "--simulate") == 0))
+			{
+				if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9')
+				{
+					simulated_transport.fail_after = atoi(argv[i + 1]);
+					i += 1;
+				}
+				transport = &simulated_transport;
+			}
+			else if ((strcmp(argv[i], "-X") == 0) || (strcmp(argv[i], "--experimental") == 0))
+			{
+				experimental = 1;
+			}
+			else if ((strcmp(argv[i], "-u") == 0) || (strcmp(argv[i], "--diablo-update") == 0))
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "Missing file name\n");
+					usage(argv[0], NULL);
+				}
+				if (diablo_update(argv[i + 1]) < 0)
+					exit(1);
+				i += 1;
+			}
 			else
 			{
 				usage(argv[0], NULL);
@@ -34,4 +34,55 @@ char* unconstchar(const char* s) {
 
 #define CAS_DEVICE "/dev/cas_programmer"
 
+#define JTAG_BATCH_SCANS 4096
+#define JTAG_BATCH_VECTORS (1024 * 1024)
+#define JTAG_MAX_FREQUENCY 12000000	/* fastest tck of the jtag firmware, waits are converted with it */
+#define JTAG_HOST_WAIT_US 100000	/* longer waits sleep on the host */
+
+/* xsvf commands */
+#define XCOMPLETE 0x00
+#define XTDOMASK 0x01
+#define XSIR 0x02
+#define XSDR 0x03
+#define XRUNTEST 0x04
+#define XREPEAT 0x07
+#define XSDRSIZE 0x08
+#define XSDRTDO 0x09
+#define XSDRB 0x0c
+#define XSDRC 0x0d
+#define XSDRE 0x0e
+#define XSDRTDOB 0x0f
+#define XSDRTDOC 0x10
+#define XSDRTDOE 0x11
+#define XSTATE 0x12
+#define XENDIR 0x13
+#define XENDDR 0x14
+#define XSIR2 0x15
+#define XCOMMENT 0x16
+#define XWAIT 0x17
+
+/*
+ * Diablo update images start with a 6 byte magic, "DIABLO" or "D2ABLO",
+ * followed at DIABLO_TABLE_OFFSET by big endian 32 bit offset/length pairs
+ * of the segments, ended by a zero pair. The first segment starts right
+ * after the header.
+ */
+#define DIABLO_MAGIC_SIZE 6
+#define DIABLO_TABLE_OFFSET 0x0e
+
+/*
+ * A block goes to the diablo firmware as DIABLO_BLOCK_WRITE, the segment
+ * index, the 32 bit position in the segment and the 16 bit length, big
+ * endian, followed by the data. The firmware answers every block with the
+ * ack byte and the big endian crc32 of the data it received.
+ * This protocol is not confirmed against the diablo firmware, only the
+ * simulated cam speaks it for sure.
+ */
+#define DIABLO_BLOCK_WRITE 0x57
+#define DIABLO_BLOCK_ACK 0x06
+#define DIABLO_BLOCK_HEADER 8
+#define DIABLO_BLOCK_SIZE 4096
+#define DIABLO_ACK_SIZE 5
+#define DIABLO_WINDOW 8
+
 #endif
@@ -30,6 +30,22 @@
 #include <linux/delay.h>
 #include <linux/init.h>
 #include <linux/usb.h>
+#include <linux/firmware.h>
+#include <linux/ihex.h>
+#include <linux/crc32.h>
+#include <linux/uio.h>
+#include <linux/scatterlist.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/kfifo.h>
+#include <linux/poll.h>
+#include <linux/anon_inodes.h>
+#include <linux/kobject.h>
+#include <linux/sched/signal.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,7,0)
+#include <linux/io_uring/cmd.h>
+#endif
 
 #include <linux/string.h>
 
@@ -45,6 +61,19 @@
 static int debug = DEBUG_NONE;
 static int load_fx1_fw = 0;
 static int load_fx2_fw = 0;
+static int batch_records = 1;	/* records pipelined while loading a mode, 1 sends them one by one */
+static int priority_aging = 50;
+static int timeout_floor = 1000;	/* modes that wait on a card */
+static int command_timeout_floor = 100;	/* modes that only talk to the firmware */
+static int timeout_ceiling = 3000;
+static char *restore[RESTORE_ENTRIES];
+static int restore_count;
+
+static struct dynamite_restore restore_table[RESTORE_ENTRIES];
+static DEFINE_MUTEX(restore_lock);
+
+static struct dynamite_boot boot_table[BOOT_ENTRIES];
+static DEFINE_MUTEX(boot_lock);
 
 #define to_dynamite_dev(d) container_of(d, struct usb_dynamite, kref)
 
@@ -53,7 +82,10 @@ static const struct file_operations dynamite_fops;
 
 /* local function prototypes */
 static int dynamite_probe(struct usb_interface *interface, const struct usb_device_id *id);
+static int dynamite_set_mode(struct usb_dynamite *dynamite, int mode);
+static int dynamite_set_mode_queued(struct usb_dynamite *dynamite, int mode);
 static void dynamite_disconnect(struct usb_interface *interface);
+static int dynamite_event_fd(struct usb_dynamite *dynamite);
 
 static void wait_for_finish(struct usb_dynamite *dynamite, unsigned long usecs)
 {
@@ -93,9 +125,107 @@ static void dump_buffer(struct usb_dynamite *dynamite, unsigned char *buffer, ch
 	}
 }
 
+/* queue an event for the event fd, safe from interrupt context */
+static void event_post(struct usb_dynamite *dynamite, int type, int status, const unsigned char *data, int len)
+{
+	struct dynamite_event event = {
+		.time_ns = ktime_get_ns(),
+		.type = type,
+		.status = status,
+		.length = min(len, EVENT_DATA_SIZE),
+	};
+	unsigned long flags;
+
+	if (data)
+		memcpy(event.data, data, event.length);
+
+	spin_lock_irqsave(&dynamite->event_lock, flags);
+	if (kfifo_is_full(&dynamite->events)) {
+		/* keep the newest events, the next read reports how many were lost */
+		kfifo_skip(&dynamite->events);
+		dynamite->events_lost++;
+	}
+	kfifo_put(&dynamite->events, event);
+	spin_unlock_irqrestore(&dynamite->event_lock, flags);
+
+	wake_up_interruptible(&dynamite->event_wait);
+}
+
+/*
+ * Transfer timeouts follow the response times seen per mode and endpoint,
+ * estimated the way tcp does with srtt and rttvar: srtt plus four
+ * deviations, clamped to a floor..timeout_ceiling ms. Until enough
+ * samples are in, the old fixed timeouts apply.
+ * In a reader mode one estimate per endpoint mixes quick command acks with
+ * card replies, an atr or card i/o at 9600 baud takes hundreds of ms. The
+ * floor of those modes defaults to the old fixed bulk timeout, so a card
+ * reply is never cut shorter than before. Modes without a card in the loop
+ * only see command acks and use command_timeout_floor, which lets their
+ * timeouts follow the device down to a fraction of that.
+ */
+static int rtt_mode(struct usb_dynamite *dynamite)
+{
+	return dynamite->status < DEVICE_MODES ? dynamite->status : NOFW;
+}
+
+static struct dynamite_rtt *rtt_of(struct usb_dynamite *dynamite, int endpoint)
+{
+	return &dynamite->rtt[rtt_mode(dynamite)][endpoint];
+}
+
+/* the boot stages and modes that never wait on a card */
+static int command_mode(int mode)
+{
+	return mode <= START;
+}
+
+static int __rtt_timeout(struct dynamite_rtt *rtt, int mode, int endpoint)
+{
+	int floor = max(command_mode(mode) ? command_timeout_floor : timeout_floor, 1);
+	int ceiling = max(timeout_ceiling, floor);
+	int timeout;
+
+	if (rtt->samples < RTT_MIN_SAMPLES)
+		timeout = endpoint == RTT_CONTROL ? 3000 : 1000;
+	else
+		timeout = DIV_ROUND_UP(rtt->srtt + 4 * rtt->rttvar, USEC_PER_MSEC);
+
+	return clamp(timeout, floor, ceiling);
+}
+
+static int rtt_timeout(struct usb_dynamite *dynamite, int endpoint)
+{
+	return __rtt_timeout(rtt_of(dynamite, endpoint), rtt_mode(dynamite), endpoint);
+}
+
+static void rtt_sample(struct usb_dynamite *dynamite, int endpoint, ktime_t start, int result, int timeout)
+{
+	struct dynamite_rtt *rtt = rtt_of(dynamite, endpoint);
+	s32 sample, delta;
+
+	/* a timeout only tells the answer takes longer, it backs the estimate off */
+	if (result == -ETIMEDOUT)
+		sample = timeout * USEC_PER_MSEC;
+	else if (result < 0)
+		return;
+	else
+		sample = ktime_us_delta(ktime_get(), start);
+
+	if (!rtt->samples++) {
+		rtt->srtt = sample;
+		rtt->rttvar = sample / 2;
+		return;
+	}
+
+	delta = sample - (s32)rtt->srtt;
+	rtt->srtt += delta / 8;
+	rtt->rttvar += (abs(delta) - (s32)rtt->rttvar) / 4;
+}
+
 static int vendor_command_snd(struct usb_dynamite *dynamite, unsigned char request, int address, int index, const char *buf, int size)
 {
-	int result;
+	int result, timeout;
+	ktime_t start;
 	unsigned char *buffer = kmemdup(buf, size, GFP_KERNEL);
 
 	if (!buffer) {
@@ -108,7 +238,10 @@ static int vendor_command_snd(struct usb_dynamite *dynamite, unsigned char reque
 	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_IN && debug != SIMPLE_DEBUG_IN) && buffer != NULL)
 		dump_buffer(dynamite, buffer, "data_out", size);
 
-	result = usb_control_msg(dynamite->udevice, usb_sndctrlpipe(dynamite->udevice, 0), request, USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buffer, size, 3000);
+	timeout = rtt_timeout(dynamite, RTT_CONTROL);
+	start = ktime_get();
+	result = usb_control_msg(dynamite->udevice, usb_sndctrlpipe(dynamite->udevice, 0), request, USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buffer, size, timeout);
+	rtt_sample(dynamite, RTT_CONTROL, start, result, timeout);
 
 	mutex_unlock(&dynamite->lock);
 
@@ -119,11 +252,15 @@ static int vendor_command_snd(struct usb_dynamite *dynamite, unsigned char reque
 
 static int vendor_command_rcv(struct usb_dynamite *dynamite, unsigned char request, int address, int index, char *buf, int size)
 {
-	int result;
+	int result, timeout;
+	ktime_t start;
 
 	mutex_lock(&dynamite->lock);
 
-	result = usb_control_msg(dynamite->udevice, usb_rcvctrlpipe(dynamite->udevice, 0), request, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buf, size, 3000);
+	timeout = rtt_timeout(dynamite, RTT_CONTROL);
+	start = ktime_get();
+	result = usb_control_msg(dynamite->udevice, usb_rcvctrlpipe(dynamite->udevice, 0), request, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE, address, 0, buf, size, timeout);
+	rtt_sample(dynamite, RTT_CONTROL, start, result, timeout);
 
 	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
 		dump_buffer(dynamite, buf, "data_in", size);
@@ -133,18 +270,137 @@ static int vendor_command_rcv(struct usb_dynamite *dynamite, unsigned char reque
 	return result;
 }
 
-static int bulk_command_snd(struct usb_dynamite *dynamite, const char *buf, int size, int count)
+static int bulk_packet_size(struct usb_dynamite *dynamite, const struct usb_endpoint_descriptor *endpoint)
 {
-	int result;
-	unsigned char tmp[64];
-	unsigned char *buffer;
+	int size = usb_endpoint_maxp(endpoint);
+
+	/* fall back to what the link allows if the descriptor makes no sense */
+	if (size <= 0 || size > MAX_HS_PKT_SIZE)
+		size = dynamite->udevice->speed >= USB_SPEED_HIGH ? MAX_HS_PKT_SIZE : MAX_PKT_SIZE;
+
+	return size;
+}
+
+static void recovery_done(struct usb_dynamite *dynamite, int rung)
+{
+	dynamite->recovery.count[rung]++;
+	dynamite->recovery.time_ns += ktime_to_ns(ktime_sub(ktime_get(), dynamite->recover_start));
+	dynamite->recover_rung = RECOVER_CLEAR_HALT;
+}
+
+/*
+ * A bulk endpoint that keeps failing climbs a recovery ladder: clear the
+ * halt, then reset the whole device. A stall takes the next rung at once
+ * and the transfer is repeated once the halt is cleared, the stall refused
+ * it. A read timing out is no fault, there may be no card or nothing to
+ * say yet. Writes take a rung after RECOVER_OUT_TIMEOUTS timeouts in a row
+ * and are not repeated, they may already be in the device. A transfer that
+ * goes through ends the climb.
+ * Called with dynamite->lock held after every bulk transfer, returns 1 when the
+ * transfer should be repeated. The caller resets the device when *reset
+ * is set.
+ */
+static int recover_endpoint(struct usb_dynamite *dynamite, unsigned int pipe, int result, ktime_t start, int *reset)
+{
+	if (result == -ETIMEDOUT && usb_pipeout(pipe) && ++dynamite->out_timeouts >= RECOVER_OUT_TIMEOUTS)
+		dynamite->out_timeouts = 0;
+	else if (result != -EPIPE) {
+		if (result >= 0 && usb_pipeout(pipe))
+			dynamite->out_timeouts = 0;
+		if (result >= 0 && dynamite->recover_rung == RECOVER_RESET_DEVICE)
+			recovery_done(dynamite, RECOVER_CLEAR_HALT);
+		return 0;
+	}
+
+	/* the device is being reset already */
+	if (dynamite->recover_rung == RECOVER_RUNGS)
+		return 0;
+
+	if (dynamite->recover_rung == RECOVER_RESET_DEVICE) {
+		dynamite->recover_rung = RECOVER_RUNGS;
+		*reset = 1;
+		return 0;
+	}
+
+	dev_dbg(&dynamite->uinterface->dev, "%s: endpoint 0x%02x failed with %d, clearing the halt\n", __func__, usb_pipeendpoint(pipe), result);
+	dynamite->recover_start = start;
+	usb_clear_halt(dynamite->udevice, pipe);
+	dynamite->recover_rung = RECOVER_RESET_DEVICE;
+
+	return result == -EPIPE;
+}
+
+/* the caller holds dynamite->lock */
+static int bulk_transfer(struct usb_dynamite *dynamite, unsigned int pipe, char *buf, int size, int *actual, int *reset)
+{
+	int endpoint = usb_pipein(pipe) ? RTT_BULK_IN : RTT_BULK_OUT;
+	int result, timeout;
+	ktime_t start;
+
+	do {
+		timeout = rtt_timeout(dynamite, endpoint);
+		start = ktime_get();
+		result = usb_bulk_msg(dynamite->udevice, pipe, buf, size, actual, timeout);
+		rtt_sample(dynamite, endpoint, start, result, timeout);
+	} while (recover_endpoint(dynamite, pipe, result, start, reset));
+
+	return result;
+}
+
+/*
+ * Last rung, taken without dynamite->lock: pre_reset takes it to keep transfers
+ * off the bus. The firmware in ram may not survive the reset, the running
+ * mode is loaded again. The transfer that failed is not repeated, whatever
+ * it was part of is gone with the reset.
+ */
+static void recover_device(struct usb_dynamite *dynamite)
+{
+	int result, mode = dynamite->status;
 
-	if (size < MAX_PKT_SIZE) {
-		memset(tmp, 0x00, MAX_PKT_SIZE);
-		memcpy(tmp, buf, size);
-		buffer = kmemdup(tmp, MAX_PKT_SIZE, GFP_KERNEL);
+	dev_warn(&dynamite->uinterface->dev, "%s not answering, resetting the device\n", dynamite->device_name);
+
+	result = usb_lock_device_for_reset(dynamite->udevice, dynamite->uinterface);
+	if (!result) {
+		result = usb_reset_device(dynamite->udevice);
+		usb_unlock_device(dynamite->udevice);
+	}
+	/* whatever ran before the reset can't be trusted to still be there */
+	dynamite->fw_name = NULL;
+	if (!result && mode > START)
+		result = dynamite_set_mode(dynamite, mode);
+
+	mutex_lock(&dynamite->lock);
+	if (result) {
+		dev_err(&dynamite->uinterface->dev, "%s reset failed, result = %d\n", dynamite->device_name, result);
+		dynamite->recovery.failed++;
+		dynamite->recover_rung = RECOVER_CLEAR_HALT;
 	} else
-		buffer = kmemdup(buf, size, GFP_KERNEL);
+		recovery_done(dynamite, RECOVER_RESET_DEVICE);
+	mutex_unlock(&dynamite->lock);
+}
+
+static void recover_work(struct work_struct *work)
+{
+	struct usb_dynamite *dynamite = container_of(work, struct usb_dynamite, recover_work);
+
+	recover_device(dynamite);
+}
+
+/* the reset sleeps for seconds, contexts that can't wait that long hand it off */
+static void recover_schedule(struct usb_dynamite *dynamite)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dynamite->event_lock, flags);
+	if (!dynamite->disconnected)
+		schedule_work(&dynamite->recover_work);
+	spin_unlock_irqrestore(&dynamite->event_lock, flags);
+}
+
+static int bulk_command_snd(struct usb_dynamite *dynamite, const char *buf, int size, int count)
+{
+	int result, reset = 0;
+	unsigned char *buffer = kmemdup(buf, size, GFP_KERNEL);
 
 	if (!buffer) {
 		dev_err(&dynamite->uinterface->dev, "%s: kmalloc(%d) failed\n", __func__, size);
@@ -154,84 +410,439 @@ static int bulk_command_snd(struct usb_dynamite *dynamite, const char *buf, int
 	mutex_lock(&dynamite->lock);
 
 	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_IN && debug != SIMPLE_DEBUG_IN) && buffer != NULL)
-		dump_buffer(dynamite, buffer, "data_out", MAX_PKT_SIZE);
+		dump_buffer(dynamite, buffer, "data_out", size);
 
-	result = usb_bulk_msg(dynamite->udevice, usb_sndbulkpipe(dynamite->udevice, dynamite->bulk_out_endpointAddr), buffer, size, NULL, 1000);
+	result = bulk_transfer(dynamite, usb_sndbulkpipe(dynamite->udevice, dynamite->bulk_out_endpointAddr), buffer, size, NULL, &reset);
+	dynamite->tx_stamp = ktime_get();
 
 	mutex_unlock(&dynamite->lock);
 
+	if (reset)
+		recover_device(dynamite);
+
 	if (buffer)
 		kfree (buffer);
 	return result;
 }
 
+/* the caller holds dynamite->lock */
+static int __bulk_command_rcv(struct usb_dynamite *dynamite, char *buf, int size, int timeout)
+{
+	int result, actual = 0;
+
+	result = usb_bulk_msg(dynamite->udevice, usb_rcvbulkpipe(dynamite->udevice, dynamite->bulk_in_endpointAddr), buf, size, &actual, timeout);
+
+	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
+		dump_buffer(dynamite, buf, "data_in", actual);
+
+	return result < 0 ? result : actual;
+}
+
 static int bulk_command_rcv(struct usb_dynamite *dynamite, char *buf, int size, int count)
 {
-	int result;
+	int result, actual = 0, reset = 0;
 
 	mutex_lock(&dynamite->lock);
+	result = bulk_transfer(dynamite, usb_rcvbulkpipe(dynamite->udevice, dynamite->bulk_in_endpointAddr), buf, size, &actual, &reset);
+	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
+		dump_buffer(dynamite, buf, "data_in", actual);
+	mutex_unlock(&dynamite->lock);
 
-	result = usb_bulk_msg(dynamite->udevice, usb_rcvbulkpipe(dynamite->udevice, dynamite->bulk_in_endpointAddr), buf, size, NULL, 1000);
+	if (reset)
+		recover_device(dynamite);
 
-	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && buf != NULL)
-		dump_buffer(dynamite, buf, "data_in", MAX_PKT_SIZE);
+	return result < 0 ? result : actual;
+}
+
+static void stamp_callback(struct urb *urb)
+{
+	struct dynamite_stamp *stamp = urb->context;
+
+	stamp->time = ktime_get();
+	complete(&stamp->done);
+}
+
+/* like __bulk_command_rcv(), but reports when the urb actually completed */
+static int __bulk_command_rcv_stamped(struct usb_dynamite *dynamite, char *buf, int size, int timeout, ktime_t *time)
+{
+	struct dynamite_stamp stamp;
+	struct urb *urb;
+	int result;
+
+	urb = usb_alloc_urb(0, GFP_KERNEL);
+	if (!urb)
+		return -ENOMEM;
+
+	init_completion(&stamp.done);
+	usb_fill_bulk_urb(urb, dynamite->udevice, usb_rcvbulkpipe(dynamite->udevice, dynamite->bulk_in_endpointAddr), buf, size, stamp_callback, &stamp);
+
+	result = usb_submit_urb(urb, GFP_KERNEL);
+	if (!result) {
+		if (!wait_for_completion_timeout(&stamp.done, msecs_to_jiffies(timeout))) {
+			usb_kill_urb(urb);
+			result = -ETIMEDOUT;
+		} else
+			result = urb->status ? urb->status : urb->actual_length;
+		*time = stamp.time;
+	}
+	usb_free_urb(urb);
+
+	if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && result > 0)
+		dump_buffer(dynamite, buf, "data_in", result);
+
+	return result;
+}
+
+static void sg_poll(struct work_struct *work)
+{
+	struct dynamite_sg_wait *wait = container_of(to_delayed_work(work), struct dynamite_sg_wait, poll);
+	size_t bytes = READ_ONCE(wait->io.bytes);
+
+	/* every urb that completes starts the timeout over */
+	if (bytes != wait->bytes) {
+		wait->bytes = bytes;
+		wait->deadline = jiffies + wait->timeout;
+	}
+
+	if (signal_pending(wait->task))
+		wait->status = -EINTR;
+	else if (time_after(jiffies, wait->deadline))
+		wait->status = -ETIMEDOUT;
+	else {
+		schedule_delayed_work(&wait->poll, msecs_to_jiffies(SG_POLL_MS));
+		return;
+	}
+
+	usb_sg_cancel(&wait->io);
+}
+
+/*
+ * usb_sg_wait() sleeps uninterruptibly until every urb is back, so a poll
+ * cancels the request when it makes no progress for timeout ms or the
+ * caller gets a signal. Data already moved is reported, not the error.
+ */
+static int sg_wait(struct dynamite_sg_wait *wait, int timeout)
+{
+	wait->task = current;
+	wait->timeout = msecs_to_jiffies(timeout);
+	wait->deadline = jiffies + wait->timeout;
+	wait->bytes = 0;
+	wait->status = 0;
+
+	INIT_DELAYED_WORK_ONSTACK(&wait->poll, sg_poll);
+	schedule_delayed_work(&wait->poll, msecs_to_jiffies(SG_POLL_MS));
+	usb_sg_wait(&wait->io);
+	cancel_delayed_work_sync(&wait->poll);
+	destroy_delayed_work_on_stack(&wait->poll);
+
+	if (wait->status)
+		return wait->io.bytes ? wait->io.bytes : wait->status;
+
+	return wait->io.status ? wait->io.status : wait->io.bytes;
+}
+
+static struct mutex *channel_lock(struct usb_dynamite *dynamite, int channel)
+{
+	/* channel 0 shares its lock with the command path */
+	return channel ? &dynamite->channel[channel].lock : &dynamite->lock;
+}
+
+/*
+ * Move a user buffer of any size in one scatter-gather request. The pages
+ * are pinned for the duration of the transfer, so the controller reads or
+ * writes user memory directly.
+ */
+static int bulk_command_user(struct usb_dynamite *dynamite, int channel, int dir_in, __u64 user_buffer, __u32 length)
+{
+	struct dynamite_channel *ch = &dynamite->channel[channel];
+	unsigned long start = (unsigned long)u64_to_user_ptr(user_buffer);
+	unsigned int offset = offset_in_page(start);
+	int npages = DIV_ROUND_UP(offset + length, PAGE_SIZE);
+	int endpoint = dir_in ? RTT_BULK_IN : RTT_BULK_OUT;
+	unsigned int pipe;
+	struct dynamite_sg_wait wait;
+	struct sg_table table;
+	struct page **pages;
+	int pinned, result, timeout, reset = 0;
+	ktime_t began;
+
+	pages = kvmalloc_array(npages, sizeof(struct page *), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	pinned = pin_user_pages_fast(start & PAGE_MASK, npages, dir_in ? FOLL_WRITE : 0, pages);
+	if (pinned != npages) {
+		result = pinned < 0 ? pinned : -EFAULT;
+		goto unpin;
+	}
+
+	result = sg_alloc_table_from_pages(&table, pages, npages, offset, length, GFP_KERNEL);
+	if (result)
+		goto unpin;
+
+	if (dir_in)
+		pipe = usb_rcvbulkpipe(dynamite->udevice, ch->bulk_in_endpointAddr);
+	else
+		pipe = usb_sndbulkpipe(dynamite->udevice, ch->bulk_out_endpointAddr);
+
+	mutex_lock(channel_lock(dynamite, channel));
+	timeout = rtt_timeout(dynamite, endpoint);
+	began = ktime_get();
+	result = usb_sg_init(&wait.io, dynamite->udevice, pipe, 0, table.sgl, table.nents, length, GFP_KERNEL);
+	if (!result) {
+		result = sg_wait(&wait, timeout);
+		if (!dir_in)
+			dynamite->tx_stamp = ktime_get();
+	}
+	mutex_unlock(channel_lock(dynamite, channel));
 
+	/* a long transfer says nothing about the response time, its timeout does */
+	mutex_lock(&dynamite->lock);
+	if (length <= MAX_WRITE_URB_SIZE || result == -ETIMEDOUT)
+		rtt_sample(dynamite, endpoint, began, result, timeout);
+	recover_endpoint(dynamite, pipe, result, began, &reset);
 	mutex_unlock(&dynamite->lock);
 
+	if (reset)
+		recover_device(dynamite);
+
+	sg_free_table(&table);
+unpin:
+	if (pinned > 0)
+		unpin_user_pages_dirty_lock(pages, pinned, dir_in && result > 0);
+	kvfree(pages);
+
+	return result;
+}
+
+static int eeprom_size(struct usb_dynamite *dynamite)
+{
+	/* fx1 boards carry a single byte addressed eeprom, fx2 boards a 24lc64 */
+	return dynamite->device_running == DYNAMITE_DEVICE ? EEPROM_SMALL_SIZE : EEPROM_LARGE_SIZE;
+}
+
+static int eeprom_request(struct usb_dynamite *dynamite)
+{
+	return dynamite->device_running == DYNAMITE_DEVICE ? EEPROM_SMALL_REQUEST : EEPROM_LARGE_REQUEST;
+}
+
+static int read_eeprom(struct usb_dynamite *dynamite, unsigned char *buf, int len, int offset)
+{
+	int result = 0, chunk, done;
+	unsigned char *page;
+
+	if (offset < 0 || len < 0 || offset + len > eeprom_size(dynamite))
+		return -EINVAL;
+
+	page = kmalloc(EEPROM_READ_SIZE, GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	for (done = 0; done < len; done += chunk) {
+		chunk = MIN(len - done, EEPROM_READ_SIZE);
+		result = vendor_command_rcv(dynamite, eeprom_request(dynamite), offset + done, 0, (char *)page, chunk);
+		if (result < 0)
+			goto out;
+		if (result != chunk) {
+			result = -EIO;
+			goto out;
+		}
+
+		memcpy(buf + done, page, chunk);
+	}
+	result = done;
+	dev_dbg(&dynamite->uinterface->dev, "read eeprom (offset: 0x%x, len: %d)\n", offset, done);
+out:
+	kfree(page);
 	return result;
 }
 
-static int read_eeprom(struct usb_dynamite *dynamite,unsigned char *buf, int len, int offset)
+static int write_eeprom(struct usb_dynamite *dynamite, const unsigned char *buf, int len, int offset)
+{
+	int result = 0, chunk, done;
+
+	if (offset < 0 || len < 0 || offset + len > eeprom_size(dynamite))
+		return -EINVAL;
+
+	/* a page write must not cross a page boundary of the eeprom */
+	for (done = 0; done < len; done += chunk) {
+		chunk = MIN(len - done, EEPROM_PAGE_SIZE - ((offset + done) % EEPROM_PAGE_SIZE));
+		result = vendor_command_snd(dynamite, eeprom_request(dynamite), offset + done, 0, (const char *)buf + done, chunk);
+		if (result < 0)
+			return result;
+		if (result != chunk)
+			return -EIO;
+	}
+	dev_dbg(&dynamite->uinterface->dev, "write eeprom (offset: 0x%x, len: %d)\n", offset, done);
+
+	return done;
+}
+
+static void batch_callback(struct urb *urb)
+{
+	struct dynamite_batch *batch = urb->context;
+
+	if (urb->status)
+		cmpxchg(&batch->status, 0, urb->status);
+
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+static struct urb *batch_urb(struct usb_dynamite *dynamite, struct dynamite_batch *batch, unsigned int pipe, const __u8 *data, int size)
+{
+	struct urb *urb;
+	unsigned char *buffer;
+
+	urb = usb_alloc_urb(0, GFP_KERNEL);
+	if (!urb)
+		return NULL;
+
+	buffer = data ? kmemdup(data, size, GFP_KERNEL) : kzalloc(size, GFP_KERNEL);
+	if (!buffer) {
+		usb_free_urb(urb);
+		return NULL;
+	}
+
+	usb_fill_bulk_urb(urb, dynamite->udevice, pipe, buffer, size, batch_callback, batch);
+	urb->transfer_flags |= URB_FREE_BUFFER;
+
+	return urb;
+}
+
+/*
+ * Submit count urbs of one batch and wait until all of them completed. The
+ * responses are expected first in urbs, so they are queued before any
+ * request goes out. The caller holds dynamite->lock.
+ */
+static int batch_submit(struct usb_dynamite *dynamite, struct dynamite_batch *batch, struct urb **urbs, int count, int timeout)
 {
+	struct usb_anchor anchor;
 	int i, result;
-	char *v, br[2];
-	for (i=0; i < len; i++) {
-		v = offset + i;
-		result = vendor_command_rcv(dynamite, 0xA2, 0, 0, v, 2);
-		if (result)
+
+	init_usb_anchor(&anchor);
+	init_completion(&batch->done);
+	atomic_set(&batch->pending, count);
+	batch->status = 0;
+
+	for (i = 0; i < count; i++) {
+		if ((debug != DEBUG_NONE && debug != FULL_DEBUG_IN && debug != SIMPLE_DEBUG_IN) && usb_pipeout(urbs[i]->pipe))
+			dump_buffer(dynamite, urbs[i]->transfer_buffer, "data_out", urbs[i]->transfer_buffer_length);
+
+		usb_anchor_urb(urbs[i], &anchor);
+		result = usb_submit_urb(urbs[i], GFP_KERNEL);
+		if (result) {
+			usb_unanchor_urb(urbs[i]);
+			dev_err(&dynamite->uinterface->dev, "%s: failed submitting urb, error %d\n", __func__, result);
+			usb_kill_anchored_urbs(&anchor);
 			return result;
+		}
+	}
+
+	if (!wait_for_completion_timeout(&batch->done, msecs_to_jiffies(timeout))) {
+		usb_kill_anchored_urbs(&anchor);
+		return -ETIMEDOUT;
+	}
+
+	for (i = 0; i < count; i++) {
+		if ((debug != DEBUG_NONE && debug != FULL_DEBUG_OUT && debug != SIMPLE_DEBUG_OUT) && usb_pipein(urbs[i]->pipe))
+			dump_buffer(dynamite, urbs[i]->transfer_buffer, "data_in", urbs[i]->actual_length);
+	}
+
+	return batch->status;
+}
+
+/*
+ * Pipeline count records, an opt-in through batch_records. Every response
+ * urb is queued before the first record goes out, but each record still
+ * travels in its own packet and the firmware answers each one on its own,
+ * this saves host round trips, not transfers. The responses are not looked
+ * at, like in the one by one path. A stall or a timeout climbs the recovery
+ * ladder; the round trip of a single record can't be told apart in a
+ * pipeline, so no rtt sample is taken.
+ */
+static int send_record_batch(struct usb_dynamite *dynamite, const __u8 *record, int count)
+{
+	struct dynamite_batch batch;
+	struct urb **urbs;
+	int i, result = 0, reset = 0;
+	ktime_t start;
+
+	urbs = kcalloc(2 * count, sizeof(struct urb *), GFP_KERNEL);
+	if (!urbs)
+		return -ENOMEM;
 
-		buf[i] = br[1];
+	for (i = 0; i < count; i++, record = dynamite_record_next(record)) {
+		urbs[i] = batch_urb(dynamite, &batch, usb_rcvbulkpipe(dynamite->udevice, dynamite->bulk_in_endpointAddr), NULL, dynamite->bulk_in_maxp);
+		urbs[count + i] = batch_urb(dynamite, &batch, usb_sndbulkpipe(dynamite->udevice, dynamite->bulk_out_endpointAddr), &record[1], record[0]);
+		if (!urbs[i] || !urbs[count + i]) {
+			result = -ENOMEM;
+			goto free;
+		}
 	}
-	dev_info(&dynamite->uinterface->dev, "read eeprom (offset: 0x%x, len: %d) : ", offset, i);
+
+	mutex_lock(&dynamite->lock);
+	/* the responses come one after the other, each may take a round trip */
+	start = ktime_get();
+	result = batch_submit(dynamite, &batch, urbs, 2 * count, rtt_timeout(dynamite, RTT_BULK_IN) * count);
+	recover_endpoint(dynamite, usb_sndbulkpipe(dynamite->udevice, dynamite->bulk_out_endpointAddr), result, start, &reset);
+	mutex_unlock(&dynamite->lock);
+
+	if (reset)
+		recover_device(dynamite);
+free:
+	for (i = 0; i < 2 * count; i++)
+		usb_free_urb(urbs[i]);
+	kfree(urbs);
+
 	return result;
 }
 
 static int send_command(struct usb_dynamite *dynamite, int id)
 {
-	int i, result;
-	const struct dynamite_hex_record *record = NULL;
+	int count, result;
+	const __u8 *record = NULL, *next;
 
 	if (id == START) {
 		if (dynamite->device_running == DYNAMITE_DEVICE)
-			record = &dynamite_init_code[0];
+			record = dynamite_init_code;
 		else if (dynamite->device_running == DYNAMITE_PLUS_DEVICE)
-			record = &dynamiteplus_init_code[0];
+			record = dynamiteplus_init_code;
 	} else if (id == PHOENIX_357)
-		record = &phoenix_357_code[0];
+		record = phoenix_357_code;
 	else if (id == PHOENIX_368)
-		record = &phoenix_368_code[0];
+		record = phoenix_368_code;
 	else if (id == PHOENIX_400)
-		record = &phoenix_400_code[0];
+		record = phoenix_400_code;
 	else if (id == PHOENIX_600)
-		record = &phoenix_600_code[0];
+		record = phoenix_600_code;
 	else if (id == SMARTMOUSE_357)
-		record = &smartmouse_357_code[0];
+		record = smartmouse_357_code;
 	else if (id == SMARTMOUSE_368)
-		record = &smartmouse_368_code[0];
+		record = smartmouse_368_code;
 	else if (id == SMARTMOUSE_400)
-		record = &smartmouse_400_code[0];
+		record = smartmouse_400_code;
 	else if (id == SMARTMOUSE_600)
-		record = &smartmouse_600_code[0];
-
-	while(record->data_size != 0) {
-		result = bulk_command_snd(dynamite, (unsigned char *)record->data, record->data_size, 0);
-		result = bulk_command_rcv(dynamite, dynamite->bulk_in_buffer, MAX_PKT_SIZE, 0);
+		record = smartmouse_600_code;
+
+	if (!record)
+		return -EINVAL;
+
+	while (record[0] != 0) {
+		if (batch_records > 1) {
+			for (next = record, count = 0; next[0] != 0 && count < batch_records; count++)
+				next = dynamite_record_next(next);
+
+			result = send_record_batch(dynamite, record, count);
+			record = next;
+		} else {
+			result = bulk_command_snd(dynamite, (const char *)&record[1], record[0], 0);
+			result = bulk_command_rcv(dynamite, dynamite->bulk_in_buffer, dynamite->bulk_in_maxp, 0);
+			record = dynamite_record_next(record);
+		}
 
 		if (result < 0)
 			goto out;
-
-		record++;
 	}
 
 	return 0;
@@ -284,23 +895,26 @@ static int send_smartmouse_600_command(struct usb_dynamite *dynamite)
 	return send_command(dynamite, SMARTMOUSE_600);
 }
 
-static int dynamite_firmware_load(struct usb_dynamite *dynamite, int id, int reset_cpu)
+/* the image is read once, for the hash and for the download */
+static int dynamite_firmware_request(struct usb_dynamite *dynamite, const char *fw_name, const struct firmware **firmware, u32 *fw_hash)
 {
-	int response = -ENOENT;
-	const char *fw_name;
+	int result;
 
-	dev_dbg(&dynamite->uinterface->dev, "%s: sending %s...", __func__, fw_name);
+	result = request_ihex_firmware(firmware, fw_name, &dynamite->udevice->dev);
+	if (result < 0)
+		return result;
 
-	if (reset_cpu != NO_RESET_CPU) {
-		dev_dbg(&dynamite->uinterface->dev, "%s reset cpu\n", dynamite->device_name);
-		if (dynamite->device_running == DYNAMITE_DEVICE)
-			response = ezusb_fx1_set_reset(dynamite->udevice, 1);
-		else if (dynamite->device_running == DYNAMITE_PLUS_DEVICE)
-			response = ezusb_fx2_set_reset(dynamite->udevice, 1);
-	}
+	*fw_hash = crc32_le(~0, (*firmware)->data, (*firmware)->size);
 
-	if (response < 0)
-		goto out;
+	return 0;
+}
+
+static int dynamite_firmware_load(struct usb_dynamite *dynamite, int id, int reset_cpu)
+{
+	int response = -ENOENT;
+	const char *fw_name = NULL;
+	const struct firmware *firmware = NULL;
+	u32 fw_hash;
 
 	if (0) { ; }
 	else if (le16_to_cpu(id) == VEND_AX) {
@@ -337,23 +951,60 @@ static int dynamite_firmware_load(struct usb_dynamite *dynamite, int id, int res
 		goto out;
 	}
 
-	if (dynamite->device_running == DYNAMITE_DEVICE) {
-		if (ezusb_fx1_ihex_firmware_download(dynamite->udevice, fw_name) < 0) {
-			dev_err(&dynamite->uinterface->dev, "failed to load firmware \"%s\"\n",
-				fw_name);
-			return -ENOENT;
-		}
+	if (!fw_name) {
+		dev_err(&dynamite->uinterface->dev, "%s: no %s firmware for %s device\n",
+			__func__, dynamite_device_status[id], dynamite->device_name);
+		goto out;
 	}
-	else if (dynamite->device_running == DYNAMITE_PLUS_DEVICE)
-	{
-		if (ezusb_fx2_ihex_firmware_download(dynamite->udevice, fw_name) < 0) {
-			dev_err(&dynamite->uinterface->dev, "failed to load firmware \"%s\"\n",
-				fw_name);
-			return -ENOENT;
-		}
+
+	if (dynamite_firmware_request(dynamite, fw_name, &firmware, &fw_hash) < 0) {
+		dev_err(&dynamite->uinterface->dev, "failed to load firmware \"%s\"\n",
+			fw_name);
+		goto out;
 	}
 
-	if (reset_cpu != NO_RESET_CPU) {
+	/* the image is already running, only the mode commands are needed */
+	if (dynamite->fw_name && !strcmp(dynamite->fw_name, fw_name) && dynamite->fw_hash == fw_hash) {
+		dev_dbg(&dynamite->uinterface->dev, "%s: %s already resident, skipping upload\n", __func__, fw_name);
+		response = 0;
+		goto finish;
+	}
+
+	dev_dbg(&dynamite->uinterface->dev, "%s: sending %s...", __func__, fw_name);
+
+	/* the old image is gone as soon as the download starts */
+	dynamite->fw_name = NULL;
+
+	if (reset_cpu != NO_RESET_CPU) {
+		dev_dbg(&dynamite->uinterface->dev, "%s reset cpu\n", dynamite->device_name);
+		if (dynamite->device_running == DYNAMITE_DEVICE)
+			response = ezusb_fx1_set_reset(dynamite->udevice, 1);
+		else if (dynamite->device_running == DYNAMITE_PLUS_DEVICE)
+			response = ezusb_fx2_set_reset(dynamite->udevice, 1);
+	}
+
+	if (response < 0)
+		goto out;
+
+	if (dynamite->device_running == DYNAMITE_DEVICE) {
+		if (ezusb_fx1_ihex_firmware_write(dynamite->udevice, firmware) < 0) {
+			dev_err(&dynamite->uinterface->dev, "failed to load firmware \"%s\"\n",
+				fw_name);
+			response = -ENOENT;
+			goto out;
+		}
+	}
+	else if (dynamite->device_running == DYNAMITE_PLUS_DEVICE)
+	{
+		if (ezusb_fx2_ihex_firmware_write(dynamite->udevice, firmware) < 0) {
+			dev_err(&dynamite->uinterface->dev, "failed to load firmware \"%s\"\n",
+				fw_name);
+			response = -ENOENT;
+			goto out;
+		}
+	}
+
+	if (reset_cpu != NO_RESET_CPU) {
 		dev_dbg(&dynamite->uinterface->dev, "Dynamite Programmer reset cpu\n");
 		if (dynamite->device_running == DYNAMITE_DEVICE)
 			response = ezusb_fx1_set_reset(dynamite->udevice, 0);
@@ -364,6 +1015,11 @@ static int dynamite_firmware_load(struct usb_dynamite *dynamite, int id, int res
 	if (response < 0)
 		goto out;
 
+	dynamite->fw_name = fw_name;
+	dynamite->fw_hash = fw_hash;
+	response = 1;
+	event_post(dynamite, EVENT_RESET, 0, NULL, 0);
+finish:
 	if (dynamite->state == START_LOAD_VEND_AX_FW)
 		dynamite->state = FINISH_LOAD_VEND_AX_FW;
 	else if (dynamite->state == START_LOAD_START_FW)
@@ -373,8 +1029,10 @@ static int dynamite_firmware_load(struct usb_dynamite *dynamite, int id, int res
 	else if (dynamite->state == START_LOAD_CARDPROGRAMMER_FW)
 		dynamite->state = FINISH_LOAD_CARDPROGRAMMER_FW;
 
-	return 1;
+	release_firmware(firmware);
+	return response;
 out:
+	release_firmware(firmware);
 	return response;
 }
 
@@ -411,12 +1069,12 @@ static int dynamite_set_phoenix_357_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_357_command(dynamite);
+	if (result >= 0)
+		result = send_phoenix_357_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to phoenix mode 357 mhz\n", dynamite->device_name);
 
@@ -427,12 +1085,12 @@ static int dynamite_set_phoenix_368_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_368_command(dynamite);
+	if (result >= 0)
+		result = send_phoenix_368_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to phoenix mode 368 mhz\n", dynamite->device_name);
 
@@ -443,12 +1101,12 @@ static int dynamite_set_phoenix_400_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_400_command(dynamite);
+	if (result >= 0)
+		result = send_phoenix_400_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to phoenix mode 400 mhz\n", dynamite->device_name);
 
@@ -460,12 +1118,12 @@ static int dynamite_set_phoenix_600_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_phoenix_600_command(dynamite);
+	if (result >= 0)
+		result = send_phoenix_600_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to phoenix mode 600 mhz\n", dynamite->device_name);
 
@@ -476,12 +1134,12 @@ static int dynamite_set_smartmouse_357_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_357_command(dynamite);
+	if (result >= 0)
+		result = send_smartmouse_357_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to smartmouse mode 357 mhz\n", dynamite->device_name);
 
@@ -492,12 +1150,12 @@ static int dynamite_set_smartmouse_368_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_368_command(dynamite);
+	if (result >= 0)
+		result = send_smartmouse_368_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to smartmouse mode 368 mhz\n", dynamite->device_name);
 
@@ -508,12 +1166,12 @@ static int dynamite_set_smartmouse_400_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_400_command(dynamite);
+	if (result >= 0)
+		result = send_smartmouse_400_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to smartmouse mode 400 mhz\n", dynamite->device_name);
 
@@ -524,12 +1182,12 @@ static int dynamite_set_smartmouse_600_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-	if (dynamite->state != FINISH_LOAD_MOUSE_PHOENIX_FW) {
-		result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	result = dynamite_firmware_load(dynamite, MOUSE_PHOENIX, RESET_CPU);
+	if (result > 0)
 		wait_for_finish(dynamite, WAIT_FOR_FW);
-	}
 
-	result = send_smartmouse_600_command(dynamite);
+	if (result >= 0)
+		result = send_smartmouse_600_command(dynamite);
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to smartmouse mode 600 mhz\n", dynamite->device_name);
 
@@ -540,56 +1198,384 @@ static int dynamite_set_cardprogrammer_fw(struct usb_dynamite *dynamite)
 {
 	int result;
 
-        result = dynamite_firmware_load(dynamite, CARDPROGRAMMER, RESET_CPU);
-	wait_for_finish(dynamite, WAIT_FOR_FW);
+	result = dynamite_firmware_load(dynamite, CARDPROGRAMMER, RESET_CPU);
+	if (result > 0)
+		wait_for_finish(dynamite, WAIT_FOR_FW);
+
 	if (result >= 0)
 		dev_info(&dynamite->uinterface->dev, "%s set to card programmer mode\n", dynamite->device_name);
 
-        return result;
+	return result;
+}
+
+/* find the boot entry for this port, entries of devices that never came back expire */
+static struct dynamite_boot *boot_find(struct usb_dynamite *dynamite, int create)
+{
+	const char *path = dev_name(&dynamite->udevice->dev);
+	struct dynamite_boot *boot, *slot = NULL;
+	int i;
+
+	for (i = 0; i < BOOT_ENTRIES; i++) {
+		boot = &boot_table[i];
+		if (boot->path[0] && ktime_ms_delta(ktime_get(), boot->start) > BOOT_TIMEOUT_MS)
+			boot->path[0] = 0;
+		if (boot->path[0] && !strcmp(boot->path, path))
+			return boot;
+		if (!slot && !boot->path[0])
+			slot = boot;
+	}
+
+	if (!create || !slot)
+		return NULL;
+
+	strscpy(slot->path, path, RESTORE_KEY_SIZE);
+	slot->start = ktime_get();
+	slot->state = dynamite->state;
+	slot->mode = -1;
+
+	return slot;
+}
+
+/* the pre-enumeration device showed up, remember it until it comes back */
+static void boot_begin(struct usb_dynamite *dynamite)
+{
+	mutex_lock(&boot_lock);
+	/* without an entry a mode request could not survive the re-enumeration */
+	if (boot_find(dynamite, 1))
+		dynamite->booting = 1;
+	else
+		dev_warn(&dynamite->uinterface->dev, "%s boot table full\n", dynamite->device_name);
+	mutex_unlock(&boot_lock);
+}
+
+static void boot_progress(struct usb_dynamite *dynamite)
+{
+	struct dynamite_boot *boot;
+
+	mutex_lock(&boot_lock);
+	boot = boot_find(dynamite, 0);
+	if (boot)
+		boot->state = dynamite->state;
+	mutex_unlock(&boot_lock);
+}
+
+/* a mode requested while booting is applied once the device is back */
+static int boot_request(struct usb_dynamite *dynamite, int mode)
+{
+	struct dynamite_boot *boot;
+
+	mutex_lock(&boot_lock);
+	boot = boot_find(dynamite, 0);
+	if (boot)
+		boot->mode = mode;
+	mutex_unlock(&boot_lock);
+
+	/* the entry expired, the device did not come back in time */
+	return boot ? 0 : -EBUSY;
+}
+
+/* the post-enumeration device is live, take over what the first one left */
+static int boot_finish(struct usb_dynamite *dynamite, s64 *duration)
+{
+	struct dynamite_boot *boot;
+	int found = 0;
+
+	mutex_lock(&boot_lock);
+	boot = boot_find(dynamite, 0);
+	if (boot) {
+		dynamite->state = boot->state;
+		dynamite->boot_mode = boot->mode;
+		*duration = ktime_us_delta(ktime_get(), boot->start);
+		boot->path[0] = 0;
+		found = 1;
+	}
+	mutex_unlock(&boot_lock);
+
+	return found;
+}
+
+/* tell user space about a mode transition without it having to poll sysfs */
+static void mode_notify(struct usb_dynamite *dynamite, int result, s64 duration)
+{
+	char mode[32], state[32], duration_us[32];
+	char *envp[] = { mode, state, duration_us, NULL };
+
+	snprintf(mode, sizeof(mode), "MODE=%s", dynamite_device_status[dynamite->status]);
+	snprintf(state, sizeof(state), "STATE=%s", result < 0 ? "error" : "ready");
+	snprintf(duration_us, sizeof(duration_us), "DURATION_US=%lld", (long long)duration);
+
+	kobject_uevent_env(&dynamite->uinterface->dev.kobj, KOBJ_CHANGE, envp);
+	sysfs_notify(&dynamite->uinterface->dev.kobj, NULL, "status");
 }
 
+/* switch the device into one of its operating modes */
+static int dynamite_set_mode(struct usb_dynamite *dynamite, int mode)
+{
+	ktime_t start = ktime_get();
+	int result;
+
+	if (mode < 0 || mode >= ARRAY_SIZE(dynamite_device_status))
+		return -EINVAL;
+
+	/* the device is about to re-enumerate, defer the switch until it is back */
+	if (dynamite->booting)
+		return boot_request(dynamite, mode);
+
+	switch (mode) {
+		case PHOENIX_357:
+			result = dynamite_set_phoenix_357_fw(dynamite);
+			break;
+		case PHOENIX_368:
+			result = dynamite_set_phoenix_368_fw(dynamite);
+			break;
+		case PHOENIX_400:
+			result = dynamite_set_phoenix_400_fw(dynamite);
+			break;
+		case PHOENIX_600:
+			result = dynamite_set_phoenix_600_fw(dynamite);
+			break;
+		case SMARTMOUSE_357:
+			result = dynamite_set_smartmouse_357_fw(dynamite);
+			break;
+		case SMARTMOUSE_368:
+			result = dynamite_set_smartmouse_368_fw(dynamite);
+			break;
+		case SMARTMOUSE_400:
+			result = dynamite_set_smartmouse_400_fw(dynamite);
+			break;
+		case SMARTMOUSE_600:
+			result = dynamite_set_smartmouse_600_fw(dynamite);
+			break;
+		case CARDPROGRAMMER:
+			result = dynamite_set_cardprogrammer_fw(dynamite);
+			break;
+		default:
+			result = -EINVAL;
+			break;
+	}
+
+	/* a failed load leaves the previous mode in charge */
+	if (result >= 0)
+		dynamite->status = mode;
+
+	mode_notify(dynamite, result, ktime_us_delta(ktime_get(), start));
+
+	return result;
+}
+
+static int mode_from_name(const char *buf)
+{
+	if (!strncmp(buf, "phoenix357", 10))
+		return PHOENIX_357;
+	if (!strncmp(buf, "phoenix368", 10))
+		return PHOENIX_368;
+	if (!strncmp(buf, "phoenix400", 10))
+		return PHOENIX_400;
+	if (!strncmp(buf, "phoenix600", 10))
+		return PHOENIX_600;
+	if (!strncmp(buf, "smartmouse357", 13))
+		return SMARTMOUSE_357;
+	if (!strncmp(buf, "smartmouse368", 13))
+		return SMARTMOUSE_368;
+	if (!strncmp(buf, "smartmouse400", 13))
+		return SMARTMOUSE_400;
+	if (!strncmp(buf, "smartmouse600", 13))
+		return SMARTMOUSE_600;
+	if (!strncmp(buf, "cardprogrammer", 14))
+		return CARDPROGRAMMER;
+
+	return -EINVAL;
+}
+
+/* devices are looked up by serial number first, then by the port they sit on */
+static int restore_lookup(struct usb_dynamite *dynamite)
+{
+	const char *serial = dynamite->udevice->serial;
+	int i, mode = -1;
+
+	mutex_lock(&restore_lock);
+	for (i = 0; i < RESTORE_ENTRIES && mode < 0; i++) {
+		if (!restore_table[i].key[0])
+			continue;
+		if ((serial && !strcmp(restore_table[i].key, serial)) || !strcmp(restore_table[i].key, dev_name(&dynamite->udevice->dev)))
+			mode = restore_table[i].mode;
+	}
+	mutex_unlock(&restore_lock);
+
+	return mode;
+}
+
+/* a negative mode removes the entry */
+static int restore_set(const char *key, int mode)
+{
+	int i, slot = -1;
+
+	mutex_lock(&restore_lock);
+	for (i = 0; i < RESTORE_ENTRIES; i++) {
+		if (!strcmp(restore_table[i].key, key)) {
+			slot = i;
+			break;
+		}
+		if (slot < 0 && !restore_table[i].key[0])
+			slot = i;
+	}
+	if (slot >= 0) {
+		if (mode < 0)
+			restore_table[slot].key[0] = 0;
+		else {
+			strscpy(restore_table[slot].key, key, RESTORE_KEY_SIZE);
+			restore_table[slot].mode = mode;
+		}
+	}
+	mutex_unlock(&restore_lock);
+
+	return slot < 0 ? -ENOSPC : 0;
+}
+
+/* restore=<serial or port>:<mode>,... given at load time */
+static void restore_parse(void)
+{
+	char key[RESTORE_KEY_SIZE], *sep;
+	int i, mode;
+
+	for (i = 0; i < restore_count; i++) {
+		strscpy(key, restore[i], RESTORE_KEY_SIZE);
+		sep = strchr(key, ':');
+		if (!sep)
+			continue;
+		*sep = 0;
+		mode = mode_from_name(sep + 1);
+		if (mode < 0 || restore_set(key, mode) < 0)
+			pr_warn("dynamite: ignoring restore entry %s\n", restore[i]);
+	}
+}
+
+static void restore_work(struct work_struct *work)
+{
+	struct usb_dynamite *dynamite = container_of(work, struct usb_dynamite, restore_work);
+	int mode = dynamite->boot_mode >= 0 ? dynamite->boot_mode : restore_lookup(dynamite);
+
+	if (mode < 0)
+		return;
+
+	dev_info(&dynamite->uinterface->dev, "%s restoring %s mode\n", dynamite->device_name, dynamite_device_status[mode]);
+	dynamite_set_mode_queued(dynamite, mode);
+}
+
+static ssize_t restore_mode_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+	int mode = restore_lookup(dynamite);
+
+	return sprintf(buf, "%s", mode < 0 ? "none" : dynamite_device_status[mode]);
+}
+
+static ssize_t restore_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+	const char *key = dynamite->udevice->serial ? dynamite->udevice->serial : dev_name(&dynamite->udevice->dev);
+	int result, mode = -1;
+
+	if (strncmp(buf, "none", 4)) {
+		mode = mode_from_name(buf);
+		if (mode < 0)
+			return mode;
+	}
+
+	result = restore_set(key, mode);
+
+	return result < 0 ? result : count;
+}
+static DEVICE_ATTR(restore_mode, S_IWUSR | S_IRUGO, restore_mode_show, restore_mode_store);
+
+/* class, transactions, average and longest queue wait in us; a write clears them */
+static ssize_t queue_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	static const char * const names[PRIORITY_CLASSES] = { "high", "normal", "low" };
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+	struct dynamite_queue_stats stats[PRIORITY_CLASSES];
+	int i, len = 0;
+
+	spin_lock(&dynamite->dispatch_lock);
+	memcpy(stats, dynamite->queue_stats, sizeof(stats));
+	spin_unlock(&dynamite->dispatch_lock);
+
+	for (i = 0; i < PRIORITY_CLASSES; i++)
+		len += sprintf(buf + len, "%s %llu %llu %llu\n", names[i], stats[i].transactions,
+			       stats[i].transactions ? div_u64(div64_u64(stats[i].wait_ns, stats[i].transactions), NSEC_PER_USEC) : 0,
+			       div_u64(stats[i].max_wait_ns, NSEC_PER_USEC));
+
+	return len;
+}
+
+static ssize_t queue_stats_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+
+	spin_lock(&dynamite->dispatch_lock);
+	memset(dynamite->queue_stats, 0, sizeof(dynamite->queue_stats));
+	spin_unlock(&dynamite->dispatch_lock);
+
+	return count;
+}
+static DEVICE_ATTR(queue_stats, S_IWUSR | S_IRUGO, queue_stats_show, queue_stats_store);
+
+/* mode, endpoint, smoothed response time and deviation in us, timeout in ms, samples */
+static ssize_t timeouts_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	static const char * const names[RTT_ENDPOINTS] = { "bulk_out", "bulk_in", "control" };
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+	struct dynamite_rtt rtt;
+	int mode, i, len = 0;
+
+	for (mode = 0; mode < DEVICE_MODES; mode++) {
+		for (i = 0; i < RTT_ENDPOINTS; i++) {
+			rtt = dynamite->rtt[mode][i];
+			if (!rtt.samples)
+				continue;
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%s %s %u %u %d %u\n", dynamite_device_status[mode], names[i],
+					 rtt.srtt, rtt.rttvar, __rtt_timeout(&rtt, mode, i), rtt.samples);
+		}
+	}
+
+	return len;
+}
+static DEVICE_ATTR(timeouts, S_IRUGO, timeouts_show, NULL);
+
+/* recoveries per rung, failed device resets and the mean time to recovery in us */
+static ssize_t recovery_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+	struct dynamite_recovery recovery;
+	u32 total;
+
+	mutex_lock(&dynamite->lock);
+	recovery = dynamite->recovery;
+	mutex_unlock(&dynamite->lock);
+
+	total = recovery.count[RECOVER_CLEAR_HALT] + recovery.count[RECOVER_RESET_DEVICE];
+
+	return sprintf(buf, "clear_halt %u\nreset_device %u\nfailed %u\nmttr %llu\n",
+		       recovery.count[RECOVER_CLEAR_HALT], recovery.count[RECOVER_RESET_DEVICE],
+		       recovery.failed, total ? div_u64(div_u64(recovery.time_ns, total), NSEC_PER_USEC) : 0);
+}
+static DEVICE_ATTR(recovery, S_IRUGO, recovery_show, NULL);
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,12,0)
 static ssize_t status_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
-	struct usb_interface *interface = usb_find_interface(&dynamite_driver, 0);
-	struct usb_dynamite *dynamite = usb_get_intfdata(interface);
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
 
 	return sprintf(buf, "%s", dynamite_device_status[dynamite->status]);
 }
 
 static ssize_t status_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
-	struct usb_interface *interface = usb_find_interface(&dynamite_driver, 0);
-	struct usb_dynamite *dynamite = usb_get_intfdata(interface);
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+	int mode = mode_from_name(buf);
 
-	if (!strncmp(buf, "phoenix357", 10)) {
-		dynamite->status = PHOENIX_357;
-		dynamite_set_phoenix_357_fw(dynamite);
-	} else if (!strncmp(buf, "phoenix368", 10)) {
-		dynamite->status = PHOENIX_368;
-		dynamite_set_phoenix_368_fw(dynamite);
-	} else if (!strncmp(buf, "phoenix400", 10)) {
-		dynamite->status = PHOENIX_400;
-		dynamite_set_phoenix_400_fw(dynamite);
-	} else if (!strncmp(buf, "phoenix600", 10)) {
-		dynamite->status = PHOENIX_600;
-		dynamite_set_phoenix_600_fw(dynamite);
-	} else if (!strncmp(buf, "smartmouse357", 13)) {
-		dynamite->status = SMARTMOUSE_357;
-		dynamite_set_smartmouse_357_fw(dynamite);
-	} else if (!strncmp(buf, "smartmouse368", 13)) {
-		dynamite->status = SMARTMOUSE_368;
-		dynamite_set_smartmouse_368_fw(dynamite);
-	} else if (!strncmp(buf, "smartmouse400", 13)) {
-		dynamite->status = SMARTMOUSE_400;
-		dynamite_set_smartmouse_400_fw(dynamite);
-	} else if (!strncmp(buf, "smartmouse600", 13)) {
-		dynamite->status = SMARTMOUSE_600;
-		dynamite_set_smartmouse_600_fw(dynamite);
-        } else if (!strncmp(buf, "cardprogrammer", 14)) {
-                dynamite->status = CARDPROGRAMMER;
-                dynamite_set_cardprogrammer_fw(dynamite);
-	}
+	if (mode >= 0)
+		dynamite_set_mode_queued(dynamite, mode);
 
 	return count;
 }
@@ -598,62 +1584,213 @@ static DEVICE_ATTR_RW(status);
 #else
 static ssize_t show_status(struct device *dev, struct device_attribute *attr, char *buf)
 {
-	struct usb_interface *interface = usb_find_interface(&dynamite_driver, 0);
-	struct usb_dynamite *dynamite = usb_get_intfdata(interface);
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
 
 	return sprintf(buf, "%s", dynamite_device_status[dynamite->status]);
 }
 
 static ssize_t store_status(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
-	struct usb_interface *interface = usb_find_interface(&dynamite_driver, 0);
-        struct usb_dynamite *dynamite = usb_get_intfdata(interface);
-
-        if (!strncmp(buf, "phoenix357", 10)) {
-                dynamite->status = PHOENIX_357;
-                dynamite_set_phoenix_357_fw(dynamite);
-        } else if (!strncmp(buf, "phoenix368", 10)) {
-                dynamite->status = PHOENIX_368;
-                dynamite_set_phoenix_368_fw(dynamite);
-        } else if (!strncmp(buf, "phoenix400", 10)) {
-                dynamite->status = PHOENIX_400;
-                dynamite_set_phoenix_400_fw(dynamite);
-        } else if (!strncmp(buf, "phoenix600", 10)) {
-                dynamite->status = PHOENIX_600;
-                dynamite_set_phoenix_600_fw(dynamite);
-        } else if (!strncmp(buf, "smartmouse357", 13)) {
-                dynamite->status = SMARTMOUSE_357;
-                dynamite_set_smartmouse_357_fw(dynamite);
-        } else if (!strncmp(buf, "smartmouse368", 13)) {
-                dynamite->status = SMARTMOUSE_368;
-                dynamite_set_smartmouse_368_fw(dynamite);
-        } else if (!strncmp(buf, "smartmouse400", 13)) {
-                dynamite->status = SMARTMOUSE_400;
-                dynamite_set_smartmouse_400_fw(dynamite);
-        } else if (!strncmp(buf, "smartmouse600", 13)) {
-                dynamite->status = SMARTMOUSE_600;
-                dynamite_set_smartmouse_600_fw(dynamite);
-        } else if (!strncmp(buf, "cardprogrammer", 14)) {
-                dynamite->status = CARDPROGRAMMER;
-                dynamite_set_cardprogrammer_fw(dynamite);
-        }
-
-        return count;
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(dev));
+	int mode = mode_from_name(buf);
+
+	if (mode >= 0)
+		dynamite_set_mode_queued(dynamite, mode);
+
+	return count;
 }
 
 static DEVICE_ATTR(status, S_IWUSR | S_IRUGO, show_status, store_status);
 #endif
 
-static long dynamite_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+static ssize_t eeprom_read(struct file *filp, struct kobject *kobj, struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(kobj_to_dev(kobj)));
+
+	if (off >= eeprom_size(dynamite))
+		return 0;
+
+	return read_eeprom(dynamite, (unsigned char *)buf, MIN(count, (size_t)(eeprom_size(dynamite) - off)), off);
+}
+
+static ssize_t eeprom_write(struct file *filp, struct kobject *kobj, struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(to_usb_interface(kobj_to_dev(kobj)));
+
+	if (off >= eeprom_size(dynamite))
+		return -ENOSPC;
+
+	return write_eeprom(dynamite, (unsigned char *)buf, MIN(count, (size_t)(eeprom_size(dynamite) - off)), off);
+}
+static BIN_ATTR_RW(eeprom, 0);
+
+static void dispatch_account(struct usb_dynamite *dynamite, struct dynamite_session *session)
+{
+	struct dynamite_queue_stats *stats = &dynamite->queue_stats[session->priority];
+	u64 wait = ktime_to_ns(ktime_sub(ktime_get(), session->queued));
+
+	stats->transactions++;
+	stats->wait_ns += wait;
+	stats->max_wait_ns = max(stats->max_wait_ns, wait);
+}
+
+/*
+ * Higher classes go first, but every priority_aging ms of waiting lifts a
+ * session one class so low priority work can't starve. Only the oldest
+ * session of each class has to be looked at, it has aged the most.
+ */
+static struct dynamite_session *dispatch_pick(struct usb_dynamite *dynamite)
+{
+	struct dynamite_session *session, *best = NULL;
+	ktime_t now = ktime_get();
+	int i, rank, best_rank = INT_MAX;
+
+	for (i = 0; i < PRIORITY_CLASSES; i++) {
+		session = list_first_entry_or_null(&dynamite->dispatch_queue[i], struct dynamite_session, node);
+		if (!session)
+			continue;
+		rank = i - (int)min_t(s64, div_s64(ktime_ms_delta(now, session->queued), max(priority_aging, 1)), PRIORITY_CLASSES);
+		if (rank < best_rank) {
+			best = session;
+			best_rank = rank;
+		}
+	}
+
+	return best;
+}
+
+/* hands the device to the next waiting session, called with dispatch_lock held */
+static void dispatch_next(struct usb_dynamite *dynamite)
+{
+	struct dynamite_session *next;
+
+	next = dispatch_pick(dynamite);
+	if (next) {
+		list_del_init(&next->node);
+		dispatch_account(dynamite, next);
+	}
+	dynamite->dispatch_owner = next;
+	dynamite->dispatch_held = 0;
+	wake_up_all(&dynamite->dispatch_wait);
+}
+
+static void dispatch_hold_expired(struct work_struct *work)
+{
+	struct usb_dynamite *dynamite = container_of(to_delayed_work(work), struct usb_dynamite, dispatch_hold);
+
+	spin_lock(&dynamite->dispatch_lock);
+	if (dynamite->dispatch_held)
+		dispatch_next(dynamite);
+	spin_unlock(&dynamite->dispatch_lock);
+}
+
+/*
+ * Waits for the turn of the session. A session re-queues at the tail of its
+ * class after every transaction, so busy sessions of a class are served
+ * round robin.
+ */
+static int session_begin(struct dynamite_session *session, int flags)
+{
+	struct usb_dynamite *dynamite = session->dynamite;
+	int result = 0;
+
+	if (flags & SESSION_NOWAIT) {
+		if (!mutex_trylock(&session->lock))
+			return -EAGAIN;
+	} else if (mutex_lock_interruptible(&session->lock))
+		return -ERESTARTSYS;
+
+	spin_lock(&dynamite->dispatch_lock);
+	if (dynamite->dispatch_owner == session && dynamite->dispatch_held) {
+		cancel_delayed_work(&dynamite->dispatch_hold);
+		if (flags & SESSION_REPLY) {
+			dynamite->dispatch_held = 0;
+			spin_unlock(&dynamite->dispatch_lock);
+			return 0;
+		}
+		/* a new request instead of the reply ends the previous transaction */
+		dispatch_next(dynamite);
+	}
+	session->queued = ktime_get();
+	if (!dynamite->dispatch_owner) {
+		dynamite->dispatch_owner = session;
+		dispatch_account(dynamite, session);
+	} else if (flags & SESSION_NOWAIT)
+		result = -EAGAIN;
+	else
+		list_add_tail(&session->node, &dynamite->dispatch_queue[session->priority]);
+	spin_unlock(&dynamite->dispatch_lock);
+
+	if (!result && wait_event_interruptible(dynamite->dispatch_wait, READ_ONCE(dynamite->dispatch_owner) == session)) {
+		spin_lock(&dynamite->dispatch_lock);
+		if (dynamite->dispatch_owner == session)
+			dispatch_next(dynamite);
+		else
+			list_del_init(&session->node);
+		spin_unlock(&dynamite->dispatch_lock);
+		result = -ERESTARTSYS;
+	}
+
+	if (result)
+		mutex_unlock(&session->lock);
+
+	return result;
+}
+
+static void session_end(struct dynamite_session *session)
+{
+	struct usb_dynamite *dynamite = session->dynamite;
+
+	spin_lock(&dynamite->dispatch_lock);
+	if (dynamite->dispatch_owner == session)
+		dispatch_next(dynamite);
+	spin_unlock(&dynamite->dispatch_lock);
+	mutex_unlock(&session->lock);
+}
+
+/* a mode switch that is not made through a device node still takes its turn */
+static int dynamite_set_mode_queued(struct usb_dynamite *dynamite, int mode)
 {
 	int result;
 
-	struct usb_dynamite *dynamite = (struct usb_dynamite *)file->private_data;
+	result = session_begin(&dynamite->mode_session, 0);
+	if (result < 0)
+		return result;
+
+	result = dynamite_set_mode(dynamite, mode);
+	session_end(&dynamite->mode_session);
+
+	return result;
+}
+
+/* a request went out, keep the device until the reply is read */
+static void session_hold(struct dynamite_session *session)
+{
+	struct usb_dynamite *dynamite = session->dynamite;
+
+	spin_lock(&dynamite->dispatch_lock);
+	dynamite->dispatch_held = 1;
+	mod_delayed_work(system_wq, &dynamite->dispatch_hold, msecs_to_jiffies(SESSION_HOLD_MS));
+	spin_unlock(&dynamite->dispatch_lock);
+	mutex_unlock(&session->lock);
+}
+
+static long dynamite_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	int i, result;
+
+	struct dynamite_session *session = file->private_data;
+	struct usb_dynamite *dynamite = session->dynamite;
 	struct usb_interface *interface = usb_find_interface(&dynamite_driver, 0);
 
 	struct dynamite_bulk_command dynamite_bulk_cmd;
 	struct dynamite_vendor_command dynamite_vendor_cmd;
 	struct dynamite_device_information_command dynamite_info_cmd;
+	struct dynamite_eeprom_command dynamite_eeprom_cmd;
+	struct dynamite_bulk_command_v2 dynamite_bulk_cmd_v2;
+	struct dynamite_transfer_command dynamite_transfer_cmd;
+	struct dynamite_vendor_command_v2 dynamite_vendor_cmd_v2;
+	struct dynamite_channel_information_command dynamite_channel_cmd;
 
 	void *data;
 	unsigned char *buffer;
@@ -661,75 +1798,70 @@ static long dynamite_ioctl(struct file *file, unsigned int cmd, unsigned long ar
         if (!dynamite || !dynamite->udevice)
                 return -ENODEV;
 
+	result = session_begin(session, (cmd == IOCTL_RECV_BULK_COMMAND || cmd == IOCTL_RECV_BULK_COMMAND_V2) ? SESSION_REPLY : 0);
+	if (result)
+		return result;
+
 	switch (cmd)
 	{
 		case IOCTL_SET_PHOENIX_357:
-			dynamite->status = PHOENIX_357;
-			result = dynamite_set_phoenix_357_fw(dynamite);
+			result = dynamite_set_mode(dynamite, PHOENIX_357);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_357 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_PHOENIX_357 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PHOENIX_368:
-			dynamite->status = PHOENIX_368;
-			result = dynamite_set_phoenix_368_fw(dynamite);
+			result = dynamite_set_mode(dynamite, PHOENIX_368);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_368 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_PHOENIX_368 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PHOENIX_400:
-			dynamite->status = PHOENIX_400;
-			result = dynamite_set_phoenix_400_fw(dynamite);
+			result = dynamite_set_mode(dynamite, PHOENIX_400);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_400 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_PHOENIX_400 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_PHOENIX_600:
-			dynamite->status = PHOENIX_600;
-			result = dynamite_set_phoenix_600_fw(dynamite);
+			result = dynamite_set_mode(dynamite, PHOENIX_600);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_PHOENIX_600 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_PHOENIX_600 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_357:
-			dynamite->status = SMARTMOUSE_357;
-			result = dynamite_set_smartmouse_357_fw(dynamite);
+			result = dynamite_set_mode(dynamite, SMARTMOUSE_357);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_357 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_357 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_368:
-			dynamite->status = SMARTMOUSE_368;
-			result = dynamite_set_smartmouse_368_fw(dynamite);
+			result = dynamite_set_mode(dynamite, SMARTMOUSE_368);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_368 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_368 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_400:
-			dynamite->status = SMARTMOUSE_400;
-			result = dynamite_set_smartmouse_400_fw(dynamite);
+			result = dynamite_set_mode(dynamite, SMARTMOUSE_400);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_400 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_400 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_SMARTMOUSE_600:
-			dynamite->status = SMARTMOUSE_600;
-			result = dynamite_set_smartmouse_600_fw(dynamite);
+			result = dynamite_set_mode(dynamite, SMARTMOUSE_600);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_SMARTMOUSE_600 ioctrl, result = %d", le32_to_cpu(result));
 			else
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_SMARTMOUSE_600 ioctl, result = %d", le32_to_cpu(result));
 			break;
 		case IOCTL_SET_CARDPROGRAMMER:
-			dynamite->status = CARDPROGRAMMER;
-			result = dynamite_set_cardprogrammer_fw(dynamite);
+			result = dynamite_set_mode(dynamite, CARDPROGRAMMER);
 			if (result < 0)
 				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SET_CARDPROGRAMMER ioctrl, result = %d", le32_to_cpu(result));
 			else
@@ -861,6 +1993,207 @@ static long dynamite_ioctl(struct file *file, unsigned int cmd, unsigned long ar
 				dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SEND_BULK_COMMAND ioctl, result = %d", le32_to_cpu(result));
 			free_page((unsigned long) buffer);
 			break;
+		case IOCTL_READ_EEPROM_COMMAND:
+			data = (void *) arg;
+			if (data == NULL)
+				break;
+			if (copy_from_user(&dynamite_eeprom_cmd, data, sizeof(struct dynamite_eeprom_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (dynamite_eeprom_cmd.offset < 0 || dynamite_eeprom_cmd.offset >= eeprom_size(dynamite) || dynamite_eeprom_cmd.length < 0) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			dynamite_eeprom_cmd.length = MIN(dynamite_eeprom_cmd.length, eeprom_size(dynamite) - dynamite_eeprom_cmd.offset);
+			buffer = kmalloc(dynamite_eeprom_cmd.length, GFP_KERNEL);
+			if (!buffer) {
+				result = -ENOMEM;
+				goto err_out;
+			}
+			result = read_eeprom(dynamite, buffer, dynamite_eeprom_cmd.length, dynamite_eeprom_cmd.offset);
+			if (result < 0) {
+				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_READ_EEPROM_COMMAND ioctrl, result = %d", le32_to_cpu(result));
+				kfree(buffer);
+				goto err_out;
+			}
+			dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_READ_EEPROM_COMMAND ioctl, result = %d", le32_to_cpu(result));
+			if (copy_to_user(dynamite_eeprom_cmd.buffer, buffer, dynamite_eeprom_cmd.length) || copy_to_user(data, &dynamite_eeprom_cmd, sizeof(struct dynamite_eeprom_command))) {
+				kfree(buffer);
+				result = -EFAULT;
+				goto err_out;
+			}
+			kfree(buffer);
+			break;
+		case IOCTL_WRITE_EEPROM_COMMAND:
+			data = (void *) arg;
+			if (data == NULL)
+				break;
+			if (copy_from_user(&dynamite_eeprom_cmd, data, sizeof(struct dynamite_eeprom_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (dynamite_eeprom_cmd.offset < 0 || dynamite_eeprom_cmd.length < 0 || dynamite_eeprom_cmd.offset + dynamite_eeprom_cmd.length > eeprom_size(dynamite)) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			buffer = memdup_user(dynamite_eeprom_cmd.buffer, dynamite_eeprom_cmd.length);
+			if (IS_ERR(buffer)) {
+				result = PTR_ERR(buffer);
+				goto err_out;
+			}
+			result = write_eeprom(dynamite, buffer, dynamite_eeprom_cmd.length, dynamite_eeprom_cmd.offset);
+			kfree(buffer);
+			if (result < 0) {
+				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_WRITE_EEPROM_COMMAND ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_WRITE_EEPROM_COMMAND ioctl, result = %d", le32_to_cpu(result));
+			break;
+		case IOCTL_SET_READ_MODE:
+			if (arg != READ_MODE_FRAMED && arg != READ_MODE_STREAM && arg != READ_MODE_TIMESTAMP) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			session->read_mode = arg;
+			dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_READ_MODE ioctl, mode = %lu", arg);
+			break;
+		case IOCTL_SET_PRIORITY:
+			if (arg >= PRIORITY_CLASSES) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			/* only the turn holder gets here, the session is on no queue */
+			session->priority = arg;
+			dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SET_PRIORITY ioctl, priority = %lu", arg);
+			break;
+		case IOCTL_SEND_BULK_COMMAND_V2:
+			if (copy_from_user(&dynamite_bulk_cmd_v2, (void *)arg, sizeof(struct dynamite_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if ((dynamite_bulk_cmd_v2.flags & ~BULK_V2_CHANNEL_MASK) || dynamite_bulk_cmd_v2.flags >= dynamite->channels || dynamite_bulk_cmd_v2.length == 0 || dynamite_bulk_cmd_v2.length > BULK_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			result = bulk_command_user(dynamite, dynamite_bulk_cmd_v2.flags, 0, dynamite_bulk_cmd_v2.buffer, dynamite_bulk_cmd_v2.length);
+			if (result < 0) {
+				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_SEND_BULK_COMMAND_V2 ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_SEND_BULK_COMMAND_V2 ioctl, result = %d", le32_to_cpu(result));
+			dynamite_bulk_cmd_v2.length = result;
+			if (copy_to_user((void *)arg, &dynamite_bulk_cmd_v2, sizeof(struct dynamite_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_RECV_BULK_COMMAND_V2:
+			if (copy_from_user(&dynamite_bulk_cmd_v2, (void *)arg, sizeof(struct dynamite_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if ((dynamite_bulk_cmd_v2.flags & ~BULK_V2_CHANNEL_MASK) || dynamite_bulk_cmd_v2.flags >= dynamite->channels || dynamite_bulk_cmd_v2.length == 0 || dynamite_bulk_cmd_v2.length > BULK_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			result = bulk_command_user(dynamite, dynamite_bulk_cmd_v2.flags, 1, dynamite_bulk_cmd_v2.buffer, dynamite_bulk_cmd_v2.length);
+			if (result < 0) {
+				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_RECV_BULK_COMMAND_V2 ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_RECV_BULK_COMMAND_V2 ioctl, result = %d", le32_to_cpu(result));
+			dynamite_bulk_cmd_v2.length = result;
+			if (copy_to_user((void *)arg, &dynamite_bulk_cmd_v2, sizeof(struct dynamite_bulk_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_TRANSFER_COMMAND:
+			if (copy_from_user(&dynamite_transfer_cmd, (void *)arg, sizeof(struct dynamite_transfer_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (dynamite_transfer_cmd.reserved || (dynamite_transfer_cmd.flags & ~BULK_V2_CHANNEL_MASK) || dynamite_transfer_cmd.flags >= dynamite->channels ||
+			    dynamite_transfer_cmd.request_length == 0 || dynamite_transfer_cmd.request_length > BULK_V2_MAX_LENGTH ||
+			    dynamite_transfer_cmd.reply_length == 0 || dynamite_transfer_cmd.reply_length > BULK_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			result = bulk_command_user(dynamite, dynamite_transfer_cmd.flags, 0, dynamite_transfer_cmd.request, dynamite_transfer_cmd.request_length);
+			if (result >= 0)
+				result = bulk_command_user(dynamite, dynamite_transfer_cmd.flags, 1, dynamite_transfer_cmd.reply, dynamite_transfer_cmd.reply_length);
+			if (result < 0) {
+				dev_err(&dynamite->uinterface->dev, "Error executing IOCTL_TRANSFER_COMMAND ioctrl, result = %d", le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&dynamite->uinterface->dev, "Executed IOCTL_TRANSFER_COMMAND ioctl, result = %d", le32_to_cpu(result));
+			dynamite_transfer_cmd.reply_length = result;
+			if (copy_to_user((void *)arg, &dynamite_transfer_cmd, sizeof(struct dynamite_transfer_command))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_SEND_VENDOR_COMMAND_V2:
+		case IOCTL_RECV_VENDOR_COMMAND_V2:
+			if (copy_from_user(&dynamite_vendor_cmd_v2, (void *)arg, sizeof(struct dynamite_vendor_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			if (dynamite_vendor_cmd_v2.flags || dynamite_vendor_cmd_v2.request > 0xff || dynamite_vendor_cmd_v2.length > VENDOR_V2_MAX_LENGTH) {
+				result = -EINVAL;
+				goto err_out;
+			}
+			/* control transfers are small, a bounce buffer is fine here */
+			if (cmd == IOCTL_SEND_VENDOR_COMMAND_V2) {
+				buffer = memdup_user(u64_to_user_ptr(dynamite_vendor_cmd_v2.buffer), dynamite_vendor_cmd_v2.length);
+				if (IS_ERR(buffer)) {
+					result = PTR_ERR(buffer);
+					goto err_out;
+				}
+				result = vendor_command_snd(dynamite, dynamite_vendor_cmd_v2.request, dynamite_vendor_cmd_v2.address, dynamite_vendor_cmd_v2.index, buffer, dynamite_vendor_cmd_v2.length);
+			} else {
+				buffer = kmalloc(dynamite_vendor_cmd_v2.length, GFP_KERNEL);
+				if (!buffer) {
+					result = -ENOMEM;
+					goto err_out;
+				}
+				result = vendor_command_rcv(dynamite, dynamite_vendor_cmd_v2.request, dynamite_vendor_cmd_v2.address, dynamite_vendor_cmd_v2.index, buffer, dynamite_vendor_cmd_v2.length);
+				if (result > 0 && copy_to_user(u64_to_user_ptr(dynamite_vendor_cmd_v2.buffer), buffer, result))
+					result = -EFAULT;
+			}
+			kfree(buffer);
+			if (result < 0) {
+				dev_err(&dynamite->uinterface->dev, "Error executing vendor v2 ioctrl 0x%x, result = %d", cmd, le32_to_cpu(result));
+				goto err_out;
+			}
+			dev_dbg(&dynamite->uinterface->dev, "Executed vendor v2 ioctl 0x%x, result = %d", cmd, le32_to_cpu(result));
+			dynamite_vendor_cmd_v2.length = result;
+			if (copy_to_user((void *)arg, &dynamite_vendor_cmd_v2, sizeof(struct dynamite_vendor_command_v2))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_CHANNEL_INFORMATION_COMMAND:
+			memset(&dynamite_channel_cmd, 0, sizeof(struct dynamite_channel_information_command));
+			dynamite_channel_cmd.channels = dynamite->channels;
+			for (i = 0; i < dynamite->channels; i++) {
+				dynamite_channel_cmd.in_endpoint[i] = dynamite->channel[i].bulk_in_endpointAddr;
+				dynamite_channel_cmd.out_endpoint[i] = dynamite->channel[i].bulk_out_endpointAddr;
+				dynamite_channel_cmd.in_maxp[i] = dynamite->channel[i].bulk_in_maxp;
+				dynamite_channel_cmd.out_maxp[i] = dynamite->channel[i].bulk_out_maxp;
+			}
+			if (copy_to_user((void *)arg, &dynamite_channel_cmd, sizeof(dynamite_channel_cmd))) {
+				result = -EFAULT;
+				goto err_out;
+			}
+			break;
+		case IOCTL_GET_EVENT_FD:
+			result = dynamite_event_fd(dynamite);
+			if (result < 0)
+				goto err_out;
+			/* the new descriptor is the return value */
+			goto err_out;
 		case IOCTL_DEVICE_INFORMATION_COMMAND:
 			dynamite_info_cmd.device = dynamite->device_running;
 			dynamite_info_cmd.status = dynamite->status;
@@ -877,25 +2210,95 @@ static long dynamite_ioctl(struct file *file, unsigned int cmd, unsigned long ar
 			result = -ENOTTY;
 			break;
 	}
-	return 0;
+	result = 0;
 err_out:
+	if (!result && (cmd == IOCTL_SEND_BULK_COMMAND || cmd == IOCTL_SEND_BULK_COMMAND_V2))
+		session_hold(session);
+	else
+		session_end(session);
+
 	return result;
 }
 
-static ssize_t dynamite_read(struct file *file, char __user *buffer, size_t count, loff_t *ppos)
-{
-	int result;
-	struct usb_dynamite *dynamite = (struct usb_dynamite *)file->private_data;
-	struct usb_interface *interface = usb_find_interface(&dynamite_driver, 0);
+static ssize_t dynamite_read_transfer(struct kiocb *iocb, struct iov_iter *to)
+{
+	int chunk, timeout, result = 0;
+	size_t room, count = iov_iter_count(to), done = 0;
+	struct dynamite_session *session = iocb->ki_filp->private_data;
+	struct usb_dynamite *dynamite = session->dynamite;
+	int stamped = session->read_mode == READ_MODE_TIMESTAMP;
+	struct dynamite_read_header header;
+	ktime_t rx_stamp = 0, start;
+
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		/* only pick up what the device has ready */
+		if (!mutex_trylock(&dynamite->lock))
+			return -EAGAIN;
+		timeout = 1;
+	} else {
+		mutex_lock(&dynamite->lock);
+		timeout = rtt_timeout(dynamite, RTT_BULK_IN);
+	}
+
+	while (done < count) {
+		room = count - done;
+		if (stamped) {
+			/* every transfer needs room for its header and one packet */
+			if (room < sizeof(header) + dynamite->bulk_in_maxp) {
+				result = done ? 0 : -EINVAL;
+				break;
+			}
+			room -= sizeof(header);
+		}
+
+		/* whole packets only, a partial one would overflow */
+		chunk = min(dynamite->bulk_in_size, room);
+		if (chunk > dynamite->bulk_in_maxp)
+			chunk -= chunk % dynamite->bulk_in_maxp;
+
+		start = ktime_get();
+		if (stamped)
+			result = __bulk_command_rcv_stamped(dynamite, dynamite->bulk_in_buffer, chunk, timeout, &rx_stamp);
+		else
+			result = __bulk_command_rcv(dynamite, dynamite->bulk_in_buffer, chunk, timeout);
+		/* polls that find nothing say nothing about the device */
+		if (!(iocb->ki_flags & IOCB_NOWAIT))
+			rtt_sample(dynamite, RTT_BULK_IN, start, result, timeout);
+
+		if (stamped && !(result == -ETIMEDOUT && (iocb->ki_flags & IOCB_NOWAIT))) {
+			/* failed transfers are reported in the header too */
+			header.rx_ns = ktime_to_ns(rx_stamp);
+			header.tx_ns = ktime_to_ns(dynamite->tx_stamp);
+			header.status = result < 0 ? result : 0;
+			header.length = result < 0 ? 0 : result;
+			if (copy_to_iter(&header, sizeof(header), to) != sizeof(header)) {
+				result = -EFAULT;
+				break;
+			}
+			done += sizeof(header);
+		}
+		if (result < 0)
+			break;
+
+		if (copy_to_iter(dynamite->bulk_in_buffer, result, to) != result) {
+			result = -EFAULT;
+			break;
+		}
+		done += result;
+
+		/* a short packet or zlp ends the message */
+		if (session->read_mode != READ_MODE_STREAM && result < chunk)
+			break;
+	}
+
+	mutex_unlock(&dynamite->lock);
 
-	result = bulk_command_rcv(dynamite, dynamite->bulk_in_buffer, min(dynamite->bulk_in_size, count), count);
+	/* data already handed out is not lost on a later error */
+	if (done)
+		return done;
 
-	if (!result) {
-		if (copy_to_user(buffer, dynamite->bulk_in_buffer, count))
-			result = -EFAULT;
-		else
-			result = count;
-	}
+	if (result == -ETIMEDOUT && (iocb->ki_flags & IOCB_NOWAIT))
+		return -EAGAIN;
 
 	return result;
 }
@@ -909,77 +2312,232 @@ static void dynamite_write_bulk_callback(struct urb *urb)
 		dev_dbg(&dynamite->uinterface->dev, "nonzero write bulk status received: %d", urb->status);
 	}
 
+	dynamite->tx_stamp = ktime_get();
+
 	/* free up our allocated buffer */
 	usb_free_coherent(urb->dev, urb->transfer_buffer_length, urb->transfer_buffer, urb->transfer_dma);
+	up(&dynamite->limit_sem);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+/*
+ * Pages handed in by splice are sent straight from the page cache with a
+ * scatter-gather request instead of being copied into a urb buffer first.
+ */
+static int bulk_sg_write(struct usb_dynamite *dynamite, struct iov_iter *from, size_t len)
+{
+	struct page *pages[MAX_SG_PAGES];
+	struct dynamite_sg_wait wait;
+	struct sg_table table;
+	ssize_t bytes;
+	size_t offset;
+	int i, npages, result;
+
+	bytes = iov_iter_get_pages2(from, pages, len, MAX_SG_PAGES, &offset);
+	if (bytes <= 0)
+		return bytes ? bytes : -EFAULT;
+	npages = DIV_ROUND_UP(offset + bytes, PAGE_SIZE);
+
+	result = sg_alloc_table_from_pages(&table, pages, npages, offset, bytes, GFP_KERNEL);
+	if (result)
+		goto put;
+
+	result = usb_sg_init(&wait.io, dynamite->udevice, usb_sndbulkpipe(dynamite->udevice, dynamite->bulk_out_endpointAddr), 0, table.sgl, table.nents, bytes, GFP_KERNEL);
+	if (!result) {
+		result = sg_wait(&wait, rtt_timeout(dynamite, RTT_BULK_OUT));
+		dynamite->tx_stamp = ktime_get();
+	}
+	sg_free_table(&table);
+
+put:
+	for (i = 0; i < npages; i++)
+		put_page(pages[i]);
+
+	/* give back whatever did not make it to the device */
+	if (result < 0)
+		iov_iter_revert(from, bytes);
+	else if (result < bytes)
+		iov_iter_revert(from, bytes - result);
+
+	return result;
 }
+#endif
 
-static ssize_t dynamite_write(struct file *file, const char __user *user_buffer, size_t count, loff_t *ppos)
+static ssize_t dynamite_write_transfer(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct usb_dynamite *dynamite;
 	int result;
-	struct urb *urb = NULL;
-	char *buf = NULL;
+	size_t chunk, done = 0, count = iov_iter_count(from);
+	gfp_t gfp = (iocb->ki_flags & IOCB_NOWAIT) ? GFP_NOWAIT : GFP_KERNEL;
+	struct urb *urb;
+	char *buf;
+
+	dynamite = ((struct dynamite_session *)iocb->ki_filp->private_data)->dynamite;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+	if (iov_iter_is_bvec(from) && dynamite->udevice->bus->sg_tablesize) {
+		while (done < count) {
+			/* one request takes one slot like an urb of the copying path */
+			if (iocb->ki_flags & IOCB_NOWAIT) {
+				if (down_trylock(&dynamite->limit_sem)) {
+					result = -EAGAIN;
+					goto error;
+				}
+			} else if (down_interruptible(&dynamite->limit_sem)) {
+				result = -ERESTARTSYS;
+				goto error;
+			}
+			result = bulk_sg_write(dynamite, from, count - done);
+			up(&dynamite->limit_sem);
+			if (result <= 0)
+				goto error;
+			done += result;
+		}
+		return done;
+	}
+#endif
 
-	dynamite = (struct usb_dynamite *)file->private_data;
+	/* gather the segments into as few urbs as possible */
+	while (done < count) {
+		chunk = min_t(size_t, count - done, MAX_WRITE_URB_SIZE);
 
-	/* verify that we actually have some data to write */
-	if (count == 0)
-		goto exit;
+		/* limit the number of urbs in flight so a long stream can't eat all ram */
+		if (iocb->ki_flags & IOCB_NOWAIT) {
+			if (down_trylock(&dynamite->limit_sem)) {
+				result = -EAGAIN;
+				goto error;
+			}
+		} else if (down_interruptible(&dynamite->limit_sem)) {
+			result = -ERESTARTSYS;
+			goto error;
+		}
 
-	/* create a urb, and a buffer for it, and copy the data to the urb */
-	urb = usb_alloc_urb(0, GFP_KERNEL);
-	if (!urb) {
-		result = -ENOMEM;
-		goto error;
-	}
+		/* create a urb, and a buffer for it, and copy the data to the urb */
+		urb = usb_alloc_urb(0, gfp);
+		if (!urb) {
+			up(&dynamite->limit_sem);
+			result = -ENOMEM;
+			goto error;
+		}
 
-	buf = usb_alloc_coherent(dynamite->udevice, count, GFP_KERNEL, &urb->transfer_dma);
-	if (!buf) {
-		result = -ENOMEM;
-		goto error;
-	}
-	if (copy_from_user(buf, user_buffer, count)) {
-		result = -EFAULT;
-		goto error;
-	}
+		buf = usb_alloc_coherent(dynamite->udevice, chunk, gfp, &urb->transfer_dma);
+		if (!buf) {
+			usb_free_urb(urb);
+			up(&dynamite->limit_sem);
+			result = -ENOMEM;
+			goto error;
+		}
+		if (!copy_from_iter_full(buf, chunk, from)) {
+			usb_free_coherent(dynamite->udevice, chunk, buf, urb->transfer_dma);
+			usb_free_urb(urb);
+			up(&dynamite->limit_sem);
+			result = -EFAULT;
+			goto error;
+		}
 
-	/* initialize the urb properly */
-	usb_fill_bulk_urb(urb, dynamite->udevice, usb_sndbulkpipe(dynamite->udevice, dynamite->bulk_out_endpointAddr), buf, count, dynamite_write_bulk_callback, dynamite);
-	urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
+		/* initialize the urb properly */
+		usb_fill_bulk_urb(urb, dynamite->udevice, usb_sndbulkpipe(dynamite->udevice, dynamite->bulk_out_endpointAddr), buf, chunk, dynamite_write_bulk_callback, dynamite);
+		urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
+
+		if (debug)
+			dump_buffer(dynamite, buf, "data_out", chunk);
+
+		/* send the data out the bulk port */
+		usb_anchor_urb(urb, &dynamite->submitted);
+		result = usb_submit_urb(urb, gfp);
+		if (result) {
+			dev_err(&dynamite->uinterface->dev, "failed submitting write urb, error %d", result);
+			usb_unanchor_urb(urb);
+			usb_free_coherent(dynamite->udevice, chunk, buf, urb->transfer_dma);
+			usb_free_urb(urb);
+			up(&dynamite->limit_sem);
+			goto error;
+		}
 
-	/* send the data out the bulk port */
-	result = usb_submit_urb(urb, GFP_KERNEL);
-	if (result) {
-		dev_err(&dynamite->uinterface->dev, "failed submitting write urb, error %d", result);
-		goto error;
+		/* release our reference to this urb, the USB core will eventually free it entirely */
+		usb_free_urb(urb);
+		done += chunk;
 	}
 
-	if (debug)
-		dump_buffer(dynamite, buf, "data_out", MAX_PKT_SIZE);
+	return done;
 
-	/* release our reference to this urb, the USB core will eventually free it entirely */
-	usb_free_urb(urb);
+error:
+	if (done)
+		return done;
+	if (result == -ENOMEM && (iocb->ki_flags & IOCB_NOWAIT))
+		return -EAGAIN;
 
-exit:
-	return count;
+	return result;
+}
 
-error:
-	usb_free_coherent(dynamite->udevice, count, buf, urb->transfer_dma);
-	usb_free_urb(urb);
-	kfree(buf);
+static ssize_t dynamite_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct dynamite_session *session = iocb->ki_filp->private_data;
+	ssize_t result;
+
+	result = session_begin(session, SESSION_REPLY | ((iocb->ki_flags & IOCB_NOWAIT) ? SESSION_NOWAIT : 0));
+	if (result)
+		return result;
+
+	result = dynamite_read_transfer(iocb, to);
+	session_end(session);
+
+	return result;
+}
+
+static ssize_t dynamite_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct dynamite_session *session = iocb->ki_filp->private_data;
+	ssize_t result;
+
+	result = session_begin(session, (iocb->ki_flags & IOCB_NOWAIT) ? SESSION_NOWAIT : 0);
+	if (result)
+		return result;
+
+	result = dynamite_write_transfer(iocb, from);
+	if (result > 0)
+		session_hold(session);
+	else
+		session_end(session);
 
 	return result;
 }
 
 static int dynamite_open(struct inode *inode, struct file *file)
 {
-	int result;
+	int result = 0;
 	struct usb_interface *interface = usb_find_interface(&dynamite_driver, 0);
 	struct usb_dynamite *dynamite = usb_get_intfdata(interface);
+	struct dynamite_session *session;
+
+	session = kzalloc(sizeof(struct dynamite_session), GFP_KERNEL);
+	if (!session)
+		return -ENOMEM;
+
+	session->dynamite = dynamite;
+	mutex_init(&session->lock);
+	INIT_LIST_HEAD(&session->node);
+	session->exclusive = !!(file->f_flags & O_EXCL);
+	session->priority = PRIORITY_NORMAL;
+
+	/* O_EXCL keeps everybody else out for as long as it is open */
+	spin_lock(&dynamite->dispatch_lock);
+	if (dynamite->exclusive || (session->exclusive && dynamite->sessions))
+		result = -EBUSY;
+	else {
+		dynamite->sessions++;
+		dynamite->exclusive = session->exclusive;
+	}
+	spin_unlock(&dynamite->dispatch_lock);
+	if (result) {
+		kfree(session);
+		return result;
+	}
 
 	kref_get(&dynamite->kref);
 
-	file->private_data = dynamite;
+	file->private_data = session;
+	file->f_mode |= FMODE_NOWAIT;
 
 	dev_dbg(&dynamite->uinterface->dev, "%s Reader/Programmer device opened\n", dynamite->device_name);
 
@@ -991,6 +2549,9 @@ static void dynamite_delete(struct kref *kref)
 	struct usb_dynamite *dynamite = to_dynamite_dev(kref);
 
 	usb_put_dev(dynamite->udevice);
+	cancel_delayed_work_sync(&dynamite->dispatch_hold);
+	usb_free_urb(dynamite->int_urb);
+	kfree(dynamite->int_buffer);
 	if (dynamite->bulk_in_buffer)
 		kfree (dynamite->bulk_in_buffer);
 	if (dynamite)
@@ -999,13 +2560,25 @@ static void dynamite_delete(struct kref *kref)
 
 static int dynamite_release(struct inode *inode, struct file *file)
 {
-	int result;
+	int result = 0;
 
+	struct dynamite_session *session = file->private_data;
 	struct usb_dynamite *dynamite;
 
-	dynamite = (struct usb_dynamite *)file->private_data;
-	if (dynamite == NULL)
+	if (session == NULL)
 		return -ENODEV;
+	dynamite = session->dynamite;
+
+	spin_lock(&dynamite->dispatch_lock);
+	if (dynamite->dispatch_owner == session)
+		dispatch_next(dynamite);
+	dynamite->sessions--;
+	if (session->exclusive)
+		dynamite->exclusive = 0;
+	spin_unlock(&dynamite->dispatch_lock);
+
+	mutex_destroy(&session->lock);
+	kfree(session);
 
 	/* decrement the count on our device */
 	kref_put(&dynamite->kref, dynamite_delete);
@@ -1015,6 +2588,391 @@ static int dynamite_release(struct inode *inode, struct file *file)
 	return result;
 }
 
+/*
+ * Restart the interrupt urb after a persistent error, a stall clears the
+ * halt first. Every error in a row doubles the wait. After INT_RETRIES the
+ * device is reset and post_reset starts the urb again, if it keeps failing
+ * after that the status events stop.
+ */
+static void int_retry(struct work_struct *work)
+{
+	struct usb_dynamite *dynamite = container_of(to_delayed_work(work), struct usb_dynamite, int_retry);
+	int errors = ++dynamite->int_errors;
+
+	if (errors > INT_RETRIES + 1) {
+		dev_err(&dynamite->uinterface->dev, "%s interrupt endpoint keeps failing, no more status events\n", dynamite->device_name);
+		return;
+	}
+	if (errors > INT_RETRIES) {
+		recover_schedule(dynamite);
+		return;
+	}
+
+	if (dynamite->int_status == -EPIPE)
+		usb_clear_halt(dynamite->udevice, dynamite->int_urb->pipe);
+	if (usb_submit_urb(dynamite->int_urb, GFP_KERNEL))
+		dev_dbg(&dynamite->uinterface->dev, "failed resubmitting interrupt urb");
+}
+
+/* stop the interrupt urb, neither a completion nor a pending retry can start it again */
+static void int_stop(struct usb_dynamite *dynamite)
+{
+	usb_poison_urb(dynamite->int_urb);
+	cancel_delayed_work_sync(&dynamite->int_retry);
+}
+
+static void dynamite_int_callback(struct urb *urb)
+{
+	struct usb_dynamite *dynamite = urb->context;
+	int len = min_t(int, urb->actual_length, EVENT_DATA_SIZE);
+
+	switch (urb->status) {
+		case 0:
+			dynamite->int_errors = 0;
+			/* only changes are worth a wakeup */
+			if (len != dynamite->int_last_length || memcmp(dynamite->int_last, dynamite->int_buffer, len)) {
+				memcpy(dynamite->int_last, dynamite->int_buffer, len);
+				dynamite->int_last_length = len;
+				event_post(dynamite, EVENT_STATUS, 0, dynamite->int_buffer, len);
+			}
+			break;
+		case -ENOENT:
+		case -ECONNRESET:
+		case -ESHUTDOWN:
+			/* unlinked, the device is going away */
+			return;
+		case -EPIPE:
+		case -EPROTO:
+		case -EILSEQ:
+		case -ETIME:
+			/* these don't go away by themselves, resubmitting at once only floods */
+			event_post(dynamite, EVENT_ERROR, urb->status, NULL, 0);
+			dynamite->int_status = urb->status;
+			schedule_delayed_work(&dynamite->int_retry, msecs_to_jiffies(INT_RETRY_MS << min(dynamite->int_errors, INT_RETRIES)));
+			return;
+		default:
+			event_post(dynamite, EVENT_ERROR, urb->status, NULL, 0);
+			break;
+	}
+
+	if (usb_submit_urb(urb, GFP_ATOMIC))
+		dev_dbg(&dynamite->uinterface->dev, "failed resubmitting interrupt urb");
+}
+
+/* start listening on the interrupt in endpoint, if the firmware has one */
+static int dynamite_int_start(struct usb_dynamite *dynamite, struct usb_endpoint_descriptor *endpoint)
+{
+	int size = usb_endpoint_maxp(endpoint);
+
+	dynamite->int_urb = usb_alloc_urb(0, GFP_KERNEL);
+	dynamite->int_buffer = kmalloc(size, GFP_KERNEL);
+	if (!dynamite->int_urb || !dynamite->int_buffer)
+		return -ENOMEM;
+
+	usb_fill_int_urb(dynamite->int_urb, dynamite->udevice, usb_rcvintpipe(dynamite->udevice, endpoint->bEndpointAddress), dynamite->int_buffer, size, dynamite_int_callback, dynamite, endpoint->bInterval);
+
+	return usb_submit_urb(dynamite->int_urb, GFP_KERNEL);
+}
+
+static ssize_t dynamite_event_read(struct file *file, char __user *buffer, size_t count, loff_t *ppos)
+{
+	struct usb_dynamite *dynamite = file->private_data;
+	struct dynamite_event event;
+	size_t done = 0;
+	u32 lost;
+	int result;
+
+	if (count < sizeof(event))
+		return -EINVAL;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		result = wait_event_interruptible(dynamite->event_wait, !kfifo_is_empty(&dynamite->events) || READ_ONCE(dynamite->disconnected));
+		if (result)
+			return result;
+	}
+
+	/* the dropped events were older than anything still queued */
+	spin_lock_irq(&dynamite->event_lock);
+	lost = dynamite->events_lost;
+	dynamite->events_lost = 0;
+	spin_unlock_irq(&dynamite->event_lock);
+	if (lost) {
+		memset(&event, 0, sizeof(event));
+		event.time_ns = ktime_get_ns();
+		event.type = EVENT_OVERFLOW;
+		event.status = lost;
+		if (copy_to_user(buffer, &event, sizeof(event)))
+			return -EFAULT;
+		done += sizeof(event);
+	}
+
+	while (count - done >= sizeof(event)) {
+		spin_lock_irq(&dynamite->event_lock);
+		result = kfifo_get(&dynamite->events, &event);
+		spin_unlock_irq(&dynamite->event_lock);
+		if (!result)
+			break;
+
+		if (copy_to_user(buffer + done, &event, sizeof(event)))
+			return done ? done : -EFAULT;
+		done += sizeof(event);
+	}
+
+	if (!done && READ_ONCE(dynamite->disconnected))
+		return -ENODEV;
+
+	return done ? done : -EAGAIN;
+}
+
+static __poll_t dynamite_event_poll(struct file *file, poll_table *wait)
+{
+	struct usb_dynamite *dynamite = file->private_data;
+
+	poll_wait(file, &dynamite->event_wait, wait);
+
+	if (!kfifo_is_empty(&dynamite->events))
+		return EPOLLIN | EPOLLRDNORM;
+
+	return READ_ONCE(dynamite->disconnected) ? EPOLLHUP | EPOLLERR : 0;
+}
+
+static int dynamite_event_release(struct inode *inode, struct file *file)
+{
+	struct usb_dynamite *dynamite = file->private_data;
+
+	kref_put(&dynamite->kref, dynamite_delete);
+
+	return 0;
+}
+
+static const struct file_operations dynamite_event_fops = {
+	.owner		= THIS_MODULE,
+	.read		= dynamite_event_read,
+	.poll		= dynamite_event_poll,
+	.release	= dynamite_event_release,
+	.llseek		= noop_llseek,
+};
+
+static int dynamite_event_fd(struct usb_dynamite *dynamite)
+{
+	int fd;
+
+	kref_get(&dynamite->kref);
+	fd = anon_inode_getfd("[dynamite_event]", &dynamite_event_fops, dynamite, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		kref_put(&dynamite->kref, dynamite_delete);
+
+	return fd;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,7,0)
+static void dynamite_uring_free(struct dynamite_uring_request *req)
+{
+	usb_free_urb(req->urb);
+	kfree(req->setup);
+	kfree(req->buffer);
+	kref_put(&req->dynamite->kref, dynamite_delete);
+	kfree(req);
+}
+
+static void dynamite_uring_done(struct io_uring_cmd *ioucmd, unsigned int issue_flags)
+{
+	struct dynamite_uring_request *req = *(struct dynamite_uring_request **)ioucmd->pdu;
+	struct usb_dynamite *dynamite = req->dynamite;
+	int result = req->result, reset = 0;
+
+	cancel_delayed_work_sync(&req->expire);
+	/* an unlinked urb comes back as -ECONNRESET, a killed one as -ENOENT */
+	if (result == -ECONNRESET && READ_ONCE(req->expired))
+		result = -ETIMEDOUT;
+	else if (result == -ENOENT)
+		result = -ECANCELED;
+
+	/* a long transfer says nothing about the response time, its timeout does */
+	mutex_lock(&dynamite->lock);
+	if (req->length <= MAX_WRITE_URB_SIZE || result == -ETIMEDOUT)
+		rtt_sample(dynamite, req->endpoint, req->start, result, req->timeout);
+	if (req->endpoint != RTT_CONTROL)
+		recover_endpoint(dynamite, req->urb->pipe, result, req->start, &reset);
+	mutex_unlock(&dynamite->lock);
+
+	/* the ring may be locked for this completion, the reset runs elsewhere */
+	if (reset)
+		recover_schedule(dynamite);
+
+	/* user memory can only be touched from the submitting task */
+	if (result > 0 && req->dir_in && copy_to_user(req->user, req->buffer, result))
+		result = -EFAULT;
+
+	io_uring_cmd_done(ioucmd, result, 0, issue_flags);
+	dynamite_uring_free(req);
+}
+
+static void dynamite_uring_callback(struct urb *urb)
+{
+	struct dynamite_uring_request *req = urb->context;
+
+	if (!req->dir_in)
+		req->dynamite->tx_stamp = ktime_get();
+	req->result = urb->status ? urb->status : urb->actual_length;
+	io_uring_cmd_complete_in_task(req->ioucmd, dynamite_uring_done);
+}
+
+static void dynamite_uring_expire(struct work_struct *work)
+{
+	struct dynamite_uring_request *req = container_of(to_delayed_work(work), struct dynamite_uring_request, expire);
+
+	WRITE_ONCE(req->expired, 1);
+	usb_unlink_urb(req->urb);
+}
+
+/*
+ * io_uring passthrough: every command is turned into an urb and completes
+ * asynchronously, so one thread can keep many transfers in flight without a
+ * syscall per operation. Submitting takes a turn on the dispatcher and the
+ * channel lock like the ioctls do, a send keeps the turn for its reply. The
+ * urb is unlinked after the adaptive timeout and can be cancelled by the
+ * ring, the result feeds the rtt estimate and the recovery ladder. Mode
+ * switches stay with the ioctls, they sleep for seconds and can't be
+ * cancelled.
+ */
+static int dynamite_uring_cmd(struct io_uring_cmd *ioucmd, unsigned int issue_flags)
+{
+	struct dynamite_session *session = ioucmd->file->private_data;
+	struct usb_dynamite *dynamite = session->dynamite;
+	struct dynamite_uring_command ucmd;
+	struct dynamite_uring_request *req;
+	struct mutex *lock;
+	unsigned int pipe;
+	int result;
+
+	if (issue_flags & IO_URING_F_CANCEL) {
+		req = *(struct dynamite_uring_request **)ioucmd->pdu;
+		usb_kill_urb(req->urb);
+		return 0;
+	}
+
+	/* the sqe is shared with user space, take a private copy */
+	memcpy(&ucmd, io_uring_sqe_cmd(ioucmd->sqe), sizeof(ucmd));
+	if (ucmd.length > URING_MAX_LENGTH)
+		return -EINVAL;
+	if (ucmd.flags && (ucmd.flags >= dynamite->channels || (ioucmd->cmd_op != URING_SEND_BULK && ioucmd->cmd_op != URING_RECV_BULK)))
+		return -EINVAL;
+
+	req = kzalloc(sizeof(struct dynamite_uring_request), GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	kref_get(&dynamite->kref);
+	req->dynamite = dynamite;
+	req->ioucmd = ioucmd;
+	req->user = u64_to_user_ptr(ucmd.buffer);
+	req->length = ucmd.length;
+	INIT_DELAYED_WORK(&req->expire, dynamite_uring_expire);
+	*(struct dynamite_uring_request **)ioucmd->pdu = req;
+
+	switch (ioucmd->cmd_op) {
+		case URING_SEND_BULK:
+			req->endpoint = RTT_BULK_OUT;
+			pipe = usb_sndbulkpipe(dynamite->udevice, dynamite->channel[ucmd.flags].bulk_out_endpointAddr);
+			break;
+		case URING_RECV_BULK:
+			req->dir_in = 1;
+			req->endpoint = RTT_BULK_IN;
+			pipe = usb_rcvbulkpipe(dynamite->udevice, dynamite->channel[ucmd.flags].bulk_in_endpointAddr);
+			break;
+		case URING_SEND_VENDOR:
+			req->endpoint = RTT_CONTROL;
+			pipe = usb_sndctrlpipe(dynamite->udevice, 0);
+			break;
+		case URING_RECV_VENDOR:
+			req->dir_in = 1;
+			req->endpoint = RTT_CONTROL;
+			pipe = usb_rcvctrlpipe(dynamite->udevice, 0);
+			break;
+		default:
+			result = -ENOTTY;
+			goto error;
+	}
+
+	if (req->dir_in)
+		req->buffer = kmalloc(req->length, GFP_KERNEL);
+	else
+		req->buffer = memdup_user(req->user, req->length);
+	if (IS_ERR_OR_NULL(req->buffer)) {
+		result = req->buffer ? PTR_ERR(req->buffer) : -ENOMEM;
+		req->buffer = NULL;
+		goto error;
+	}
+
+	req->urb = usb_alloc_urb(0, GFP_KERNEL);
+	if (!req->urb) {
+		result = -ENOMEM;
+		goto error;
+	}
+
+	if (ioucmd->cmd_op == URING_SEND_VENDOR || ioucmd->cmd_op == URING_RECV_VENDOR) {
+		req->setup = kmalloc(sizeof(struct usb_ctrlrequest), GFP_KERNEL);
+		if (!req->setup) {
+			result = -ENOMEM;
+			goto error;
+		}
+		req->setup->bRequestType = (req->dir_in ? USB_DIR_IN : USB_DIR_OUT) | USB_TYPE_VENDOR | USB_RECIP_DEVICE;
+		req->setup->bRequest = ucmd.request;
+		req->setup->wValue = cpu_to_le16(ucmd.address);
+		req->setup->wIndex = 0;
+		req->setup->wLength = cpu_to_le16(req->length);
+		usb_fill_control_urb(req->urb, dynamite->udevice, pipe, (unsigned char *)req->setup, req->buffer, req->length, dynamite_uring_callback, req);
+	} else
+		usb_fill_bulk_urb(req->urb, dynamite->udevice, pipe, req->buffer, req->length, dynamite_uring_callback, req);
+
+	/* a non blocking issue is retried from a worker when it would wait */
+	result = session_begin(session, (req->dir_in ? SESSION_REPLY : 0) | ((issue_flags & IO_URING_F_NONBLOCK) ? SESSION_NOWAIT : 0));
+	if (result) {
+		if (result == -ERESTARTSYS)
+			result = -EINTR;
+		goto error;
+	}
+
+	lock = channel_lock(dynamite, ucmd.flags);
+	if (!(issue_flags & IO_URING_F_NONBLOCK))
+		mutex_lock(lock);
+	else if (!mutex_trylock(lock)) {
+		session_end(session);
+		result = -EAGAIN;
+		goto error;
+	}
+
+	/* from here on the ring may cancel, a failure completes like a transfer */
+	io_uring_cmd_mark_cancelable(ioucmd, issue_flags);
+	req->timeout = rtt_timeout(dynamite, req->endpoint);
+	req->start = ktime_get();
+	schedule_delayed_work(&req->expire, msecs_to_jiffies(req->timeout));
+	usb_anchor_urb(req->urb, &dynamite->submitted);
+	result = usb_submit_urb(req->urb, GFP_KERNEL);
+	if (result)
+		usb_unanchor_urb(req->urb);
+	mutex_unlock(lock);
+
+	if (!result && !req->dir_in)
+		session_hold(session);
+	else
+		session_end(session);
+
+	if (result) {
+		cancel_delayed_work_sync(&req->expire);
+		io_uring_cmd_done(ioucmd, result, 0, issue_flags);
+		dynamite_uring_free(req);
+	}
+
+	return -EIOCBQUEUED;
+
+error:
+	dynamite_uring_free(req);
+	return result;
+}
+#endif
+
 static const struct usb_device_id id_table[] = {
 	{ USB_DEVICE(DYNAMITE_VENDOR_ID, DYNAMITE_PRODUCT_ID) },
 	{ USB_DEVICE(DYNAMITE_PLUS_VENDOR_ID, DYNAMITE_PLUS_PREENUMERATION_PRODUCT_ID) },
@@ -1024,17 +2982,51 @@ static const struct usb_device_id id_table[] = {
 MODULE_DEVICE_TABLE(usb, id_table);
 
 /* usb specific object needed to register this driver with the usb subsystem */
+/* keep transfers off the bus while the device resets, the lock is held until post_reset */
+static int dynamite_pre_reset(struct usb_interface *interface)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(interface);
+
+	mutex_lock(&dynamite->lock);
+	usb_kill_anchored_urbs(&dynamite->submitted);
+	int_stop(dynamite);
+	/* a reset may take the ram firmware with it */
+	dynamite->fw_name = NULL;
+
+	return 0;
+}
+
+static int dynamite_post_reset(struct usb_interface *interface)
+{
+	struct usb_dynamite *dynamite = usb_get_intfdata(interface);
+
+	dynamite->fw_name = NULL;
+	if (dynamite->int_urb) {
+		usb_unpoison_urb(dynamite->int_urb);
+		usb_submit_urb(dynamite->int_urb, GFP_NOIO);
+	}
+	mutex_unlock(&dynamite->lock);
+
+	return 0;
+}
+
 static struct usb_driver dynamite_driver = {
 	.name		= "dynamite",
 	.probe		= dynamite_probe,
 	.disconnect	= dynamite_disconnect,
+	.pre_reset	= dynamite_pre_reset,
+	.post_reset	= dynamite_post_reset,
 	.id_table	= id_table,
 };
 
 static const struct file_operations dynamite_fops = {
 	.unlocked_ioctl	= dynamite_ioctl,
-	.read		= dynamite_read,
-	.write		= dynamite_write,
+	.read_iter	= dynamite_read_iter,
+	.write_iter	= dynamite_write_iter,
+	.splice_write	= iter_file_splice_write,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,7,0)
+	.uring_cmd	= dynamite_uring_cmd,
+#endif
 	.open		= dynamite_open,
 	.release	= dynamite_release,
 };
@@ -1050,7 +3042,8 @@ static int dynamite_probe(struct usb_interface *interface, const struct usb_devi
 	struct usb_endpoint_descriptor *endpoint;
 	size_t buffer_size;
 	struct usb_dynamite *dynamite;
-	int i, result = -ENOMEM;
+	int i, in = 0, out = 0, result = -ENOMEM;
+	s64 boot_duration;
 
 	int init;
 
@@ -1059,6 +3052,25 @@ static int dynamite_probe(struct usb_interface *interface, const struct usb_devi
 		goto error_mem;
 
 	kref_init(&dynamite->kref);
+	mutex_init(&dynamite->lock);
+	sema_init(&dynamite->limit_sem, WRITES_IN_FLIGHT);
+	init_usb_anchor(&dynamite->submitted);
+	spin_lock_init(&dynamite->event_lock);
+	init_waitqueue_head(&dynamite->event_wait);
+	spin_lock_init(&dynamite->dispatch_lock);
+	for (i = 0; i < PRIORITY_CLASSES; i++)
+		INIT_LIST_HEAD(&dynamite->dispatch_queue[i]);
+	init_waitqueue_head(&dynamite->dispatch_wait);
+	INIT_DELAYED_WORK(&dynamite->dispatch_hold, dispatch_hold_expired);
+	INIT_WORK(&dynamite->restore_work, restore_work);
+	INIT_WORK(&dynamite->recover_work, recover_work);
+	INIT_DELAYED_WORK(&dynamite->int_retry, int_retry);
+	dynamite->mode_session.dynamite = dynamite;
+	mutex_init(&dynamite->mode_session.lock);
+	INIT_LIST_HEAD(&dynamite->mode_session.node);
+	dynamite->mode_session.priority = PRIORITY_NORMAL;
+	dynamite->boot_mode = -1;
+	INIT_KFIFO(dynamite->events);
 
 	dynamite->udevice = usb_get_dev(interface_to_usbdev(interface));
 	dynamite->uinterface = interface;
@@ -1074,17 +3086,32 @@ static int dynamite_probe(struct usb_interface *interface, const struct usb_devi
 	}
 
 	/* set up the endpoint information */
-	/* use only the first bulk-in and bulk-out endpoints */
+	/* the first bulk-in and bulk-out endpoints carry commands, every pair is a channel */
 	iface_desc = interface->cur_altsetting;
 	for (i = 0; i < iface_desc->desc.bNumEndpoints; ++i) {
 		endpoint = &iface_desc->endpoint[i].desc;
 
+		if (usb_endpoint_is_bulk_in(endpoint) && in < MAX_CHANNELS) {
+			dynamite->channel[in].bulk_in_endpointAddr = endpoint->bEndpointAddress;
+			dynamite->channel[in++].bulk_in_maxp = bulk_packet_size(dynamite, endpoint);
+		}
+		if (usb_endpoint_is_bulk_out(endpoint) && out < MAX_CHANNELS) {
+			dynamite->channel[out].bulk_out_endpointAddr = endpoint->bEndpointAddress;
+			dynamite->channel[out++].bulk_out_maxp = bulk_packet_size(dynamite, endpoint);
+		}
+		if (usb_endpoint_is_int_in(endpoint) && !dynamite->int_urb) {
+			/* status reports, no need to poll with bulk commands */
+			if (dynamite_int_start(dynamite, endpoint) < 0)
+				dev_warn(&interface->dev, "Could not start the interrupt endpoint, no events\n");
+		}
+
 		if (!dynamite->bulk_in_endpointAddr &&
 		    (endpoint->bEndpointAddress & USB_DIR_IN) &&
 		    ((endpoint->bmAttributes & USB_ENDPOINT_XFERTYPE_MASK)
 					== USB_ENDPOINT_XFER_BULK)) {
 			/* we found a bulk in endpoint */
-			buffer_size = endpoint->wMaxPacketSize;
+			dynamite->bulk_in_maxp = bulk_packet_size(dynamite, endpoint);
+			buffer_size = dynamite->bulk_in_maxp * BULK_IN_PACKETS;
 			dynamite->bulk_in_size = buffer_size;
 			dynamite->bulk_in_endpointAddr = endpoint->bEndpointAddress;
 			dynamite->bulk_in_buffer = kmalloc(buffer_size, GFP_KERNEL);
@@ -1100,9 +3127,17 @@ static int dynamite_probe(struct usb_interface *interface, const struct usb_devi
 					== USB_ENDPOINT_XFER_BULK)) {
 			/* we found a bulk out endpoint */
 			dynamite->bulk_out_endpointAddr = endpoint->bEndpointAddress;
+			dynamite->bulk_out_maxp = bulk_packet_size(dynamite, endpoint);
 		}
 	}
 
+	dynamite->channels = min(in, out);
+	for (i = 0; i < MAX_CHANNELS; i++)
+		mutex_init(&dynamite->channel[i].lock);
+
+	if (dynamite->bulk_in_endpointAddr && dynamite->bulk_out_endpointAddr)
+		dev_info(&interface->dev, "%s %s speed, %d/%d byte bulk packets, %d channels\n", dynamite->device_name, usb_speed_string(dynamite->udevice->speed), dynamite->bulk_in_maxp, dynamite->bulk_out_maxp, dynamite->channels);
+
 	if (!(dynamite->bulk_in_endpointAddr && dynamite->bulk_out_endpointAddr) && (dynamite->status != NOFW)) {
 		dev_err(&interface->dev, "Could not find both bulk-in and bulk-out endpoints\n");
 		goto error;
@@ -1118,12 +3153,30 @@ static int dynamite_probe(struct usb_interface *interface, const struct usb_devi
 #endif
 	usb_set_intfdata(interface, dynamite);
 
-	mutex_init(&dynamite->lock);
-
 	result = device_create_file(&interface->dev, &dev_attr_status);
 	if (result < 0)
 		goto error;
 
+	result = device_create_file(&interface->dev, &dev_attr_restore_mode);
+	if (result < 0)
+		goto error;
+
+	result = device_create_file(&interface->dev, &dev_attr_queue_stats);
+	if (result < 0)
+		goto error;
+
+	result = device_create_file(&interface->dev, &dev_attr_timeouts);
+	if (result < 0)
+		goto error;
+
+	result = device_create_file(&interface->dev, &dev_attr_recovery);
+	if (result < 0)
+		goto error;
+
+	result = device_create_bin_file(&interface->dev, &bin_attr_eeprom);
+	if (result < 0)
+		goto error;
+
 	/* we can register the device now, as it is ready */
 	result = usb_register_dev(interface, &dynamite_class);
 	if (result < 0) {
@@ -1133,9 +3186,19 @@ static int dynamite_probe(struct usb_interface *interface, const struct usb_devi
 
 	if ((dynamite->udevice->descriptor.iManufacturer == NULL) && (dynamite->udevice->descriptor.iProduct == NULL)) {
 		dynamite->status = NOFW;
+		if (dynamite->udevice->descriptor.idProduct == DYNAMITE_PLUS_PREENUMERATION_PRODUCT_ID)
+			boot_begin(dynamite);
 		dynamite_set_init_fw(dynamite);
+		if (dynamite->booting)
+			boot_progress(dynamite);
 	} else {
 		dynamite->status = READY;
+		/* one ready transition for the whole pre/post enumeration cycle */
+		if (dynamite->udevice->descriptor.idProduct == DYNAMITE_PLUS_PRODUCT_ID && boot_finish(dynamite, &boot_duration))
+			mode_notify(dynamite, 0, boot_duration);
+		/* firmware loading sleeps, don't hold up enumeration */
+		if (dynamite->boot_mode >= 0 || restore_lookup(dynamite) >= 0)
+			schedule_work(&dynamite->restore_work);
 		//unsigned char buf[64];
 		//read_eeprom(dynamite, buf, 64, 0);
 	}
@@ -1145,10 +3208,17 @@ static int dynamite_probe(struct usb_interface *interface, const struct usb_devi
 	return 0;
 error:
 	device_remove_file(&interface->dev, &dev_attr_status);
+	device_remove_file(&interface->dev, &dev_attr_restore_mode);
+	device_remove_file(&interface->dev, &dev_attr_queue_stats);
+	device_remove_file(&interface->dev, &dev_attr_timeouts);
+	device_remove_file(&interface->dev, &dev_attr_recovery);
+	device_remove_bin_file(&interface->dev, &bin_attr_eeprom);
 	usb_set_intfdata (interface, NULL);
 
-	if (dynamite)
+	if (dynamite) {
+		int_stop(dynamite);
 		kref_put(&dynamite->kref, dynamite_delete);
+	}
 
 	return result;
 
@@ -1163,9 +3233,23 @@ static void dynamite_disconnect(struct usb_interface *interface)
 
 	usb_deregister_dev(interface, &dynamite->uclass);
 	device_remove_file(&interface->dev, &dev_attr_status);
+	device_remove_file(&interface->dev, &dev_attr_restore_mode);
+	device_remove_file(&interface->dev, &dev_attr_queue_stats);
+	device_remove_file(&interface->dev, &dev_attr_timeouts);
+	device_remove_file(&interface->dev, &dev_attr_recovery);
+	device_remove_bin_file(&interface->dev, &bin_attr_eeprom);
 
 	/* first remove the files, then NULL the pointer */
 	usb_set_intfdata (interface, NULL);
+	cancel_work_sync(&dynamite->restore_work);
+	usb_kill_anchored_urbs(&dynamite->submitted);
+	int_stop(dynamite);
+	/* readers of the event fd get -ENODEV once the queue is drained */
+	spin_lock_irq(&dynamite->event_lock);
+	dynamite->disconnected = 1;
+	spin_unlock_irq(&dynamite->event_lock);
+	cancel_work_sync(&dynamite->recover_work);
+	wake_up_interruptible(&dynamite->event_wait);
 	mutex_destroy(&dynamite->lock);
 	kref_put(&dynamite->kref, dynamite_delete);
 	dev_info(&interface->dev, "%s Reader/Programmer now disconnected\n", dynamite->device_name);
@@ -1176,6 +3260,8 @@ static int __init dynamite_usb_init(void)
 {
 	int result;
 
+	restore_parse();
+
 	/* register this driver with the USB subsystem */
 	result = usb_register(&dynamite_driver);
 
@@ -1197,6 +3283,12 @@ module_exit(dynamite_usb_exit);
 module_param(debug, int, 0660);
 module_param(load_fx1_fw, int, 0660);
 module_param(load_fx2_fw, int, 0660);
+module_param(batch_records, int, 0660);
+module_param(priority_aging, int, 0660);
+module_param(timeout_floor, int, 0660);
+module_param(command_timeout_floor, int, 0660);
+module_param(timeout_ceiling, int, 0660);
+module_param_array(restore, charp, &restore_count, 0444);
 
 MODULE_AUTHOR(DRIVER_AUTHOR);
 MODULE_DESCRIPTION(DRIVER_DESC);
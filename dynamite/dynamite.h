@@ -22,6 +22,8 @@
 
 #include <linux/cdev.h>
 
+#include "dynamite_ioctl.h"
+
 #define internal_dev_info(dev, format, arg ...) pr_info(YELLOW_COLOR "%s %s: " format, dev_driver_string(dev), dev_name(dev) , ##arg)
 #define internal_dev_err(dev, format, arg ...) pr_err(YELLOW_COLOR "%s %s: " format, dev_driver_string(dev), dev_name(dev) , ##arg)
 #define internal_dev_dbg(dev, format, arg ...) pr_debug(YELLOW_COLOR "%s %s: " format, dev_driver_string(dev), dev_name(dev) , ##arg)
@@ -43,6 +45,13 @@
 #define SET_EE_VALUE                      0x10
 #define GET_EE_VALUE                      0x11
 
+/* vend_ax eeprom requests, single and two byte addressed */
+#define EEPROM_SMALL_REQUEST              0xA2
+#define EEPROM_LARGE_REQUEST              0xA9
+
+#define EEPROM_READ_SIZE 1024
+#define EEPROM_PAGE_SIZE 32
+
 #define NO_RESET_CPU 0
 #define RESET_CPU 1
 
@@ -69,8 +78,85 @@ typedef enum {
 	SIMPLE_DEBUG_OUT	= 6,
 } dynamite_debug_t;
 
+typedef enum {
+	RTT_BULK_OUT		= 0,
+	RTT_BULK_IN		= 1,
+	RTT_CONTROL		= 2,
+} dynamite_rtt_endpoint_t;
+
+typedef enum {
+	RECOVER_CLEAR_HALT	= 0,
+	RECOVER_RESET_DEVICE	= 1,
+} dynamite_recover_rung_t;
+
 #define MIN(a,b) (((a) <= (b)) ? (a) : (b))
 #define MAX_PKT_SIZE 64
+#define MAX_HS_PKT_SIZE 512
+#define BULK_IN_PACKETS 16
+#define MAX_WRITE_URB_SIZE (16 * 1024)
+#define WRITES_IN_FLIGHT 8
+#define MAX_SG_PAGES 16
+#define EVENT_QUEUE_SIZE 32
+#define RESTORE_ENTRIES 16
+#define SESSION_HOLD_MS 100
+#define DEVICE_MODES ARRAY_SIZE(dynamite_device_status)
+#define RTT_ENDPOINTS 3
+#define RTT_MIN_SAMPLES 8
+#define RECOVER_RUNGS 2
+#define RECOVER_OUT_TIMEOUTS 3
+#define SG_POLL_MS 100
+#define INT_RETRY_MS 10
+#define INT_RETRIES 6
+#define RESTORE_KEY_SIZE 64
+#define BOOT_ENTRIES 8
+#define BOOT_TIMEOUT_MS 30000
+
+/* one bulk in/out endpoint pair with its own queue */
+struct dynamite_channel {
+	struct mutex lock;		/* serialises transfers on this channel */
+	__u8 bulk_in_endpointAddr;
+	__u8 bulk_out_endpointAddr;
+	int bulk_in_maxp;
+	int bulk_out_maxp;
+};
+
+/* response time estimate of one endpoint in one mode, in us */
+struct dynamite_rtt {
+	u32 srtt;
+	u32 rttvar;
+	u32 samples;
+};
+
+/* which rung of the recovery ladder brought the device back, and how fast */
+struct dynamite_recovery {
+	u32 count[RECOVER_RUNGS];
+	u32 failed;
+	u64 time_ns;		/* from the first failed transfer to the recovery */
+};
+
+/* how long the transactions of one priority class waited for their turn */
+struct dynamite_queue_stats {
+	u64 transactions;
+	u64 wait_ns;
+	u64 max_wait_ns;
+};
+
+struct usb_dynamite;
+
+/*
+ * Every open of the device node is a session. Sessions take turns on the
+ * device one transaction at a time, a write and the read of its reply
+ * count as one transaction.
+ */
+struct dynamite_session {
+	struct usb_dynamite *dynamite;
+	struct mutex lock;		/* one transaction of this session at a time */
+	struct list_head node;		/* on dispatch_queue while waiting */
+	int exclusive;
+	int priority;			/* PRIORITY_* */
+	ktime_t queued;			/* when the waiting transaction was queued */
+	int read_mode;			/* framing of reads through this file */
+};
 
 /* structure to hold all of our device specific stuff */
 struct usb_dynamite {
@@ -85,18 +171,128 @@ struct usb_dynamite {
 	int status;
 	struct mutex lock;
 	int state;
+	ktime_t tx_stamp;		/* completion time of the last bulk out transfer */
+	const char *fw_name;		/* the firmware image running on the device */
+	u32 fw_hash;			/* crc32 of the running firmware image */
+	struct dynamite_rtt rtt[DEVICE_MODES][RTT_ENDPOINTS];	/* updated under lock */
+	struct dynamite_recovery recovery;	/* updated under lock */
+	int recover_rung;		/* next rung to try, RECOVER_RUNGS while the device resets */
+	ktime_t recover_start;
+	int out_timeouts;		/* bulk out timeouts in a row */
 	unsigned char *bulk_in_buffer;		/* the buffer to receive data */
 	size_t bulk_in_size;		/* the size of the receive buffer */
+	int bulk_in_maxp;		/* max packet size of the bulk in endpoint */
+	int bulk_out_maxp;		/* max packet size of the bulk out endpoint */
 	__u8 bulk_in_endpointAddr;	/* the address of the bulk in endpoint */
 	__u8 bulk_out_endpointAddr;	/* the address of the bulk out endpoint */
+	struct dynamite_channel channel[MAX_CHANNELS];
+	int channels;			/* number of bulk endpoint pairs */
+	spinlock_t dispatch_lock;
+	struct list_head dispatch_queue[PRIORITY_CLASSES];	/* sessions waiting for their turn, oldest first */
+	struct dynamite_session *dispatch_owner;	/* session whose transaction runs */
+	int dispatch_held;		/* the owner wrote a request and its reply is still to be read */
+	wait_queue_head_t dispatch_wait;
+	struct delayed_work dispatch_hold;	/* ends a held turn whose reply never gets read */
+	struct dynamite_queue_stats queue_stats[PRIORITY_CLASSES];
+	int sessions;			/* open device nodes */
+	int exclusive;			/* one of them was opened with O_EXCL */
+	struct work_struct restore_work;	/* brings the device back into its saved mode */
+	struct work_struct recover_work;	/* resets the device for transfers that completed asynchronously */
+	struct dynamite_session mode_session;	/* mode switches from sysfs and restore_work */
+	int booting;			/* pre-enumeration device, about to re-enumerate */
+	int boot_mode;			/* mode requested before the re-enumeration, or -1 */
+	struct urb *int_urb;		/* the urb polling the interrupt in endpoint */
+	unsigned char *int_buffer;
+	unsigned char int_last[EVENT_DATA_SIZE];	/* last report, repeats are coalesced */
+	int int_last_length;
+	int int_errors;			/* persistent errors in a row, the retry backs off with them */
+	int int_status;			/* the error the retry starts over from */
+	struct delayed_work int_retry;	/* restarts the interrupt urb after an error */
+	spinlock_t event_lock;
+	wait_queue_head_t event_wait;
+	DECLARE_KFIFO(events, struct dynamite_event, EVENT_QUEUE_SIZE);
+	u32 events_lost;		/* dropped since the last read, under event_lock */
+	int disconnected;		/* no more events will come */
+	struct semaphore limit_sem;	/* limiting the number of writes in progress */
+	struct usb_anchor submitted;	/* in case we need to retract our submissions */
 	struct kref kref;
 };
 
-struct dynamite_hex_record {
-	__u8 data_size;
-	__u8 data[64];
+/* one aggregated exchange of command records */
+struct dynamite_batch {
+	struct completion done;
+	atomic_t pending;
+	int status;
+};
+
+/* a scatter-gather request that is given up when it stalls or a signal comes */
+struct dynamite_sg_wait {
+	struct usb_sg_request io;
+	struct delayed_work poll;
+	struct task_struct *task;
+	unsigned long timeout;		/* jiffies without progress before the request is cancelled */
+	unsigned long deadline;
+	size_t bytes;			/* progress seen by the last poll */
+	int status;			/* why the request was cancelled */
+};
+
+/* a single bulk in transfer that records when it completed */
+struct dynamite_stamp {
+	struct completion done;
+	ktime_t time;
+};
+
+/* the mode a device should be brought into when it shows up */
+struct dynamite_restore {
+	char key[RESTORE_KEY_SIZE];	/* serial number or usb port path */
+	int mode;
+};
+
+/* a Dynamite Plus between its pre-enumeration and post-enumeration probe */
+struct dynamite_boot {
+	char path[RESTORE_KEY_SIZE];	/* usb port path, the same for both enumerations */
+	ktime_t start;			/* when the pre-enumeration device showed up */
+	int state;			/* firmware load progress */
+	int mode;			/* mode requested while booting, or -1 */
 };
 
+typedef enum {
+	SESSION_NOWAIT = 0x01,	/* fail with -EAGAIN rather than wait for the turn */
+	SESSION_REPLY = 0x02,	/* continues a held turn of the same session */
+} dynamite_session_flags_t;
+
+struct io_uring_cmd;
+
+/* one asynchronous io_uring passthrough command */
+struct dynamite_uring_request {
+	struct usb_dynamite *dynamite;
+	struct io_uring_cmd *ioucmd;
+	struct urb *urb;
+	struct usb_ctrlrequest *setup;
+	struct delayed_work expire;	/* unlinks the urb once the timeout passed */
+	unsigned char *buffer;
+	void __user *user;
+	ktime_t start;
+	int length;
+	int dir_in;
+	int endpoint;			/* rtt estimate the transfer is timed by */
+	int timeout;
+	int expired;
+	int result;
+};
+
+/*
+ * command tables are packed as a length byte followed by that many data
+ * bytes, the length is counted by the compiler and a zero ends the table
+ */
+#define DYNAMITE_RECORD(...) sizeof((__u8[]){ __VA_ARGS__ }), __VA_ARGS__
+#define DYNAMITE_RECORD_END 0
+
+static inline const __u8 *dynamite_record_next(const __u8 *record)
+{
+	return record + record[0] + 1;
+}
+
 #define NORMAL_COLOR  "\x1B[0m"
 #define RED_COLOR  "\x1B[31m"
 #define GREEN_COLOR  "\x1B[32m"
@@ -20,143 +20,143 @@
 #ifndef _DYNAMITE_INIT_H
 #define _DYNAMITE_INIT_H
 
-static const struct dynamite_hex_record dynamite_init_code[] = {
-{ 8, {0x01, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00} },
-{ 8, {0x01, 0x08, 0x08, 0x10, 0x10, 0x01, 0x00, 0x00} },
-{ 8, {0x01, 0x10, 0x08, 0x03, 0x44, 0xF6, 0xB3, 0x71} },
-{ 8, {0x01, 0x18, 0x08, 0x78, 0xB7, 0xA3, 0x19, 0x7B} },
-{ 8, {0x01, 0x20, 0x08, 0x04, 0xFC, 0x9D, 0x4A, 0x07} },
-{ 8, {0x01, 0x28, 0x08, 0x6B, 0x42, 0xDC, 0xE1, 0xC6} },
-{ 8, {0x01, 0x30, 0x08, 0x69, 0xD8, 0xEB, 0xBC, 0x9C} },
-{ 8, {0x01, 0x38, 0x08, 0x2A, 0xB6, 0x69, 0x7E, 0x21} },
-{ 8, {0x01, 0x40, 0x08, 0xD3, 0xF4, 0x89, 0x0E, 0x20} },
-{ 8, {0x01, 0x48, 0x08, 0x6C, 0xEC, 0x07, 0xFC, 0xB7} },
-{ 8, {0x01, 0x50, 0x08, 0x23, 0xAD, 0x60, 0x86, 0xC5} },
-{ 8, {0x01, 0x58, 0x08, 0x54, 0x8F, 0xE1, 0x0F, 0x86} },
-{ 8, {0x01, 0x60, 0x08, 0x7B, 0xA0, 0x99, 0xA8, 0xFB} },
-{ 8, {0x01, 0x68, 0x08, 0xFF, 0x2D, 0x1E, 0x0B, 0x74} },
-{ 8, {0x01, 0x70, 0x08, 0x3B, 0xA9, 0x9D, 0x38, 0x74} },
-{ 8, {0x01, 0x78, 0x08, 0xFC, 0x37, 0x53, 0xF1, 0x34} },
-{ 8, {0x01, 0x80, 0x08, 0x05, 0x40, 0x15, 0x74, 0x21} },
-{ 8, {0x01, 0x88, 0x08, 0xAB, 0x99, 0x01, 0x8A, 0x4F} },
-{ 8, {0x01, 0x90, 0x08, 0xB8, 0x40, 0xE9, 0x74, 0x32} },
-{ 8, {0x01, 0x98, 0x08, 0x2C, 0x6E, 0x07, 0x4F, 0xB3} },
-{ 8, {0x01, 0xA0, 0x08, 0x78, 0xB3, 0x44, 0xF8, 0x18} },
-{ 8, {0x01, 0xA8, 0x08, 0xA1, 0xF1, 0xD8, 0xD0, 0x52} },
-{ 8, {0x01, 0xB0, 0x08, 0xA3, 0xBB, 0x8E, 0xF7, 0x85} },
-{ 8, {0x01, 0xB8, 0x08, 0xEB, 0x45, 0x44, 0x4F, 0x89} },
-{ 8, {0x01, 0xC0, 0x08, 0xDC, 0xEB, 0x6F, 0xFE, 0x6A} },
-{ 8, {0x01, 0xC8, 0x08, 0x4B, 0xA8, 0x95, 0xF0, 0xE8} },
-{ 8, {0x01, 0xD0, 0x08, 0x03, 0xA0, 0xD2, 0x53, 0xF8} },
-{ 8, {0x01, 0xD8, 0x08, 0x42, 0x96, 0x54, 0x19, 0x40} },
-{ 8, {0x01, 0xE0, 0x08, 0x39, 0x76, 0xDE, 0x7A, 0x9E} },
-{ 8, {0x01, 0xE8, 0x08, 0x90, 0xCD, 0x49, 0x6F, 0xA2} },
-{ 8, {0x01, 0xF0, 0x08, 0xE0, 0x4C, 0xFE, 0x38, 0x10} },
-{ 8, {0x01, 0xF8, 0x08, 0x37, 0x4A, 0x7D, 0xD6, 0x60} },
-{ 8, {0x01, 0x00, 0x08, 0x98, 0x3E, 0xD9, 0x92, 0x9A} },
-{ 8, {0x01, 0x08, 0x08, 0x10, 0x10, 0x01, 0x00, 0x00} },
-{ 8, {0x01, 0x10, 0x08, 0x03, 0x44, 0xF6, 0xB3, 0x71} },
-{ 8, {0x01, 0x18, 0x08, 0x78, 0xB7, 0xA3, 0x19, 0x7B} },
-{ 8, {0x01, 0x20, 0x08, 0x04, 0xFC, 0x9D, 0x4A, 0x07} },
-{ 8, {0x01, 0x28, 0x08, 0x6B, 0x42, 0xDC, 0xE1, 0xC6} },
-{ 8, {0x01, 0x30, 0x08, 0x69, 0xD8, 0xEB, 0xBC, 0x9C} },
-{ 8, {0x01, 0x38, 0x08, 0x2A, 0xB6, 0x69, 0x7E, 0x21} },
-{ 8, {0x01, 0x40, 0x08, 0xD3, 0xF4, 0x89, 0x0E, 0x20} },
-{ 8, {0x01, 0x48, 0x08, 0x6C, 0xEC, 0x07, 0xFC, 0xB7} },
-{ 8, {0x01, 0x50, 0x08, 0x23, 0xAD, 0x60, 0x86, 0xC5} },
-{ 8, {0x01, 0x58, 0x08, 0x54, 0x8F, 0xE1, 0x0F, 0x86} },
-{ 8, {0x01, 0x60, 0x08, 0x7B, 0xA0, 0x99, 0xA8, 0xFB} },
-{ 8, {0x01, 0x68, 0x08, 0xFF, 0x2D, 0x1E, 0x0B, 0x74} },
-{ 8, {0x01, 0x70, 0x08, 0x3B, 0xA9, 0x9D, 0x38, 0x74} },
-{ 8, {0x01, 0x78, 0x08, 0xFC, 0x37, 0x53, 0xF1, 0x34} },
-{ 8, {0x01, 0x80, 0x08, 0x05, 0x40, 0x15, 0x74, 0x21} },
-{ 8, {0x01, 0x88, 0x08, 0xAB, 0x99, 0x01, 0x8A, 0x4F} },
-{ 8, {0x01, 0x90, 0x08, 0xB8, 0x40, 0xE9, 0x74, 0x32} },
-{ 8, {0x01, 0x98, 0x08, 0x2C, 0x6E, 0x07, 0x4F, 0xB3} },
-{ 8, {0x01, 0xA0, 0x08, 0x78, 0xB3, 0x44, 0xF8, 0x18} },
-{ 8, {0x01, 0xA8, 0x08, 0xA1, 0xF1, 0xD8, 0xD0, 0x52} },
-{ 8, {0x01, 0xB0, 0x08, 0xA3, 0xBB, 0x8E, 0xF7, 0x85} },
-{ 8, {0x01, 0xB8, 0x08, 0xEB, 0x45, 0x44, 0x4F, 0x89} },
-{ 8, {0x01, 0xC0, 0x08, 0xDC, 0xEB, 0x6F, 0xFE, 0x6A} },
-{ 8, {0x01, 0xC8, 0x08, 0x4B, 0xA8, 0x95, 0xF0, 0xE8} },
-{ 8, {0x01, 0xD0, 0x08, 0x03, 0xA0, 0xD2, 0x53, 0xF8} },
-{ 8, {0x01, 0xD8, 0x08, 0x42, 0x96, 0x54, 0x19, 0x40} },
-{ 8, {0x01, 0xE0, 0x08, 0x39, 0x76, 0xDE, 0x7A, 0x9E} },
-{ 8, {0x01, 0xE8, 0x08, 0x90, 0xCD, 0x49, 0x6F, 0xA2} },
-{ 8, {0x01, 0xF0, 0x08, 0xE0, 0x4C, 0xFE, 0x38, 0x10} },
-{ 8, {0x01, 0xF8, 0x08, 0x37, 0x4A, 0x7D, 0xD6, 0x60} },
-{ 32, {0x57, 0xD0, 0x2E, 0x01, 0x00, 0x04, 0x00, 0x3F, 0x04, 0x5A, 0x02, 0x00, 0x00, 0x64, 0x06, 0x08,
-       0x88, 0x80, 0xE9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xB0, 0x4E, 0x93, 0x4F, 0x15, 0x90, 0xC1} },
+static const __u8 dynamite_init_code[] = {
+DYNAMITE_RECORD(0x01, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00),
+DYNAMITE_RECORD(0x01, 0x08, 0x08, 0x10, 0x10, 0x01, 0x00, 0x00),
+DYNAMITE_RECORD(0x01, 0x10, 0x08, 0x03, 0x44, 0xF6, 0xB3, 0x71),
+DYNAMITE_RECORD(0x01, 0x18, 0x08, 0x78, 0xB7, 0xA3, 0x19, 0x7B),
+DYNAMITE_RECORD(0x01, 0x20, 0x08, 0x04, 0xFC, 0x9D, 0x4A, 0x07),
+DYNAMITE_RECORD(0x01, 0x28, 0x08, 0x6B, 0x42, 0xDC, 0xE1, 0xC6),
+DYNAMITE_RECORD(0x01, 0x30, 0x08, 0x69, 0xD8, 0xEB, 0xBC, 0x9C),
+DYNAMITE_RECORD(0x01, 0x38, 0x08, 0x2A, 0xB6, 0x69, 0x7E, 0x21),
+DYNAMITE_RECORD(0x01, 0x40, 0x08, 0xD3, 0xF4, 0x89, 0x0E, 0x20),
+DYNAMITE_RECORD(0x01, 0x48, 0x08, 0x6C, 0xEC, 0x07, 0xFC, 0xB7),
+DYNAMITE_RECORD(0x01, 0x50, 0x08, 0x23, 0xAD, 0x60, 0x86, 0xC5),
+DYNAMITE_RECORD(0x01, 0x58, 0x08, 0x54, 0x8F, 0xE1, 0x0F, 0x86),
+DYNAMITE_RECORD(0x01, 0x60, 0x08, 0x7B, 0xA0, 0x99, 0xA8, 0xFB),
+DYNAMITE_RECORD(0x01, 0x68, 0x08, 0xFF, 0x2D, 0x1E, 0x0B, 0x74),
+DYNAMITE_RECORD(0x01, 0x70, 0x08, 0x3B, 0xA9, 0x9D, 0x38, 0x74),
+DYNAMITE_RECORD(0x01, 0x78, 0x08, 0xFC, 0x37, 0x53, 0xF1, 0x34),
+DYNAMITE_RECORD(0x01, 0x80, 0x08, 0x05, 0x40, 0x15, 0x74, 0x21),
+DYNAMITE_RECORD(0x01, 0x88, 0x08, 0xAB, 0x99, 0x01, 0x8A, 0x4F),
+DYNAMITE_RECORD(0x01, 0x90, 0x08, 0xB8, 0x40, 0xE9, 0x74, 0x32),
+DYNAMITE_RECORD(0x01, 0x98, 0x08, 0x2C, 0x6E, 0x07, 0x4F, 0xB3),
+DYNAMITE_RECORD(0x01, 0xA0, 0x08, 0x78, 0xB3, 0x44, 0xF8, 0x18),
+DYNAMITE_RECORD(0x01, 0xA8, 0x08, 0xA1, 0xF1, 0xD8, 0xD0, 0x52),
+DYNAMITE_RECORD(0x01, 0xB0, 0x08, 0xA3, 0xBB, 0x8E, 0xF7, 0x85),
+DYNAMITE_RECORD(0x01, 0xB8, 0x08, 0xEB, 0x45, 0x44, 0x4F, 0x89),
+DYNAMITE_RECORD(0x01, 0xC0, 0x08, 0xDC, 0xEB, 0x6F, 0xFE, 0x6A),
+DYNAMITE_RECORD(0x01, 0xC8, 0x08, 0x4B, 0xA8, 0x95, 0xF0, 0xE8),
+DYNAMITE_RECORD(0x01, 0xD0, 0x08, 0x03, 0xA0, 0xD2, 0x53, 0xF8),
+DYNAMITE_RECORD(0x01, 0xD8, 0x08, 0x42, 0x96, 0x54, 0x19, 0x40),
+DYNAMITE_RECORD(0x01, 0xE0, 0x08, 0x39, 0x76, 0xDE, 0x7A, 0x9E),
+DYNAMITE_RECORD(0x01, 0xE8, 0x08, 0x90, 0xCD, 0x49, 0x6F, 0xA2),
+DYNAMITE_RECORD(0x01, 0xF0, 0x08, 0xE0, 0x4C, 0xFE, 0x38, 0x10),
+DYNAMITE_RECORD(0x01, 0xF8, 0x08, 0x37, 0x4A, 0x7D, 0xD6, 0x60),
+DYNAMITE_RECORD(0x01, 0x00, 0x08, 0x98, 0x3E, 0xD9, 0x92, 0x9A),
+DYNAMITE_RECORD(0x01, 0x08, 0x08, 0x10, 0x10, 0x01, 0x00, 0x00),
+DYNAMITE_RECORD(0x01, 0x10, 0x08, 0x03, 0x44, 0xF6, 0xB3, 0x71),
+DYNAMITE_RECORD(0x01, 0x18, 0x08, 0x78, 0xB7, 0xA3, 0x19, 0x7B),
+DYNAMITE_RECORD(0x01, 0x20, 0x08, 0x04, 0xFC, 0x9D, 0x4A, 0x07),
+DYNAMITE_RECORD(0x01, 0x28, 0x08, 0x6B, 0x42, 0xDC, 0xE1, 0xC6),
+DYNAMITE_RECORD(0x01, 0x30, 0x08, 0x69, 0xD8, 0xEB, 0xBC, 0x9C),
+DYNAMITE_RECORD(0x01, 0x38, 0x08, 0x2A, 0xB6, 0x69, 0x7E, 0x21),
+DYNAMITE_RECORD(0x01, 0x40, 0x08, 0xD3, 0xF4, 0x89, 0x0E, 0x20),
+DYNAMITE_RECORD(0x01, 0x48, 0x08, 0x6C, 0xEC, 0x07, 0xFC, 0xB7),
+DYNAMITE_RECORD(0x01, 0x50, 0x08, 0x23, 0xAD, 0x60, 0x86, 0xC5),
+DYNAMITE_RECORD(0x01, 0x58, 0x08, 0x54, 0x8F, 0xE1, 0x0F, 0x86),
+DYNAMITE_RECORD(0x01, 0x60, 0x08, 0x7B, 0xA0, 0x99, 0xA8, 0xFB),
+DYNAMITE_RECORD(0x01, 0x68, 0x08, 0xFF, 0x2D, 0x1E, 0x0B, 0x74),
+DYNAMITE_RECORD(0x01, 0x70, 0x08, 0x3B, 0xA9, 0x9D, 0x38, 0x74),
+DYNAMITE_RECORD(0x01, 0x78, 0x08, 0xFC, 0x37, 0x53, 0xF1, 0x34),
+DYNAMITE_RECORD(0x01, 0x80, 0x08, 0x05, 0x40, 0x15, 0x74, 0x21),
+DYNAMITE_RECORD(0x01, 0x88, 0x08, 0xAB, 0x99, 0x01, 0x8A, 0x4F),
+DYNAMITE_RECORD(0x01, 0x90, 0x08, 0xB8, 0x40, 0xE9, 0x74, 0x32),
+DYNAMITE_RECORD(0x01, 0x98, 0x08, 0x2C, 0x6E, 0x07, 0x4F, 0xB3),
+DYNAMITE_RECORD(0x01, 0xA0, 0x08, 0x78, 0xB3, 0x44, 0xF8, 0x18),
+DYNAMITE_RECORD(0x01, 0xA8, 0x08, 0xA1, 0xF1, 0xD8, 0xD0, 0x52),
+DYNAMITE_RECORD(0x01, 0xB0, 0x08, 0xA3, 0xBB, 0x8E, 0xF7, 0x85),
+DYNAMITE_RECORD(0x01, 0xB8, 0x08, 0xEB, 0x45, 0x44, 0x4F, 0x89),
+DYNAMITE_RECORD(0x01, 0xC0, 0x08, 0xDC, 0xEB, 0x6F, 0xFE, 0x6A),
+DYNAMITE_RECORD(0x01, 0xC8, 0x08, 0x4B, 0xA8, 0x95, 0xF0, 0xE8),
+DYNAMITE_RECORD(0x01, 0xD0, 0x08, 0x03, 0xA0, 0xD2, 0x53, 0xF8),
+DYNAMITE_RECORD(0x01, 0xD8, 0x08, 0x42, 0x96, 0x54, 0x19, 0x40),
+DYNAMITE_RECORD(0x01, 0xE0, 0x08, 0x39, 0x76, 0xDE, 0x7A, 0x9E),
+DYNAMITE_RECORD(0x01, 0xE8, 0x08, 0x90, 0xCD, 0x49, 0x6F, 0xA2),
+DYNAMITE_RECORD(0x01, 0xF0, 0x08, 0xE0, 0x4C, 0xFE, 0x38, 0x10),
+DYNAMITE_RECORD(0x01, 0xF8, 0x08, 0x37, 0x4A, 0x7D, 0xD6, 0x60),
+DYNAMITE_RECORD(0x57, 0xD0, 0x2E, 0x01, 0x00, 0x04, 0x00, 0x3F, 0x04, 0x5A, 0x02, 0x00, 0x00, 0x64, 0x06, 0x08,
+                0x88, 0x80, 0xE9, 0x20, 0x00, 0x00, 0x00, 0x19, 0x78, 0xB0, 0x4E, 0x93, 0x4F, 0x15, 0x90, 0xC1),
 //       0x79, 0x5B, 0xDF, 0x6E, 0xAB, 0x07, 0x81, 0x3B, 0x16, 0x70, 0xE6, 0x71, 0x73, 0x0E, 0x11, 0xB4,
 //       0x80, 0xAA, 0x2E, 0x0A, 0xDB, 0xBF, 0x97, 0x6F, 0x61, 0x2C, 0x42, 0x21, 0xDE, 0x9F, 0x2A, 0x00 } },
-{ 2, {0x62, 0xfb} },
-{ 2, {0x61, 0x04} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x1c} },
-{ 2, {0x63, 0x9c} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x18} },
-{ 2, {0x63, 0x98} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x28} },
-{ 2, {0x63, 0xa8} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x68} },
-{ 2, {0x63, 0x68} },
-{ 2, {0x63, 0xe8} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x32} },
-{ 2, {0x63, 0xb2} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x69} },
-{ 2, {0x63, 0xe9} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x75} },
-{ 2, {0x63, 0xf5} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x6a} },
-{ 2, {0x63, 0xea} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x32} },
-{ 2, {0x63, 0xb2} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x16} },
-{ 2, {0x63, 0x96} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x28} },
-{ 2, {0x63, 0xa8} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x66} },
-{ 2, {0x63, 0xe6} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x3e} },
-{ 2, {0x63, 0xbe} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x80} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x42} },
-{ 2, {0x63, 0xc2} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x5f} },
-{ 2, {0x63, 0xdf} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x1b} },
-{ 2, {0x63, 0x9b} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x02} },
-{ 2, {0x63, 0x82} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x63, 0x1c} },
-{ 2, {0x63, 0x9c} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x64, 0xdf} },
-{ 2, {0x63, 0xff} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x64, 0xdf} },
-{ 2, {0x63, 0xff} },
-{ 2, {0x63, 0x00} },
-{ 2, {0x62, 0xfb} },
-{ 0, {} },
+DYNAMITE_RECORD(0x62, 0xfb),
+DYNAMITE_RECORD(0x61, 0x04),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x1c),
+DYNAMITE_RECORD(0x63, 0x9c),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x18),
+DYNAMITE_RECORD(0x63, 0x98),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x28),
+DYNAMITE_RECORD(0x63, 0xa8),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x68),
+DYNAMITE_RECORD(0x63, 0x68),
+DYNAMITE_RECORD(0x63, 0xe8),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x32),
+DYNAMITE_RECORD(0x63, 0xb2),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x69),
+DYNAMITE_RECORD(0x63, 0xe9),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x75),
+DYNAMITE_RECORD(0x63, 0xf5),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x6a),
+DYNAMITE_RECORD(0x63, 0xea),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x32),
+DYNAMITE_RECORD(0x63, 0xb2),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x16),
+DYNAMITE_RECORD(0x63, 0x96),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x28),
+DYNAMITE_RECORD(0x63, 0xa8),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x66),
+DYNAMITE_RECORD(0x63, 0xe6),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x3e),
+DYNAMITE_RECORD(0x63, 0xbe),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x80),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x42),
+DYNAMITE_RECORD(0x63, 0xc2),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x5f),
+DYNAMITE_RECORD(0x63, 0xdf),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x1b),
+DYNAMITE_RECORD(0x63, 0x9b),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x02),
+DYNAMITE_RECORD(0x63, 0x82),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x63, 0x1c),
+DYNAMITE_RECORD(0x63, 0x9c),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x64, 0xdf),
+DYNAMITE_RECORD(0x63, 0xff),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x64, 0xdf),
+DYNAMITE_RECORD(0x63, 0xff),
+DYNAMITE_RECORD(0x63, 0x00),
+DYNAMITE_RECORD(0x62, 0xfb),
+DYNAMITE_RECORD_END
 };
 
 #endif
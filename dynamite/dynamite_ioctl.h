@@ -21,6 +21,7 @@
 #define _DYNAMITE_IOCTL_H
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 typedef enum {
 	NOFW		= 0,
@@ -90,6 +91,116 @@ struct dynamite_device_information_command {
 	int pid;
 };
 
+#define EEPROM_SMALL_SIZE 256
+#define EEPROM_LARGE_SIZE 8192
+
+struct dynamite_eeprom_command {
+	int offset;
+	int length;
+	void *buffer;
+};
+
+#define BULK_V2_MAX_LENGTH (64 * 1024 * 1024)
+#define BULK_V2_CHANNEL_MASK 0xff
+#define VENDOR_V2_MAX_LENGTH 65535
+
+#define MAX_CHANNELS 4
+
+/* bulk endpoint pairs found on the interface, channel 0 is the command channel */
+struct dynamite_channel_information_command {
+	__u32 channels;
+	__u8 in_endpoint[MAX_CHANNELS];
+	__u8 out_endpoint[MAX_CHANNELS];
+	__u16 in_maxp[MAX_CHANNELS];
+	__u16 out_maxp[MAX_CHANNELS];
+};
+
+#define EVENT_DATA_SIZE 16
+
+typedef enum {
+	EVENT_STATUS = 1,	/* the interrupt endpoint reported new status data */
+	EVENT_RESET = 2,	/* firmware was loaded and the cpu restarted */
+	EVENT_ERROR = 3,	/* the interrupt endpoint failed */
+	EVENT_OVERFLOW = 4,	/* the oldest events were dropped, the queue was full */
+} dynamite_event_type_t;
+
+/* one record read from the event fd */
+struct dynamite_event {
+	__s64 time_ns;		/* CLOCK_MONOTONIC */
+	__u32 type;
+	__s32 status;		/* urb status for EVENT_ERROR, events dropped for EVENT_OVERFLOW */
+	__u32 length;		/* valid bytes in data */
+	__u8 data[EVENT_DATA_SIZE];
+};
+
+/* prefix of every transfer returned in READ_MODE_TIMESTAMP, times are CLOCK_MONOTONIC */
+struct dynamite_read_header {
+	__s64 rx_ns;		/* completion of this bulk in transfer */
+	__s64 tx_ns;		/* completion of the last bulk out transfer */
+	__s32 status;		/* 0 or a negative errno */
+	__u32 length;		/* payload bytes following the header */
+};
+
+/* fixed width layout, identical for 32 and 64 bit user space */
+struct dynamite_bulk_command_v2 {
+	__u64 buffer;
+	__u32 length;		/* in: requested, out: transferred */
+	__u32 flags;		/* channel index, other bits must be zero */
+};
+
+#define PRIORITY_CLASSES 3
+
+/* the class an open device node queues its transactions in */
+typedef enum {
+	PRIORITY_HIGH = 0,	/* ecm and other latency critical requests */
+	PRIORITY_NORMAL = 1,
+	PRIORITY_LOW = 2,	/* emm updates, diagnostics */
+} dynamite_priority_t;
+
+/* a bulk request and the read of its reply, with no other session in between */
+struct dynamite_transfer_command {
+	__u64 request;
+	__u64 reply;
+	__u32 request_length;
+	__u32 reply_length;	/* in: size of the reply buffer, out: bytes received */
+	__u32 flags;		/* channel index, other bits must be zero */
+	__u32 reserved;		/* must be zero */
+};
+
+struct dynamite_vendor_command_v2 {
+	__u64 buffer;
+	__u32 length;		/* in: requested, out: transferred */
+	__u16 request;
+	__u16 address;
+	__u16 index;
+	__u16 flags;		/* must be zero */
+};
+
+#define URING_MAX_LENGTH (256 * 1024)
+
+/* command area of an io_uring passthrough sqe, fits the 16 byte sqe->cmd */
+struct dynamite_uring_command {
+	__u64 buffer;
+	__u32 length;
+	__u8 request;		/* vendor request */
+	__u8 flags;		/* channel index for bulk commands, otherwise zero */
+	__u16 address;		/* vendor address */
+};
+
+/* sqe->cmd_op values */
+typedef enum {
+	URING_SEND_BULK = 0x01,
+	URING_RECV_BULK = 0x02,
+	URING_SEND_VENDOR = 0x03,
+	URING_RECV_VENDOR = 0x04,
+} dynamite_uring_op_t;
+
+typedef enum {
+	READ_MODE_FRAMED = 0,	/* a read ends at a short packet or zlp */
+	READ_MODE_STREAM = 1,	/* a read waits until the buffer is full */
+	READ_MODE_TIMESTAMP = 2,	/* like framed, every transfer prefixed by a read header */
+} dynamite_read_mode_t;
+
 typedef enum {
 	IOCTL_SET_PHOENIX_357 = 0x000000c1,
 	IOCTL_SET_PHOENIX_368 = 0x000000c2,
@@ -105,6 +216,17 @@ typedef enum {
 	IOCTL_SEND_VENDOR_COMMAND = 0x00000c13,
 	IOCTL_RECV_VENDOR_COMMAND = 0x00000c14,
 	IOCTL_DEVICE_INFORMATION_COMMAND = 0x00000c15,
+	IOCTL_READ_EEPROM_COMMAND = 0x00000c16,
+	IOCTL_WRITE_EEPROM_COMMAND = 0x00000c17,
+	IOCTL_SET_READ_MODE = 0x00000c18,
+	IOCTL_SEND_BULK_COMMAND_V2 = 0x00000c19,
+	IOCTL_RECV_BULK_COMMAND_V2 = 0x00000c20,
+	IOCTL_SEND_VENDOR_COMMAND_V2 = 0x00000c21,
+	IOCTL_RECV_VENDOR_COMMAND_V2 = 0x00000c22,
+	IOCTL_CHANNEL_INFORMATION_COMMAND = 0x00000c23,
+	IOCTL_GET_EVENT_FD = 0x00000c24,
+	IOCTL_TRANSFER_COMMAND = 0x00000c26,
+	IOCTL_SET_PRIORITY = 0x00000c27,
 } _dynamite_ioctl_command_t;
 
 #define IOCTL_DIR_OUT 0x0
@@ -20,73 +20,73 @@
 #ifndef _DYNAMITEPLUS_INIT_H
 #define _DYNAMITEPLUS_INIT_H
 
-static const struct dynamite_hex_record dynamiteplus_init_code[] = {
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 3, {0x01, 0x00, 0x00} },
-{ 3, {0x01, 0x00, 0x08} },
-{ 3, {0x01, 0x00, 0x10} },
-{ 3, {0x01, 0x00, 0x18} },
-{ 3, {0x01, 0x00, 0x20} },
-{ 3, {0x01, 0x00, 0x28} },
-{ 3, {0x01, 0x00, 0x30} },
-{ 3, {0x01, 0x00, 0x38} },
-{ 3, {0x01, 0x00, 0x40} },
-{ 3, {0x01, 0x00, 0x48} },
-{ 3, {0x01, 0x00, 0x50} },
-{ 3, {0x01, 0x00, 0x58} },
-{ 3, {0x01, 0x00, 0x60} },
-{ 3, {0x01, 0x00, 0x68} },
-{ 3, {0x01, 0x00, 0x70} },
-{ 3, {0x01, 0x00, 0x78} },
-{ 3, {0x01, 0x00, 0x80} },
-{ 3, {0x01, 0x00, 0x88} },
-{ 3, {0x01, 0x00, 0x90} },
-{ 3, {0x01, 0x00, 0x98} },
-{ 3, {0x01, 0x00, 0xA0} },
-{ 3, {0x01, 0x00, 0xA8} },
-{ 3, {0x01, 0x00, 0xB0} },
-{ 3, {0x01, 0x00, 0xB8} },
-{ 3, {0x01, 0x00, 0xC0} },
-{ 3, {0x01, 0x00, 0xC8} },
-{ 3, {0x01, 0x00, 0xD0} },
-{ 3, {0x01, 0x00, 0xD8} },
-{ 3, {0x01, 0x00, 0xE0} },
-{ 3, {0x01, 0x00, 0xE8} },
-{ 3, {0x01, 0x00, 0xF0} },
-{ 3, {0x01, 0x00, 0xF8} },
-{ 1, {0x50} },
-{ 0, {} },
+static const __u8 dynamiteplus_init_code[] = {
+DYNAMITE_RECORD(0x01, 0x00, 0x00),
+DYNAMITE_RECORD(0x01, 0x00, 0x08),
+DYNAMITE_RECORD(0x01, 0x00, 0x10),
+DYNAMITE_RECORD(0x01, 0x00, 0x18),
+DYNAMITE_RECORD(0x01, 0x00, 0x20),
+DYNAMITE_RECORD(0x01, 0x00, 0x28),
+DYNAMITE_RECORD(0x01, 0x00, 0x30),
+DYNAMITE_RECORD(0x01, 0x00, 0x38),
+DYNAMITE_RECORD(0x01, 0x00, 0x40),
+DYNAMITE_RECORD(0x01, 0x00, 0x48),
+DYNAMITE_RECORD(0x01, 0x00, 0x50),
+DYNAMITE_RECORD(0x01, 0x00, 0x58),
+DYNAMITE_RECORD(0x01, 0x00, 0x60),
+DYNAMITE_RECORD(0x01, 0x00, 0x68),
+DYNAMITE_RECORD(0x01, 0x00, 0x70),
+DYNAMITE_RECORD(0x01, 0x00, 0x78),
+DYNAMITE_RECORD(0x01, 0x00, 0x80),
+DYNAMITE_RECORD(0x01, 0x00, 0x88),
+DYNAMITE_RECORD(0x01, 0x00, 0x90),
+DYNAMITE_RECORD(0x01, 0x00, 0x98),
+DYNAMITE_RECORD(0x01, 0x00, 0xA0),
+DYNAMITE_RECORD(0x01, 0x00, 0xA8),
+DYNAMITE_RECORD(0x01, 0x00, 0xB0),
+DYNAMITE_RECORD(0x01, 0x00, 0xB8),
+DYNAMITE_RECORD(0x01, 0x00, 0xC0),
+DYNAMITE_RECORD(0x01, 0x00, 0xC8),
+DYNAMITE_RECORD(0x01, 0x00, 0xD0),
+DYNAMITE_RECORD(0x01, 0x00, 0xD8),
+DYNAMITE_RECORD(0x01, 0x00, 0xE0),
+DYNAMITE_RECORD(0x01, 0x00, 0xE8),
+DYNAMITE_RECORD(0x01, 0x00, 0xF0),
+DYNAMITE_RECORD(0x01, 0x00, 0xF8),
+DYNAMITE_RECORD(0x01, 0x00, 0x00),
+DYNAMITE_RECORD(0x01, 0x00, 0x08),
+DYNAMITE_RECORD(0x01, 0x00, 0x10),
+DYNAMITE_RECORD(0x01, 0x00, 0x18),
+DYNAMITE_RECORD(0x01, 0x00, 0x20),
+DYNAMITE_RECORD(0x01, 0x00, 0x28),
+DYNAMITE_RECORD(0x01, 0x00, 0x30),
+DYNAMITE_RECORD(0x01, 0x00, 0x38),
+DYNAMITE_RECORD(0x01, 0x00, 0x40),
+DYNAMITE_RECORD(0x01, 0x00, 0x48),
+DYNAMITE_RECORD(0x01, 0x00, 0x50),
+DYNAMITE_RECORD(0x01, 0x00, 0x58),
+DYNAMITE_RECORD(0x01, 0x00, 0x60),
+DYNAMITE_RECORD(0x01, 0x00, 0x68),
+DYNAMITE_RECORD(0x01, 0x00, 0x70),
+DYNAMITE_RECORD(0x01, 0x00, 0x78),
+DYNAMITE_RECORD(0x01, 0x00, 0x80),
+DYNAMITE_RECORD(0x01, 0x00, 0x88),
+DYNAMITE_RECORD(0x01, 0x00, 0x90),
+DYNAMITE_RECORD(0x01, 0x00, 0x98),
+DYNAMITE_RECORD(0x01, 0x00, 0xA0),
+DYNAMITE_RECORD(0x01, 0x00, 0xA8),
+DYNAMITE_RECORD(0x01, 0x00, 0xB0),
+DYNAMITE_RECORD(0x01, 0x00, 0xB8),
+DYNAMITE_RECORD(0x01, 0x00, 0xC0),
+DYNAMITE_RECORD(0x01, 0x00, 0xC8),
+DYNAMITE_RECORD(0x01, 0x00, 0xD0),
+DYNAMITE_RECORD(0x01, 0x00, 0xD8),
+DYNAMITE_RECORD(0x01, 0x00, 0xE0),
+DYNAMITE_RECORD(0x01, 0x00, 0xE8),
+DYNAMITE_RECORD(0x01, 0x00, 0xF0),
+DYNAMITE_RECORD(0x01, 0x00, 0xF8),
+DYNAMITE_RECORD(0x50),
+DYNAMITE_RECORD_END
 };
 
 #endif
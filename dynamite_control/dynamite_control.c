@@ -24,6 +24,8 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
 
 #include "../dynamite/dynamite_ioctl.h"
 
@@ -41,6 +43,9 @@ tArgs vArgs[] =
 	{ "-c", " --setCardprogrammer  ", "Args: No argumens\n\tSet card programmer mode" },
 	{ "-p", " --setPhoenix	", "Args: 357, 368, 400, 600\n\tSet phoenix mode" },
 	{ "-s", " --setSmartmouse	", "Args: 357, 368, 400, 600\n\tSet smartmouse mode" },
+	{ "-r", " --readEeprom    ", "Args: file\n\tDump the config eeprom to file" },
+	{ "-w", " --writeEeprom   ", "Args: file\n\tRestore the config eeprom from file" },
+	{ "-b", " --benchEeprom   ", "Args: runs\n\tTime full config eeprom dumps" },
 	{ NULL, NULL, NULL }
 };
 
@@ -89,6 +94,130 @@ void usage(char *prg, char *cmd)
 	exit(1);
 }
 
+static void open_device(void)
+{
+	fd = open(DYNAMITE_DEVICE, O_RDWR);
+	if (fd < 0)
+	{
+		fprintf(stderr, "Failed open device: %s\n", DYNAMITE_DEVICE);
+		exit(1);
+	}
+}
+
+static double elapsed_ms(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000.0 + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static int dump_eeprom(unsigned char *buffer, double *ms)
+{
+	struct dynamite_eeprom_command dynamite_eeprom_cmd;
+	struct timespec start, end;
+
+	dynamite_eeprom_cmd.offset = 0;
+	dynamite_eeprom_cmd.length = EEPROM_LARGE_SIZE;
+	dynamite_eeprom_cmd.buffer = buffer;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (ioctl(fd, IOCTL_READ_EEPROM_COMMAND, &dynamite_eeprom_cmd) < 0)
+	{
+		fprintf(stderr, "Failed send ioctl command: IOCTL_READ_EEPROM_COMMAND, (%m)\n");
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	*ms = elapsed_ms(&start, &end);
+	return dynamite_eeprom_cmd.length;
+}
+
+static int read_eeprom_file(char *file)
+{
+	unsigned char buffer[EEPROM_LARGE_SIZE];
+	double ms;
+	FILE *f;
+	int len;
+
+	len = dump_eeprom(buffer, &ms);
+	if (len < 0)
+		return -1;
+
+	f = fopen(file, "wb");
+	if (f == NULL || fwrite(buffer, 1, len, f) != len)
+	{
+		fprintf(stderr, "Failed write file: %s\n", file);
+		if (f)
+			fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	fprintf(stderr, "Read %d bytes of eeprom in %.3f ms\n", len, ms);
+	return 0;
+}
+
+static int write_eeprom_file(char *file)
+{
+	unsigned char buffer[EEPROM_LARGE_SIZE], verify[EEPROM_LARGE_SIZE];
+	struct dynamite_eeprom_command dynamite_eeprom_cmd;
+	struct timespec start, end;
+	double ms;
+	FILE *f;
+	int len;
+
+	f = fopen(file, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Failed open file: %s\n", file);
+		return -1;
+	}
+	len = fread(buffer, 1, sizeof(buffer), f);
+	fclose(f);
+
+	dynamite_eeprom_cmd.offset = 0;
+	dynamite_eeprom_cmd.length = len;
+	dynamite_eeprom_cmd.buffer = buffer;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (ioctl(fd, IOCTL_WRITE_EEPROM_COMMAND, &dynamite_eeprom_cmd) < 0)
+	{
+		fprintf(stderr, "Failed send ioctl command: IOCTL_WRITE_EEPROM_COMMAND, (%m)\n");
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (dump_eeprom(verify, &ms) < len || memcmp(buffer, verify, len) != 0)
+	{
+		fprintf(stderr, "Eeprom verify failed\n");
+		return -1;
+	}
+
+	fprintf(stderr, "Wrote and verified %d bytes of eeprom in %.3f ms\n", len, elapsed_ms(&start, &end) + ms);
+	return 0;
+}
+
+static int bench_eeprom(int runs)
+{
+	unsigned char buffer[EEPROM_LARGE_SIZE];
+	double ms, min = 0, max = 0, total = 0;
+	int i, len = 0;
+
+	for (i = 0; i < runs; i++)
+	{
+		len = dump_eeprom(buffer, &ms);
+		if (len < 0)
+			return -1;
+		if (i == 0 || ms < min)
+			min = ms;
+		if (ms > max)
+			max = ms;
+		total += ms;
+	}
+
+	fprintf(stderr, "Eeprom dump: %d bytes, %d runs, min %.3f ms, avg %.3f ms, max %.3f ms, %.1f KiB/s\n",
+		len, runs, min, total / runs, max, (len / 1024.0) / (total / runs / 1000.0));
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int i;
@@ -203,6 +332,48 @@ int main(int argc, char *argv[])
 				}
 				i += 1;
 			}
+			else if ((strcmp(argv[i], "-r") == 0) || (strcmp(argv[i], "--readEeprom") == 0))
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "Missing file name\n");
+					usage(argv[0], NULL);
+				}
+				open_device();
+				if (read_eeprom_file(argv[i + 1]) < 0)
+					exit(1);
+				i += 1;
+			}
+			else if ((strcmp(argv[i], "-w") == 0) || (strcmp(argv[i], "--writeEeprom") == 0))
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "Missing file name\n");
+					usage(argv[0], NULL);
+				}
+				open_device();
+				if (write_eeprom_file(argv[i + 1]) < 0)
+					exit(1);
+				i += 1;
+			}
+			else if ((strcmp(argv[i], "-b") == 0) || (strcmp(argv[i], "--benchEeprom") == 0))
+			{
+				int runs = 10;
+
+				if (i + 1 < argc)
+				{
+					runs = atoi(argv[i + 1]);
+					i += 1;
+				}
+				if (runs <= 0)
+				{
+					fprintf(stderr, "Runs value out of range\n");
+					usage(argv[0], NULL);
+				}
+				open_device();
+				if (bench_eeprom(runs) < 0)
+					exit(1);
+			}
 			else
 			{
 				usage(argv[0], NULL);
@@ -57,22 +57,13 @@ int ezusb_fx1_set_reset(struct usb_device *dev, unsigned char reset_bit)
 }
 EXPORT_SYMBOL_GPL(ezusb_fx1_set_reset);
 
-static int ezusb_ihex_firmware_download(struct usb_device *dev,
-					struct ezusb_fx_type fx,
-					const char *firmware_path)
+static int ezusb_ihex_firmware_write(struct usb_device *dev,
+				     struct ezusb_fx_type fx,
+				     const struct firmware *firmware)
 {
-	int ret = -ENOENT;
-	const struct firmware *firmware = NULL;
+	int ret;
 	const struct ihex_binrec *record;
 
-	if (request_ihex_firmware(&firmware, firmware_path,
-				  &dev->dev)) {
-		dev_err(&dev->dev,
-			"%s - request \"%s\" failed\n",
-			__func__, firmware_path);
-		goto out;
-	}
-
 	ret = ezusb_set_reset(dev, fx.cpucs_reg, 0);
 	if (ret < 0)
 		goto out;
@@ -114,6 +105,26 @@ static int ezusb_ihex_firmware_download(struct usb_device *dev,
 		}
 	}
 	ret = ezusb_set_reset(dev, fx.cpucs_reg, 0);
+out:
+	return ret;
+}
+
+static int ezusb_ihex_firmware_download(struct usb_device *dev,
+					struct ezusb_fx_type fx,
+					const char *firmware_path)
+{
+	int ret = -ENOENT;
+	const struct firmware *firmware = NULL;
+
+	if (request_ihex_firmware(&firmware, firmware_path,
+				  &dev->dev)) {
+		dev_err(&dev->dev,
+			"%s - request \"%s\" failed\n",
+			__func__, firmware_path);
+		goto out;
+	}
+
+	ret = ezusb_ihex_firmware_write(dev, fx, firmware);
 out:
 	release_firmware(firmware);
 	return ret;
@@ -126,6 +137,13 @@ int ezusb_fx1_ihex_firmware_download(struct usb_device *dev,
 }
 EXPORT_SYMBOL_GPL(ezusb_fx1_ihex_firmware_download);
 
+int ezusb_fx1_ihex_firmware_write(struct usb_device *dev,
+				  const struct firmware *firmware)
+{
+	return ezusb_ihex_firmware_write(dev, ezusb_fx1, firmware);
+}
+EXPORT_SYMBOL_GPL(ezusb_fx1_ihex_firmware_write);
+
 int ezusb_fx1_writememory(struct usb_device *dev, int address,
 				unsigned char *data, int length, __u8 request)
 {
@@ -151,6 +169,13 @@ int ezusb_fx2_ihex_firmware_download(struct usb_device *dev,
 }
 EXPORT_SYMBOL_GPL(ezusb_fx2_ihex_firmware_download);
 
+int ezusb_fx2_ihex_firmware_write(struct usb_device *dev,
+				  const struct firmware *firmware)
+{
+	return ezusb_ihex_firmware_write(dev, ezusb_fx2, firmware);
+}
+EXPORT_SYMBOL_GPL(ezusb_fx2_ihex_firmware_write);
+
 int ezusb_fx2_writememory(struct usb_device *dev, int address,
 				unsigned char *data, int length, __u8 request)
 {
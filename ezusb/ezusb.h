@@ -12,15 +12,21 @@ struct ezusb_fx_type {
 	unsigned short max_internal_adress;
 };
 
+struct firmware;
+
 extern int ezusb_fx1_set_reset(struct usb_device *dev, unsigned char reset_bit);
 extern int ezusb_fx1_ihex_firmware_download(struct usb_device *dev,
 					    const char *firmware_path);
+extern int ezusb_fx1_ihex_firmware_write(struct usb_device *dev,
+					 const struct firmware *firmware);
 extern int ezusb_fx1_writememory(struct usb_device *dev, int address,
 					    unsigned char *data, int length, __u8 request);
 
 extern int ezusb_fx2_set_reset(struct usb_device *dev, unsigned char reset_bit);
 extern int ezusb_fx2_ihex_firmware_download(struct usb_device *dev,
 					    const char *firmware_path);
+extern int ezusb_fx2_ihex_firmware_write(struct usb_device *dev,
+					 const struct firmware *firmware);
 extern int ezusb_fx2_writememory(struct usb_device *dev, int address,
 					    unsigned char *data, int length, __u8 request);
 